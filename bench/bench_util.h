@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common/logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace Bench {
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Seconds elapsed since a time point.
+     * @param start The start time.
+     * @return The elapsed time in seconds.
+     */
+    inline double seconds_since(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    /**
+     * @brief Runs a benchmark body several times and reports the fastest run.
+     * The fastest run is the one least disturbed by other load on the machine.
+     * @param body The code to time; called once per repetition.
+     * @param items Work items processed by one call, used to normalize the result.
+     * @param repetitions The number of timed calls.
+     * @return The best time per item in nanoseconds.
+     */
+    template <typename Body>
+    double best_ns_per_item(Body &&body, std::size_t items, int repetitions = 5) {
+        double best = 0.0;
+        for (int rep = 0; rep < repetitions; ++rep) {
+            Clock::time_point start = Clock::now();
+            body();
+            double elapsed = seconds_since(start);
+            if (rep == 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+        return best * 1e9 / static_cast<double>(std::max<std::size_t>(1, items));
+    }
+
+    /**
+     * @brief Gets a percentile of a sample by nearest rank.
+     * @param values The sample; sorted in place.
+     * @param percentile The percentile in [0, 100].
+     * @return The value at that percentile, or 0 for an empty sample.
+     */
+    inline double percentile(std::vector<double> &values, double percentile) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        std::size_t rank = static_cast<std::size_t>(percentile / 100.0 * (values.size() - 1) + 0.5);
+        return values[std::min(rank, values.size() - 1)];
+    }
+
+    /**
+     * @brief Turns logging off while in scope.
+     * The simulator and client log every request, which would drown the benchmark output.
+     */
+    class LogSilencer {
+    public:
+        LogSilencer() : previous_(Log::get_level()) { Log::set_level(Log::Level::Off); }
+        ~LogSilencer() { Log::set_level(previous_); }
+
+        LogSilencer(const LogSilencer &) = delete;
+        LogSilencer &operator=(const LogSilencer &) = delete;
+
+    private:
+        Log::Level previous_;
+    };
+
+} // namespace Bench
@@ -0,0 +1,146 @@
+#include "bench_util.h"
+#include "client/async_client.h"
+#include "client/ellipse_generator.h"
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+    const std::string DEFAULT_HOST = "127.0.0.1";
+    const int DEFAULT_PORT = 12345;
+    const int DEFAULT_SESSIONS = 8;
+    const int DEFAULT_REQUESTS_PER_SESSION = 50;
+
+    /**
+     * @brief One simulated client: sends one ellipse at a time and times each request
+     * from submission to response.
+     */
+    struct SimulatedSession {
+        Client::EllipseGenerator generator;
+        uint64_t id = 0;
+        int remaining = 0;
+        Bench::Clock::time_point sent;
+        std::vector<double> latencies_ms; // One entry per answered request
+        bool failed = false;              // Connection, send or receive error
+
+        explicit SimulatedSession(unsigned int seed) : generator(seed) {}
+    };
+
+    /**
+     * @brief Submits the next request of a session; its callback submits the one after.
+     */
+    void submit_next(Client::AsyncClient &client, SimulatedSession &session) {
+        if (session.remaining == 0) {
+            client.close_session(session.id);
+            return;
+        }
+        --session.remaining;
+        session.sent = Bench::Clock::now();
+        bool submitted = client.submit_ellipse(session.id, session.generator.generate_ellipse(),
+                                               [&client, &session](const std::optional<Client::ServerResponse> &response) {
+                                                   if (!response) {
+                                                       session.failed = true;
+                                                       return;
+                                                   }
+                                                   session.latencies_ms.push_back(Bench::seconds_since(session.sent) * 1000.0);
+                                                   submit_next(client, session);
+                                               });
+        if (!submitted) {
+            session.failed = true;
+        }
+    }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::string host = DEFAULT_HOST;
+    int port = DEFAULT_PORT;
+    int num_sessions = DEFAULT_SESSIONS;
+    int requests_per_session = DEFAULT_REQUESTS_PER_SESSION;
+    Protocol::WireFormat format = Protocol::WireFormat::Text;
+    std::string options;
+
+    if (argc > 7) {
+        std::cerr << "Usage: " << argv[0] << " [host] [port] [sessions] [requests_per_session] [text|binary] [\"key=value ...\"]" << std::endl;
+        return 1;
+    }
+
+    try {
+        if (argc >= 2) {
+            host = argv[1];
+        }
+        if (argc >= 3) {
+            port = std::stoi(argv[2]);
+        }
+        if (argc >= 4) {
+            num_sessions = std::stoi(argv[3]);
+        }
+        if (argc >= 5) {
+            requests_per_session = std::stoi(argv[4]);
+        }
+        if (argc >= 6) {
+            std::string format_name = argv[5];
+            if (format_name == "binary") {
+                format = Protocol::WireFormat::Binary;
+            } else if (format_name != "text") {
+                std::cerr << "Error: Protocol must be 'text' or 'binary'." << std::endl;
+                return 1;
+            }
+        }
+        if (argc >= 7) {
+            options = argv[6];
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: Invalid argument. " << e.what() << std::endl;
+        return 1;
+    }
+    if (num_sessions <= 0 || requests_per_session <= 0) {
+        std::cerr << "Error: Sessions and requests per session must be positive." << std::endl;
+        return 1;
+    }
+
+    // Every session runs in this thread, driven by one event loop
+    std::vector<std::unique_ptr<SimulatedSession>> sessions;
+    double wall_seconds;
+    {
+        Bench::LogSilencer silencer; // The client logs every request
+        Client::AsyncClient client(host, port);
+        Bench::Clock::time_point started = Bench::Clock::now();
+        for (int i = 0; i < num_sessions; ++i) {
+            sessions.push_back(std::make_unique<SimulatedSession>(static_cast<unsigned int>(i + 1)));
+            SimulatedSession &session = *sessions.back();
+            std::optional<uint64_t> id = client.open_session(format, options);
+            if (!id) {
+                session.failed = true;
+                continue;
+            }
+            session.id = *id;
+            session.remaining = requests_per_session;
+            submit_next(client, session);
+        }
+        client.run();
+        wall_seconds = Bench::seconds_since(started);
+    }
+
+    std::vector<double> latencies;
+    int failures = 0;
+    for (const auto &session : sessions) {
+        latencies.insert(latencies.end(), session->latencies_ms.begin(), session->latencies_ms.end());
+        failures += session->failed;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Load test against " << host << ":" << port << std::endl;
+    std::cout << "  Sessions: " << num_sessions << ", requests per session: " << requests_per_session << std::endl;
+    std::cout << "  Answered requests: " << latencies.size() << ", failed sessions: " << failures << std::endl;
+    std::cout << "  Wall time: " << wall_seconds << " s" << std::endl;
+    std::cout << "  Throughput: " << latencies.size() / wall_seconds << " requests/s" << std::endl;
+    std::cout << "  Latency p50: " << Bench::percentile(latencies, 50) << " ms" << std::endl;
+    std::cout << "  Latency p99: " << Bench::percentile(latencies, 99) << " ms" << std::endl;
+    std::cout << "  Latency max: " << Bench::percentile(latencies, 100) << " ms" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
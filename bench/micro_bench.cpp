@@ -0,0 +1,216 @@
+#include "bench_util.h"
+#include "common/canvas.h"
+#include "common/ellipse.h"
+#include "server/containment_kernel.h"
+#include "server/ellipse_grid.h"
+#include "server/monte_carlo_simulator.h"
+#include "server/point_sampler.h"
+#include "server/random_generator.h"
+#include "server/thread_pool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    constexpr std::size_t NUM_POINTS = 1 << 20;
+    constexpr unsigned int SEED = 12345;
+
+    /**
+     * @brief Random ellipses with centers on the canvas and axes in [1, max_axis].
+     * Small axes give low coverage, large axes high coverage.
+     */
+    std::vector<Ellipse> make_ellipses(std::size_t count, double max_axis, unsigned int seed) {
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> center_x(Canvas::MIN_X, Canvas::MAX_X);
+        std::uniform_real_distribution<double> center_y(Canvas::MIN_Y, Canvas::MAX_Y);
+        std::uniform_real_distribution<double> axis(1.0, max_axis);
+        std::vector<Ellipse> ellipses(count);
+        for (Ellipse &ellipse : ellipses) {
+            ellipse = {center_x(generator), center_y(generator), axis(generator), axis(generator)};
+        }
+        return ellipses;
+    }
+
+    void print_row(const std::string &name, double value, const std::string &unit) {
+        std::cout << "  " << std::left << std::setw(60) << name << std::right << std::setw(12) << std::fixed
+                  << std::setprecision(2) << value << " " << unit << std::endl;
+    }
+
+    void bench_containment(const std::vector<double> &xs, const std::vector<double> &ys) {
+        std::cout << "Containment (" << NUM_POINTS << " points, kernel ISA " << Server::ContainmentKernel::active_isa() << ")" << std::endl;
+
+        const Ellipse single = make_ellipses(1, 25.0, SEED)[0];
+        volatile std::size_t sink = 0;
+        double ns = Bench::best_ns_per_item([&] {
+            std::size_t inside = 0;
+            for (std::size_t i = 0; i < NUM_POINTS; ++i) {
+                inside += single.is_inside(xs[i], ys[i]);
+            }
+            sink = inside;
+        }, NUM_POINTS);
+        print_row("Ellipse::is_inside", ns, "ns/point");
+
+        // The same ellipses reshaped into each shape class, tested with that class's kernels
+        const std::pair<Server::ShapeKind, const char *> shapes[] = {{Server::ShapeKind::Circle, "circles"},
+                                                                     {Server::ShapeKind::AxisAligned, "axis-aligned"},
+                                                                     {Server::ShapeKind::Rotated, "rotated"}};
+        for (std::size_t count : {16, 256}) {
+            for (const auto &[shape, shape_name] : shapes) {
+                std::vector<Ellipse> ellipses = make_ellipses(count, 5.0, SEED);
+                Server::EllipseSoA soa;
+                for (Ellipse &ellipse : ellipses) {
+                    if (shape == Server::ShapeKind::Circle) {
+                        ellipse.b = ellipse.a;
+                    } else if (shape == Server::ShapeKind::Rotated) {
+                        ellipse.angle = 0.5;
+                    }
+                    soa.push_back(ellipse);
+                }
+                const Server::ContainmentKernel::ShapeKernels &kernels = Server::ContainmentKernel::kernels_for(shape);
+                ns = Bench::best_ns_per_item([&] {
+                    sink = kernels.count_covered(soa, xs.data(), ys.data(), NUM_POINTS, nullptr);
+                }, NUM_POINTS);
+                print_row("ShapeKernels::count_covered, " + std::to_string(count) + " " + shape_name, ns, "ns/point");
+            }
+        }
+
+        for (std::size_t count : {16, 256, 4096}) {
+            Server::EllipseGrid grid;
+            const std::vector<Ellipse> ellipses = make_ellipses(count, 5.0, SEED);
+            for (std::size_t i = 0; i < ellipses.size(); ++i) {
+                grid.insert(ellipses[i], i);
+            }
+            ns = Bench::best_ns_per_item([&] {
+                sink = grid.count_covered(xs.data(), ys.data(), NUM_POINTS, nullptr);
+            }, NUM_POINTS);
+            print_row("EllipseGrid::count_covered, " + std::to_string(count) + " ellipses", ns, "ns/point");
+        }
+        (void)sink;
+    }
+
+    void bench_generation(std::vector<double> &xs, std::vector<double> &ys) {
+        std::cout << "Point generation (" << NUM_POINTS << " points)" << std::endl;
+
+        const std::pair<Server::GeneratorKind, const char *> generators[] = {
+            {Server::GeneratorKind::Mt19937, "mt19937"},
+            {Server::GeneratorKind::Xoshiro256Plus, "xoshiro256+"},
+        };
+        for (const auto &[kind, name] : generators) {
+            Server::RandomStream random;
+            random.seed(kind, SEED, 0);
+            double ns = Bench::best_ns_per_item([&] {
+                random.fill_uniform(xs.data(), NUM_POINTS, Canvas::MIN_X, Canvas::MAX_X);
+                random.fill_uniform(ys.data(), NUM_POINTS, Canvas::MIN_Y, Canvas::MAX_Y);
+            }, NUM_POINTS);
+            print_row(std::string("uniform points, ") + name, ns, "ns/point");
+        }
+
+        const std::pair<Server::SamplerKind, const char *> samplers[] = {
+            {Server::SamplerKind::Stratified, "stratified"},
+            {Server::SamplerKind::Halton, "halton"},
+            {Server::SamplerKind::Sobol, "sobol"},
+        };
+        const std::size_t batch = Server::PointSampler::STRUCTURED_BATCH_SIZE;
+        for (const auto &[kind, name] : samplers) {
+            Server::RandomStream random;
+            random.seed(Server::GeneratorKind::Xoshiro256Plus, SEED, 0);
+            double ns = Bench::best_ns_per_item([&] {
+                for (std::size_t offset = 0; offset + batch <= NUM_POINTS; offset += batch) {
+                    Server::PointSampler::fill(kind, random, xs.data() + offset, ys.data() + offset, batch);
+                }
+            }, NUM_POINTS);
+            print_row(std::string("sampler ") + name, ns, "ns/point");
+        }
+    }
+
+    void bench_estimate_area(Server::ThreadPool &pool) {
+        std::cout << "estimate_area (" << pool.size() + 1 << " threads)" << std::endl;
+
+        struct Mode {
+            const char *name;
+            bool incremental;
+            Server::EstimateOptions options;
+        };
+        Server::EstimateOptions scanline;
+        scanline.engine = Server::AreaEngine::Scanline;
+        Server::EstimateOptions raster;
+        raster.engine = Server::AreaEngine::Raster;
+        Server::EstimateOptions partial_cells;
+        partial_cells.restrict_to_ellipses = true;
+        Server::EstimateOptions sobol;
+        sobol.sampler = Server::SamplerKind::Sobol;
+        const Mode modes[] = {
+            {"mc incremental", true, {}},
+            {"mc fresh", false, {}},
+            {"mc fresh sobol", false, sobol},
+            {"mc fresh partial cells", false, partial_cells},
+            {"scanline", false, scanline},
+            {"raster", false, raster},
+        };
+        const std::pair<double, const char *> coverages[] = {{5.0, "low coverage"}, {25.0, "high coverage"}};
+
+        for (const auto &[max_axis, coverage_name] : coverages) {
+            for (std::size_t count : {1, 10, 100, 1000}) {
+                std::vector<Ellipse> ellipses = make_ellipses(count, max_axis, SEED);
+                for (const Mode &mode : modes) {
+                    Server::SimulatorConfig config;
+                    config.incremental = mode.incremental;
+                    config.num_streams = pool.size() + 1;
+                    config.seed = SEED;
+                    config.pool = &pool;
+
+                    // Time a full session: add every ellipse, then estimate once
+                    Server::MonteCarloResult result{};
+                    double ns;
+                    {
+                        Bench::LogSilencer silencer;
+                        ns = Bench::best_ns_per_item([&] {
+                            Server::MonteCarloSimulator simulator(config);
+                            for (const Ellipse &ellipse : ellipses) {
+                                simulator.add_ellipse(ellipse);
+                            }
+                            result = simulator.estimate_area(mode.options);
+                        }, 1, 3);
+                    }
+                    std::ostringstream name;
+                    name << coverage_name << ", " << count << " ellipses, " << mode.name << " ("
+                         << std::fixed << std::setprecision(1) << result.percentage_covered << "%)";
+                    print_row(name.str(), ns / 1e6, "ms");
+                }
+            }
+        }
+    }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    unsigned int num_threads = 1;
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [threads]" << std::endl;
+        return 1;
+    }
+    if (argc == 2) {
+        num_threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[1])));
+    }
+
+    std::vector<double> xs(NUM_POINTS);
+    std::vector<double> ys(NUM_POINTS);
+    Server::RandomStream random;
+    random.seed(Server::GeneratorKind::Xoshiro256Plus, SEED, 0);
+    random.fill_uniform(xs.data(), NUM_POINTS, Canvas::MIN_X, Canvas::MAX_X);
+    random.fill_uniform(ys.data(), NUM_POINTS, Canvas::MIN_Y, Canvas::MAX_Y);
+
+    bench_containment(xs, ys);
+    bench_generation(xs, ys);
+
+    Server::ThreadPool pool(num_threads - 1);
+    bench_estimate_area(pool);
+    return 0;
+}
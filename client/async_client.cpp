@@ -0,0 +1,455 @@
+#include "async_client.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <cstring>
+#include <errno.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace Client {
+
+    namespace {
+        constexpr int MAX_EVENTS = 256;
+        constexpr std::size_t RECV_CHUNK_SIZE = 16 * 1024;
+
+        // Extracts the number of a text response line such as "Covered Area: 12.34 units²" or "...: 5.67%"
+        bool parse_value_after_colon(std::string_view line, double &value) {
+            std::size_t colon = line.find(':');
+            if (colon == std::string_view::npos) {
+                return false;
+            }
+            std::string_view rest = line.substr(colon + 1);
+            std::string_view token = Protocol::next_token(rest);
+            return Protocol::parse_double(token.substr(0, token.find('%')), value);
+        }
+    } // namespace
+
+    AsyncClient::AsyncClient(const std::string &host, int port) : host_(host), port_(port) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            throw std::runtime_error("Could not create epoll instance. " + std::string(strerror(errno)));
+        }
+    }
+
+    AsyncClient::~AsyncClient() {
+        for (auto &[id, session] : sessions_) {
+            if (!session->closed) {
+                close(session->socket_fd);
+            }
+        }
+        close(epoll_fd_);
+    }
+
+    bool AsyncClient::resolve() {
+        if (address_len_ != 0) {
+            return true;
+        }
+
+        struct addrinfo hints{}, *result = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        std::string port_str = std::to_string(port_);
+        if (int rv = getaddrinfo(host_.c_str(), port_str.c_str(), &hints, &result); rv != 0) {
+            LOG_ERROR("Client: Error resolving hostname: " << gai_strerror(rv));
+            return false;
+        }
+        std::memcpy(&address_, result->ai_addr, result->ai_addrlen);
+        address_len_ = result->ai_addrlen;
+        freeaddrinfo(result);
+        return true;
+    }
+
+    std::optional<uint64_t> AsyncClient::open_session(Protocol::WireFormat format, const std::string &options) {
+        if (!resolve()) {
+            return std::nullopt;
+        }
+
+        int fd = socket(address_.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            LOG_ERROR("Client: socket: " << strerror(errno));
+            return std::nullopt;
+        }
+        bool connected = connect(fd, reinterpret_cast<const sockaddr *>(&address_), address_len_) == 0;
+        if (!connected && errno != EINPROGRESS) {
+            LOG_ERROR("Client: connect: " << strerror(errno));
+            close(fd);
+            return std::nullopt;
+        }
+
+        auto session = std::make_unique<Session>();
+        session->id = next_session_id_++;
+        session->socket_fd = fd;
+        session->format = format;
+        session->connected = connected;
+
+        // Everything a session starts with can be queued before the connect completes
+        if (format == Protocol::WireFormat::Binary) {
+            session->send_buf.push_back(static_cast<char>(Protocol::BINARY_MAGIC));
+            session->send_buf.push_back(static_cast<char>(Protocol::VERSION));
+            if (!options.empty()) {
+                Protocol::append_frame(session->send_buf, Protocol::MessageType::Options, 0, options);
+            }
+        } else {
+            session->text_options = options;
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.u64 = session->id;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            LOG_ERROR("Client: epoll_ctl failed. " << strerror(errno));
+            close(fd);
+            return std::nullopt;
+        }
+        session->registered_events = event.events;
+
+        uint64_t id = session->id;
+        sessions_.emplace(id, std::move(session));
+        return id;
+    }
+
+    AsyncClient::Session *AsyncClient::find_session(uint64_t session_id) {
+        auto it = sessions_.find(session_id);
+        if (it == sessions_.end() || it->second->closed) {
+            return nullptr;
+        }
+        return it->second.get();
+    }
+
+    bool AsyncClient::submit_ellipse(uint64_t session_id, const Ellipse &ellipse, ResponseCallback callback) {
+        Session *session = find_session(session_id);
+        if (!session) {
+            return false;
+        }
+
+        uint32_t sequence = session->next_sequence++;
+        std::string bytes;
+        if (session->format == Protocol::WireFormat::Binary) {
+            // A rotated ellipse goes as a one-entry RotatedBatch, since Ellipse frames carry no angle
+            const double values[5] = {ellipse.cx, ellipse.cy, ellipse.a, ellipse.b, ellipse.angle};
+            if (ellipse.angle != 0.0) {
+                Protocol::append_frame(bytes, Protocol::MessageType::RotatedBatch, sequence, values, 5);
+            } else {
+                Protocol::append_frame(bytes, Protocol::MessageType::Ellipse, sequence, values, 4);
+            }
+            LOG_DEBUG("Client TX (binary, session " << session_id << "): #" << sequence << " " << ellipse.cx << " "
+                      << ellipse.cy << " " << ellipse.a << " " << ellipse.b << " " << ellipse.angle);
+        } else {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(10);
+            oss << ellipse.cx << " " << ellipse.cy << " " << ellipse.a << " " << ellipse.b;
+            if (ellipse.angle != 0.0) {
+                oss << " " << ellipse.angle;
+            }
+            if (!session->text_options.empty()) {
+                oss << " " << session->text_options;
+            }
+            bytes = oss.str();
+            LOG_DEBUG("Client TX (session " << session_id << "): " << bytes);
+            bytes.push_back('\n');
+        }
+        return enqueue(*session, std::move(bytes), sequence, std::move(callback));
+    }
+
+    bool AsyncClient::submit_batch(uint64_t session_id, const std::vector<Ellipse> &ellipses, ResponseCallback callback) {
+        Session *session = find_session(session_id);
+        if (!session) {
+            return false;
+        }
+        if (session->format != Protocol::WireFormat::Binary) {
+            LOG_ERROR("Client: Batches require the binary protocol.");
+            return false;
+        }
+        const bool rotated = std::any_of(ellipses.begin(), ellipses.end(), [](const Ellipse &e) { return e.angle != 0.0; });
+        const std::size_t limit = rotated ? Protocol::MAX_ROTATED_BATCH_ELLIPSES : Protocol::MAX_BATCH_ELLIPSES;
+        if (ellipses.size() > limit) {
+            LOG_ERROR("Client: Batch of " << ellipses.size() << " ellipses exceeds the limit of " << limit << ".");
+            return false;
+        }
+
+        std::vector<double> values;
+        values.reserve(ellipses.size() * (rotated ? 5 : 4));
+        for (const Ellipse &ellipse : ellipses) {
+            values.insert(values.end(), {ellipse.cx, ellipse.cy, ellipse.a, ellipse.b});
+            if (rotated) {
+                values.push_back(ellipse.angle);
+            }
+        }
+        uint32_t sequence = session->next_sequence++;
+        std::string bytes;
+        Protocol::append_frame(bytes, rotated ? Protocol::MessageType::RotatedBatch : Protocol::MessageType::Batch, sequence,
+                               values.data(), values.size());
+        LOG_DEBUG("Client TX (binary, session " << session_id << "): #" << sequence << ", batch of " << ellipses.size() << " ellipses");
+        return enqueue(*session, std::move(bytes), sequence, std::move(callback));
+    }
+
+    bool AsyncClient::enqueue(Session &session, std::string &&bytes, uint32_t sequence, ResponseCallback &&callback) {
+        session.outstanding.push_back({sequence, std::move(callback)});
+        ++outstanding_count_;
+        if (session.send_buf.empty()) {
+            session.send_buf = std::move(bytes);
+        } else {
+            session.send_buf += bytes;
+        }
+        if (session.connected && !flush_send_buffer(session)) {
+            fail_session(session);
+            return false;
+        }
+        return true;
+    }
+
+    void AsyncClient::close_session(uint64_t session_id) {
+        if (Session *session = find_session(session_id)) {
+            fail_session(*session);
+        }
+    }
+
+    bool AsyncClient::poll(int timeout_ms) {
+        epoll_event events[MAX_EVENTS];
+        int ready = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            LOG_ERROR("Client: epoll_wait failed. " << strerror(errno));
+            return false;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            if (Session *session = find_session(events[i].data.u64)) {
+                handle_events(*session, events[i].events);
+            }
+        }
+
+        for (uint64_t id : retired_) {
+            sessions_.erase(id);
+        }
+        retired_.clear();
+        return true;
+    }
+
+    bool AsyncClient::run() {
+        while (outstanding_count_ > 0) {
+            if (!poll(-1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void AsyncClient::handle_events(Session &session, uint32_t events) {
+        if (!session.connected && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (getsockopt(session.socket_fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+                LOG_ERROR("Client: Session " << session.id << " failed to connect to " << host_ << ":" << port_
+                          << ": " << strerror(error != 0 ? error : errno));
+                fail_session(session);
+                return;
+            }
+            session.connected = true;
+            LOG_DEBUG("Client: Session " << session.id << " connected to " << host_ << ":" << port_);
+        }
+
+        if ((events & EPOLLOUT) && !flush_send_buffer(session)) {
+            fail_session(session);
+            return;
+        }
+        if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && !handle_readable(session)) {
+            fail_session(session);
+        }
+    }
+
+    bool AsyncClient::handle_readable(Session &session) {
+        while (true) {
+            char *dest = session.recv_buf.prepare(RECV_CHUNK_SIZE);
+            if (!dest) {
+                // Full: deliver what has arrived, then give up if no complete response made room
+                if (!process_received(session)) {
+                    return false;
+                }
+                dest = session.recv_buf.prepare(RECV_CHUNK_SIZE);
+                if (!dest) {
+                    LOG_ERROR("Client: Server sent more than " << ReceiveBuffer::DEFAULT_MAX_SIZE
+                                                               << " bytes without completing a response.");
+                    return false;
+                }
+            }
+            ssize_t nbytes = recv(session.socket_fd, dest, session.recv_buf.writable(), 0);
+            if (nbytes > 0) {
+                session.recv_buf.commit(static_cast<std::size_t>(nbytes));
+                continue;
+            }
+            if (nbytes == 0) {
+                // Answers that arrived with the close are still delivered
+                process_received(session);
+                if (!session.closed && !session.outstanding.empty()) {
+                    LOG_ERROR("Client: Server closed session " << session.id << " with requests in flight.");
+                }
+                return false;
+            }
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            LOG_ERROR("Client: recv: " << strerror(errno));
+            return false;
+        }
+        return process_received(session);
+    }
+
+    bool AsyncClient::process_received(Session &session) {
+        if (session.format == Protocol::WireFormat::Binary) {
+            if (!session.handshake_done) {
+                std::string_view data = session.recv_buf.data();
+                if (data.size() < Protocol::HANDSHAKE_SIZE) {
+                    return true;
+                }
+                uint8_t magic = static_cast<uint8_t>(data[0]);
+                uint8_t version = static_cast<uint8_t>(data[1]);
+                session.recv_buf.consume(Protocol::HANDSHAKE_SIZE);
+                if (magic != Protocol::BINARY_MAGIC || version < Protocol::MIN_VERSION || version > Protocol::VERSION) {
+                    LOG_ERROR("Client: Server does not speak a supported binary protocol version.");
+                    return false;
+                }
+                session.handshake_done = true;
+            }
+
+            while (!session.closed) {
+                Protocol::Frame frame;
+                std::size_t consumed = 0;
+                Protocol::ParseStatus status = Protocol::parse_frame(session.recv_buf.data(), frame, consumed);
+                if (status == Protocol::ParseStatus::Incomplete) {
+                    return true;
+                }
+                if (status == Protocol::ParseStatus::Invalid) {
+                    LOG_ERROR("Client: Malformed frame from server.");
+                    return false;
+                }
+                session.recv_buf.consume(consumed);
+                if (frame.type == Protocol::MessageType::Partial) {
+                    continue; // Partial results are not passed on; only the final one completes the request
+                }
+                if (frame.type == Protocol::MessageType::Error) {
+                    LOG_ERROR("Client: Server reported an error on session " << session.id << ": " << frame.payload);
+                    return false;
+                }
+                double values[2];
+                if (frame.type != Protocol::MessageType::Result || !Protocol::read_doubles(frame.payload, values, 2)) {
+                    LOG_ERROR("Client: Unexpected frame from server.");
+                    return false;
+                }
+                LOG_DEBUG("Client RX (binary, session " << session.id << "): #" << frame.sequence << " "
+                          << values[0] << " " << values[1]);
+                if (!complete_oldest(session, {frame.sequence, values[0], values[1]})) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // A text response is two lines: area, then percentage; streamed partial lines may precede it
+        while (!session.closed) {
+            std::string_view data = session.recv_buf.data();
+            std::size_t first = data.find('\n');
+            if (first != std::string_view::npos && data.substr(0, first).rfind("Partial ", 0) == 0) {
+                session.recv_buf.consume(first + 1); // Not passed on, as for binary sessions
+                continue;
+            }
+            std::size_t second = first == std::string_view::npos ? first : data.find('\n', first + 1);
+            if (second == std::string_view::npos) {
+                return true;
+            }
+            std::string_view area_line = data.substr(0, first);
+            std::string_view percentage_line = data.substr(first + 1, second - first - 1);
+            ServerResponse response{session.outstanding.empty() ? 0 : session.outstanding.front().sequence, 0.0, 0.0};
+            if (!parse_value_after_colon(area_line, response.covered_area) ||
+                !parse_value_after_colon(percentage_line, response.percentage_covered)) {
+                LOG_ERROR("Client: Unexpected response from server: " << area_line);
+                return false;
+            }
+            LOG_DEBUG("Client RX (session " << session.id << "):\n"
+                      << area_line << "\n"
+                      << percentage_line);
+            session.recv_buf.consume(second + 1);
+            if (!complete_oldest(session, response)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool AsyncClient::complete_oldest(Session &session, const ServerResponse &response) {
+        // The server answers a session's requests in the order they were sent
+        if (session.outstanding.empty() || response.sequence != session.outstanding.front().sequence) {
+            LOG_ERROR("Client: Unexpected response #" << response.sequence << " on session " << session.id << ".");
+            return false;
+        }
+        ResponseCallback callback = std::move(session.outstanding.front().callback);
+        session.outstanding.pop_front();
+        --outstanding_count_;
+        if (callback) {
+            callback(response);
+        }
+        return true;
+    }
+
+    bool AsyncClient::flush_send_buffer(Session &session) {
+        std::size_t total_sent = 0;
+        while (total_sent < session.send_buf.size()) {
+            ssize_t sent_this_call = send(session.socket_fd, session.send_buf.data() + total_sent,
+                                          session.send_buf.size() - total_sent, MSG_NOSIGNAL);
+            if (sent_this_call < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break; // Socket buffer full; wait for EPOLLOUT
+                LOG_ERROR("Client: send: " << strerror(errno));
+                return false;
+            }
+            total_sent += static_cast<std::size_t>(sent_this_call);
+        }
+        session.send_buf.erase(0, total_sent);
+        return update_interest(session);
+    }
+
+    bool AsyncClient::update_interest(Session &session) {
+        uint32_t events = EPOLLIN | (session.connected && session.send_buf.empty() ? 0u : uint32_t{EPOLLOUT});
+        if (events == session.registered_events) {
+            return true;
+        }
+
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = session.id;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, session.socket_fd, &event) < 0) {
+            LOG_ERROR("Client: epoll_ctl failed: " << strerror(errno));
+            return false;
+        }
+        session.registered_events = events;
+        return true;
+    }
+
+    void AsyncClient::fail_session(Session &session) {
+        if (session.closed) {
+            return;
+        }
+        session.closed = true;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session.socket_fd, nullptr);
+        close(session.socket_fd);
+        retired_.push_back(session.id);
+
+        // Callbacks may submit to other sessions, but never to this one again
+        std::deque<Pending> unanswered = std::move(session.outstanding);
+        session.outstanding.clear();
+        outstanding_count_ -= unanswered.size();
+        for (Pending &pending : unanswered) {
+            if (pending.callback) {
+                pending.callback(std::nullopt);
+            }
+        }
+    }
+
+} // namespace Client
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "client.h"
+#include "common/ellipse.h"
+#include "common/protocol.h"
+#include "common/receive_buffer.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace Client {
+
+    /**
+     * @brief Called once per request with its result, or std::nullopt if the session failed first.
+     * Runs on the thread that drives the event loop and may submit more requests.
+     */
+    using ResponseCallback = std::function<void(const std::optional<ServerResponse> &response)>;
+
+    /**
+     * @brief Non-blocking client engine that drives many server sessions from one thread.
+     * Each session is its own connection with its own wire format and options. Requests are
+     * queued without waiting, and an epoll loop run by poll() or run() sends them and invokes
+     * their callbacks as the answers arrive, in request order per session.
+     */
+    class AsyncClient {
+    public:
+        /**
+         * @brief Constructor.
+         * @param host The server hostname or IP address; resolved once, on the first open_session().
+         * @param port The server port number.
+         * @throws std::runtime_error if the epoll instance cannot be created.
+         */
+        AsyncClient(const std::string &host, int port);
+
+        /**
+         * @brief Destructor. Closes every session without invoking callbacks.
+         */
+        ~AsyncClient();
+
+        AsyncClient(const AsyncClient &) = delete;
+        AsyncClient &operator=(const AsyncClient &) = delete;
+
+        /**
+         * @brief Starts connecting a new session; requests may be submitted right away.
+         * @param format The wire format; binary sessions queue the handshake first.
+         * @param options Estimate options ("key=value ...") for all requests of the session.
+         * @return The session id, or std::nullopt if the host cannot be resolved or no socket can be opened.
+         */
+        std::optional<uint64_t> open_session(Protocol::WireFormat format, const std::string &options = "");
+
+        /**
+         * @brief Queues an ellipse on a session.
+         * @param session_id The session, from open_session().
+         * @param ellipse The ellipse to send.
+         * @param callback Receives the response.
+         * @return True if queued, false if the session does not exist or has failed.
+         */
+        bool submit_ellipse(uint64_t session_id, const Ellipse &ellipse, ResponseCallback callback);
+
+        /**
+         * @brief Queues many ellipses as one request on a binary session.
+         * @param session_id The session, from open_session().
+         * @param ellipses The ellipses to send, at most Protocol::MAX_BATCH_ELLIPSES (MAX_ROTATED_BATCH_ELLIPSES if any is rotated).
+         * @param callback Receives the response.
+         * @return True if queued, false otherwise.
+         */
+        bool submit_batch(uint64_t session_id, const std::vector<Ellipse> &ellipses, ResponseCallback callback);
+
+        /**
+         * @brief Closes a session; its unanswered requests get std::nullopt.
+         * @param session_id The session, from open_session().
+         */
+        void close_session(uint64_t session_id);
+
+        /**
+         * @brief Waits for socket events once and handles them.
+         * @param timeout_ms How long to wait; -1 waits until something happens.
+         * @return False if epoll failed, true otherwise.
+         */
+        bool poll(int timeout_ms);
+
+        /**
+         * @brief Runs the event loop until no request is in flight, including requests submitted by callbacks.
+         * @return False if epoll failed, true otherwise.
+         */
+        bool run();
+
+        /**
+         * @brief Gets the number of requests waiting for a response, over all sessions.
+         * @return The count of outstanding requests.
+         */
+        std::size_t get_outstanding_count() const { return outstanding_count_; }
+
+        /**
+         * @brief Gets the number of open sessions.
+         * @return The count of sessions that have not been closed or failed.
+         */
+        std::size_t get_session_count() const { return sessions_.size() - retired_.size(); }
+
+    private:
+        /**
+         * @brief A request waiting for its response.
+         */
+        struct Pending {
+            uint32_t sequence;
+            ResponseCallback callback;
+        };
+
+        /**
+         * @brief State of one server connection.
+         */
+        struct Session {
+            uint64_t id;
+            int socket_fd;
+            Protocol::WireFormat format;
+            std::string text_options;        // Appended to every text ellipse line
+            ReceiveBuffer recv_buf;          // Received bytes not yet forming a full response
+            std::string send_buf;            // Request bytes not yet accepted by the socket
+            std::deque<Pending> outstanding; // Requests in flight, oldest first
+            uint32_t next_sequence = 1;
+            uint32_t registered_events = 0;  // Events currently requested from epoll
+            bool connected = false;          // The non-blocking connect has finished
+            bool handshake_done = false;     // The binary handshake reply was read
+            bool closed = false;             // Socket closed; freed at the end of the current poll()
+        };
+
+        /**
+         * @brief Resolves host_ into address_ unless that was already done.
+         * @return True if an address is available.
+         */
+        bool resolve();
+
+        /**
+         * @brief Finds an open session.
+         * @return The session, or nullptr if it does not exist or was closed.
+         */
+        Session *find_session(uint64_t session_id);
+
+        /**
+         * @brief Records a request and sends or buffers its bytes.
+         * @return True on success; on failure the session is closed.
+         */
+        bool enqueue(Session &session, std::string &&bytes, uint32_t sequence, ResponseCallback &&callback);
+
+        /**
+         * @brief Finishes the connect, sends buffered bytes and reads responses as epoll reports.
+         */
+        void handle_events(Session &session, uint32_t events);
+
+        /**
+         * @brief Reads everything available and dispatches complete responses.
+         * @return False if the session failed.
+         */
+        bool handle_readable(Session &session);
+
+        /**
+         * @brief Dispatches every complete response in the receive buffer.
+         * @return False on an error reply or malformed data.
+         */
+        bool process_received(Session &session);
+
+        /**
+         * @brief Pops the oldest request of a session and invokes its callback.
+         * @return False if no request was waiting or the sequence does not match.
+         */
+        bool complete_oldest(Session &session, const ServerResponse &response);
+
+        /**
+         * @brief Sends as much of the send buffer as the socket accepts.
+         * @return False on a send or epoll error.
+         */
+        bool flush_send_buffer(Session &session);
+
+        /**
+         * @brief Requests EPOLLOUT while there is something to send or the connect is pending.
+         * @return False if epoll_ctl failed.
+         */
+        bool update_interest(Session &session);
+
+        /**
+         * @brief Closes the socket and fails the session's unanswered requests.
+         */
+        void fail_session(Session &session);
+
+        std::string host_;
+        int port_;
+        int epoll_fd_;
+        sockaddr_storage address_{};
+        socklen_t address_len_ = 0; // 0 until resolve() succeeds
+        uint64_t next_session_id_ = 1;
+        std::size_t outstanding_count_ = 0;
+        std::unordered_map<uint64_t, std::unique_ptr<Session>> sessions_;
+        std::vector<uint64_t> retired_; // Closed sessions, erased once no handler refers to them
+    };
+
+} // namespace Client
@@ -1,7 +1,7 @@
 #include "client.h"
+#include "common/logger.h"
 #include <algorithm>
 #include <iomanip>
-#include <iostream>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
@@ -17,8 +17,50 @@
 
 namespace Client {
 
-    TcpClient::TcpClient(const std::string &host, int port)
-        : host_(host), port_(port), socket_fd_(-1), connected_(false) {}
+    namespace {
+        // Extracts the number of a text response line such as "Covered Area: 12.34 units²"
+        double parse_value_after_colon(std::string_view line) {
+            std::size_t colon = line.find(':');
+            if (colon == std::string_view::npos) {
+                return 0.0;
+            }
+            std::string_view rest = line.substr(colon + 1);
+            std::string_view token = Protocol::next_token(rest);
+            if (!token.empty() && token.back() == '%') {
+                token.remove_suffix(1);
+            }
+            double value = 0.0;
+            return Protocol::parse_double(token, value) ? value : 0.0;
+        }
+
+        // Extracts the numbers of a streamed line such as
+        // "Partial Covered Area: 12.34 units² (5.67%), interval [12.00, 12.68] after 40000 samples"
+        bool parse_partial_line(std::string_view line, PartialResult &partial) {
+            double values[5];
+            std::size_t count = 0;
+            for (std::string_view token = Protocol::next_token(line); !token.empty() && count < 5;
+                 token = Protocol::next_token(line)) {
+                std::size_t first = token.find_first_not_of("([");
+                std::size_t last = token.find_last_not_of(",%)]");
+                if (first != std::string_view::npos && last != std::string_view::npos && first <= last &&
+                    Protocol::parse_double(token.substr(first, last - first + 1), values[count])) {
+                    ++count;
+                }
+            }
+            if (count != 5) {
+                return false;
+            }
+            partial.covered_area = values[0];
+            partial.percentage_covered = values[1];
+            partial.interval_low = values[2];
+            partial.interval_high = values[3];
+            partial.samples = static_cast<long long>(values[4]);
+            return true;
+        }
+    } // namespace
+
+    TcpClient::TcpClient(const std::string &host, int port, Protocol::WireFormat format)
+        : host_(host), port_(port), socket_fd_(-1), connected_(false), format_(format), protocol_version_(0), next_sequence_(1) {}
 
     TcpClient::~TcpClient() {
         disconnect();
@@ -26,7 +68,7 @@ namespace Client {
 
     bool TcpClient::connect_to_server() {
         if (connected_) {
-            std::cerr << "Already connected." << std::endl;
+            LOG_WARNING("Already connected.");
             return true;
         }
 
@@ -38,21 +80,21 @@ namespace Client {
 
         std::string port_str = std::to_string(port_);
         if (int rv = getaddrinfo(host_.c_str(), port_str.c_str(), &hints, &result) != 0) {
-            std::cerr << "Client: Error resolving hostname: " << gai_strerror(rv) << std::endl;
+            LOG_ERROR("Client: Error resolving hostname: " << gai_strerror(rv));
             return false;
         }
 
         for (rp = result; rp != nullptr; rp = rp->ai_next) {
             socket_fd_ = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
             if (socket_fd_ == -1) {
-                perror("Client: socket");
+                LOG_ERROR("Client: socket: " << strerror(errno));
                 continue;
             }
 
             if (connect(socket_fd_, rp->ai_addr, rp->ai_addrlen) == 0)
                 break; // success
 
-            perror("Client: connect");
+            LOG_ERROR("Client: connect: " << strerror(errno));
             close(socket_fd_);
             socket_fd_ = -1;
         }
@@ -60,82 +102,457 @@ namespace Client {
         freeaddrinfo(result);
 
         if (rp == nullptr) { // No address succeeded
-            std::cerr << "Client: Failed to connect to server " << host_ << ":" << port_ << std::endl;
+            LOG_ERROR("Client: Failed to connect to server " << host_ << ":" << port_);
             return false;
         }
 
-        std::cout << "Client: Connected to server " << host_ << ":" << port_ << std::endl;
+        LOG_INFO("Client: Connected to server " << host_ << ":" << port_);
         connected_ = true;
+
+        if (format_ == Protocol::WireFormat::Binary && !perform_handshake()) {
+            disconnect();
+            return false;
+        }
         return true;
     }
 
-    bool TcpClient::send_ellipse_and_get_response(const Ellipse &ellipse) {
+    bool TcpClient::perform_handshake() {
+        const char hello[Protocol::HANDSHAKE_SIZE] = {static_cast<char>(Protocol::BINARY_MAGIC),
+                                                      static_cast<char>(Protocol::VERSION)};
+        if (!send_all(socket_fd_, hello, sizeof(hello))) {
+            return false;
+        }
+
+        while (recv_buf_.size() < Protocol::HANDSHAKE_SIZE) {
+            if (!receive_more()) {
+                LOG_ERROR("Client: Server closed the connection during the handshake.");
+                return false;
+            }
+        }
+
+        uint8_t magic = static_cast<uint8_t>(recv_buf_.data()[0]);
+        protocol_version_ = static_cast<uint8_t>(recv_buf_.data()[1]);
+        recv_buf_.consume(Protocol::HANDSHAKE_SIZE);
+        if (magic != Protocol::BINARY_MAGIC || protocol_version_ < Protocol::MIN_VERSION || protocol_version_ > Protocol::VERSION) {
+            LOG_ERROR("Client: Server does not speak a supported binary protocol version.");
+            return false;
+        }
+
+        LOG_INFO("Client: Using binary protocol version " << static_cast<int>(protocol_version_));
+        return true;
+    }
+
+    bool TcpClient::set_request_options(const std::string &options) {
+        if (format_ == Protocol::WireFormat::Text) {
+            text_options_ = options;
+            return true;
+        }
         if (!connected_) {
-            std::cerr << "Client: Not connected to server." << std::endl;
+            LOG_ERROR("Client: Not connected to server.");
             return false;
         }
-        if (!transmit_ellipse_data(ellipse)) {
+
+        std::string frame;
+        Protocol::append_frame(frame, Protocol::MessageType::Options, 0, options);
+        LOG_DEBUG("Client TX (binary): options " << options);
+        return send_all(socket_fd_, frame.data(), frame.size());
+    }
+
+    std::optional<uint64_t> TcpClient::resume_session(const std::string &token) {
+        if (!connected_) {
+            LOG_ERROR("Client: Not connected to server.");
+            return std::nullopt;
+        }
+
+        if (format_ == Protocol::WireFormat::Binary) {
+            std::string frame;
+            Protocol::append_frame(frame, Protocol::MessageType::Session, 0, token);
+            LOG_DEBUG("Client TX (binary): session " << token);
+            if (!send_all(socket_fd_, frame.data(), frame.size())) {
+                return std::nullopt;
+            }
+
+            Protocol::Frame reply;
+            double restored;
+            if (!read_frame_from_server(reply)) {
+                LOG_ERROR("Client: Failed to read session reply from server or server disconnected.");
+                return std::nullopt;
+            }
+            if (reply.type == Protocol::MessageType::Error) {
+                LOG_ERROR("Client: Server reported an error: " << reply.payload);
+                return std::nullopt;
+            }
+            if (reply.type != Protocol::MessageType::Session || !Protocol::read_doubles(reply.payload, &restored, 1)) {
+                LOG_ERROR("Client: Unexpected frame from server.");
+                return std::nullopt;
+            }
+            LOG_DEBUG("Client RX (binary): session " << token << ", " << restored << " ellipses restored");
+            return static_cast<uint64_t>(restored);
+        }
+
+        std::string command = "SESSION " + token + "\n";
+        LOG_DEBUG("Client TX: SESSION " << token);
+        if (!send_all(socket_fd_, command.c_str(), command.length())) {
+            return std::nullopt;
+        }
+        bool success;
+        auto reply = read_line_from_server(success);
+        if (!success || !reply) {
+            LOG_ERROR("Client: Failed to read session reply from server or server disconnected.");
+            return std::nullopt;
+        }
+        LOG_DEBUG("Client RX: " << *reply);
+        return static_cast<uint64_t>(parse_value_after_colon(*reply));
+    }
+
+    bool TcpClient::send_ellipse_and_get_response(const Ellipse &ellipse) {
+        if (!submit_ellipse(ellipse)) {
+            return false;
+        }
+        return receive_response().has_value();
+    }
+
+    std::optional<uint32_t> TcpClient::submit_ellipse(const Ellipse &ellipse) {
+        if (!connected_) {
+            LOG_ERROR("Client: Not connected to server.");
+            return std::nullopt;
+        }
+
+        if (!can_send_rotation(ellipse.angle != 0.0)) {
+            return std::nullopt;
+        }
+
+        uint32_t sequence = next_sequence_++;
+        if (!transmit_ellipse_data(ellipse, sequence)) {
+            return std::nullopt;
+        }
+        outstanding_.push_back(sequence);
+        return sequence;
+    }
+
+    std::optional<uint32_t> TcpClient::submit_batch(const std::vector<Ellipse> &ellipses) {
+        if (!connected_) {
+            LOG_ERROR("Client: Not connected to server.");
+            return std::nullopt;
+        }
+        if (format_ != Protocol::WireFormat::Binary) {
+            LOG_ERROR("Client: Batches require the binary protocol.");
+            return std::nullopt;
+        }
+        // Rotated ellipses need the wider RotatedBatch entries; plain batches stay compact
+        const bool rotated = std::any_of(ellipses.begin(), ellipses.end(), [](const Ellipse &e) { return e.angle != 0.0; });
+        if (!can_send_rotation(rotated)) {
+            return std::nullopt;
+        }
+        const std::size_t limit = rotated ? Protocol::MAX_ROTATED_BATCH_ELLIPSES : Protocol::MAX_BATCH_ELLIPSES;
+        if (ellipses.size() > limit) {
+            LOG_ERROR("Client: Batch of " << ellipses.size() << " ellipses exceeds the limit of " << limit << ".");
+            return std::nullopt;
+        }
+
+        std::vector<double> values;
+        values.reserve(ellipses.size() * (rotated ? 5 : 4));
+        for (const Ellipse &ellipse : ellipses) {
+            values.insert(values.end(), {ellipse.cx, ellipse.cy, ellipse.a, ellipse.b});
+            if (rotated) {
+                values.push_back(ellipse.angle);
+            }
+        }
+
+        uint32_t sequence = next_sequence_++;
+        std::string frame;
+        Protocol::append_frame(frame, rotated ? Protocol::MessageType::RotatedBatch : Protocol::MessageType::Batch, sequence,
+                               values.data(), values.size());
+
+        LOG_DEBUG("Client TX (binary): #" << sequence << ", batch of " << ellipses.size() << " ellipses");
+        if (!send_all(socket_fd_, frame.data(), frame.size())) {
+            return std::nullopt;
+        }
+        outstanding_.push_back(sequence);
+        return sequence;
+    }
+
+    std::optional<uint32_t> TcpClient::submit_file(const std::string &path) {
+        if (!connected_) {
+            LOG_ERROR("Client: Not connected to server.");
+            return std::nullopt;
+        }
+
+        if (format_ == Protocol::WireFormat::Text && path.find_first_of(" \t\r\n") != std::string::npos) {
+            LOG_ERROR("Client: Text clients cannot load paths containing whitespace.");
+            return std::nullopt;
+        }
+
+        uint32_t sequence = next_sequence_++;
+        std::string frame;
+        Protocol::append_frame(frame, Protocol::MessageType::Load, sequence, path);
+        return submit_message(sequence, frame, "LOAD " + path);
+    }
+
+    std::optional<uint32_t> TcpClient::submit_removal(uint64_t id) {
+        if (!connected_) {
+            LOG_ERROR("Client: Not connected to server.");
+            return std::nullopt;
+        }
+
+        uint32_t sequence = next_sequence_++;
+        const double value = static_cast<double>(id);
+        std::string frame;
+        Protocol::append_frame(frame, Protocol::MessageType::Remove, sequence, &value, 1);
+        return submit_message(sequence, frame, "REMOVE " + std::to_string(id));
+    }
+
+    std::optional<uint32_t> TcpClient::submit_update(uint64_t id, const Ellipse &ellipse) {
+        if (!connected_) {
+            LOG_ERROR("Client: Not connected to server.");
+            return std::nullopt;
+        }
+
+        if (!can_send_rotation(ellipse.angle != 0.0)) {
+            return std::nullopt;
+        }
+
+        // Version 2 Update entries end before the angle
+        uint32_t sequence = next_sequence_++;
+        const double values[6] = {static_cast<double>(id), ellipse.cx, ellipse.cy, ellipse.a, ellipse.b, ellipse.angle};
+        std::string frame;
+        Protocol::append_frame(frame, Protocol::MessageType::Update, sequence, values, protocol_version_ >= 3 ? 6 : 5);
+
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(10); // Same precision as ellipse lines
+        line << "UPDATE " << id << " " << ellipse.cx << " " << ellipse.cy << " " << ellipse.a << " " << ellipse.b;
+        if (ellipse.angle != 0.0) {
+            line << " " << ellipse.angle;
+        }
+        return submit_message(sequence, frame, line.str());
+    }
+
+    std::optional<uint32_t> TcpClient::submit_message(uint32_t sequence, const std::string &frame, std::string line) {
+        const std::string *message = &frame;
+        if (format_ == Protocol::WireFormat::Binary) {
+            LOG_DEBUG("Client TX (binary): #" << sequence << ", " << line);
+        } else {
+            if (!text_options_.empty()) {
+                line += " " + text_options_;
+            }
+            LOG_DEBUG("Client TX: " << line);
+            line += "\n";
+            message = &line;
+        }
+        if (!send_all(socket_fd_, message->data(), message->size())) {
+            return std::nullopt;
+        }
+        outstanding_.push_back(sequence);
+        return sequence;
+    }
+
+    std::optional<ServerResponse> TcpClient::receive_response() {
+        if (outstanding_.empty()) {
+            LOG_ERROR("Client: No request is waiting for a response.");
+            return std::nullopt;
+        }
+
+        ServerResponse response{outstanding_.front(), 0.0, 0.0};
+        if (!receive_server_response(response)) {
+            return std::nullopt;
+        }
+
+        // The server answers a session's requests in the order they were sent
+        if (response.sequence != outstanding_.front()) {
+            LOG_ERROR("Client: Expected response #" << outstanding_.front() << " but got #" << response.sequence << ".");
+            return std::nullopt;
+        }
+        outstanding_.pop_front();
+        return response;
+    }
+
+    void TcpClient::set_partial_callback(PartialCallback callback) {
+        partial_callback_ = std::move(callback);
+    }
+
+    size_t TcpClient::get_outstanding_count() const {
+        return outstanding_.size();
+    }
+
+    bool TcpClient::can_send_rotation(bool rotated) const {
+        if (rotated && format_ == Protocol::WireFormat::Binary && protocol_version_ < 3) {
+            LOG_ERROR("Client: The server's binary protocol version " << static_cast<int>(protocol_version_)
+                      << " does not carry rotated ellipses.");
             return false;
         }
-        return receive_server_response();
+        return true;
     }
 
-    bool TcpClient::transmit_ellipse_data(const Ellipse &ellipse) {
+    bool TcpClient::transmit_ellipse_data(const Ellipse &ellipse, uint32_t sequence) {
+        if (format_ == Protocol::WireFormat::Binary) {
+            // A rotated ellipse goes as a one-entry RotatedBatch, since Ellipse frames carry no angle
+            std::string frame;
+            const double values[5] = {ellipse.cx, ellipse.cy, ellipse.a, ellipse.b, ellipse.angle};
+            if (ellipse.angle != 0.0) {
+                Protocol::append_frame(frame, Protocol::MessageType::RotatedBatch, sequence, values, 5);
+            } else {
+                Protocol::append_frame(frame, Protocol::MessageType::Ellipse, sequence, values, 4);
+            }
+
+            LOG_DEBUG("Client TX (binary): #" << sequence << " " << ellipse.cx << " " << ellipse.cy << " " << ellipse.a << " "
+                      << ellipse.b << " " << ellipse.angle);
+            return send_all(socket_fd_, frame.data(), frame.size());
+        }
+
         std::ostringstream oss;
         // Ensure high precision for doubles to avoid truncation
         oss << std::fixed << std::setprecision(10);
-        oss << ellipse.cx << " " << ellipse.cy << " " << ellipse.a << " " << ellipse.b << "\n";
+        oss << ellipse.cx << " " << ellipse.cy << " " << ellipse.a << " " << ellipse.b;
+        if (ellipse.angle != 0.0) {
+            oss << " " << ellipse.angle;
+        }
+        if (!text_options_.empty()) {
+            oss << " " << text_options_;
+        }
+        oss << "\n";
         std::string ellipse_str = oss.str();
 
-        std::cout << "Client TX: " << ellipse_str;
+        LOG_DEBUG("Client TX: " << ellipse_str.substr(0, ellipse_str.size() - 1)); // The logger ends the line
         return send_all(socket_fd_, ellipse_str.c_str(), ellipse_str.length());
     }
 
-    bool TcpClient::receive_server_response() {
+    bool TcpClient::receive_server_response(ServerResponse &response) {
+        if (format_ == Protocol::WireFormat::Binary) {
+            Protocol::Frame frame;
+            if (!read_frame_from_server(frame)) {
+                LOG_ERROR("Client: Failed to read result frame from server or server disconnected.");
+                return false;
+            }
+            while (frame.type == Protocol::MessageType::Partial) {
+                double values[5];
+                if (!Protocol::read_doubles(frame.payload, values, 5)) {
+                    LOG_ERROR("Client: Malformed partial result from server.");
+                    return false;
+                }
+                LOG_DEBUG("Client RX: #" << frame.sequence << " partial " << values[0] << " after " << values[4] << " samples");
+                if (partial_callback_) {
+                    partial_callback_({frame.sequence, values[0], values[1], values[2], values[3], static_cast<long long>(values[4])});
+                }
+                if (!read_frame_from_server(frame)) {
+                    LOG_ERROR("Client: Failed to read result frame from server or server disconnected.");
+                    return false;
+                }
+            }
+            if (frame.type == Protocol::MessageType::Error) {
+                LOG_ERROR("Client: Server reported an error: " << frame.payload);
+                return false;
+            }
+
+            double values[2];
+            if (frame.type != Protocol::MessageType::Result || !Protocol::read_doubles(frame.payload, values, 2)) {
+                LOG_ERROR("Client: Unexpected frame from server.");
+                return false;
+            }
+            response.sequence = frame.sequence;
+            response.covered_area = values[0];
+            response.percentage_covered = values[1];
+
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(2);
+            oss << "Covered Area: " << values[0] << " units²\n"
+                << "Percentage of Canvas Covered: " << values[1] << "%";
+            LOG_DEBUG("Client RX: #" << frame.sequence << "\n"
+                      << oss.str());
+            return true;
+        }
+
+        // Each line views recv_buf_ and is only valid until the next read, so parse it first
         bool success = true;
         auto area_line = read_line_from_server(success);
+        while (success && area_line && area_line->rfind("Partial ", 0) == 0) {
+            PartialResult partial{response.sequence, 0.0, 0.0, 0.0, 0.0, 0};
+            if (!parse_partial_line(*area_line, partial)) {
+                LOG_ERROR("Client: Malformed partial result from server: " << *area_line);
+                return false;
+            }
+            LOG_DEBUG("Client RX: " << *area_line);
+            if (partial_callback_) {
+                partial_callback_(partial);
+            }
+            area_line = read_line_from_server(success);
+        }
         if (!success || !area_line) {
-            std::cerr << "Client: Failed to read area line from server or server disconnected." << std::endl;
+            LOG_ERROR("Client: Failed to read area line from server or server disconnected.");
             return false;
         }
+        // Text responses carry no sequence number; they arrive in request order
+        response.covered_area = parse_value_after_colon(*area_line);
+        LOG_DEBUG("Client RX: " << *area_line);
 
         auto percentage_line = read_line_from_server(success);
         if (!success || !percentage_line) {
-            std::cerr << "Client: Failed to read percentage line from server or server disconnected." << std::endl;
+            LOG_ERROR("Client: Failed to read percentage line from server or server disconnected.");
             return false;
         }
 
-        std::cout << "Client RX:\n"
-                  << *area_line << "\n"
-                  << *percentage_line << std::endl;
+        response.percentage_covered = parse_value_after_colon(*percentage_line);
+        LOG_DEBUG("Client RX: " << *percentage_line);
         return true;
     }
 
-    std::optional<std::string> TcpClient::read_line_from_server(bool &success) {
-        constexpr std::size_t BUF_SIZE = 256;
-        char temp[BUF_SIZE];
+    bool TcpClient::read_frame_from_server(Protocol::Frame &frame) {
+        while (true) {
+            std::size_t consumed = 0;
+            Protocol::ParseStatus status = Protocol::parse_frame(recv_buf_.data(), frame, consumed);
+            if (status == Protocol::ParseStatus::Complete) {
+                recv_buf_.consume(consumed);
+                return true;
+            }
+            if (status == Protocol::ParseStatus::Invalid) {
+                LOG_ERROR("Client: Malformed frame from server.");
+                return false;
+            }
+            if (!receive_more()) {
+                return false;
+            }
+        }
+    }
+
+    bool TcpClient::receive_more() {
+        constexpr std::size_t RECV_CHUNK_SIZE = 16 * 1024;
+
+        while (true) {
+            char *dest = recv_buf_.prepare(RECV_CHUNK_SIZE);
+            if (!dest) {
+                // Only called when the buffered bytes hold no complete response
+                LOG_ERROR("Client: Server sent more than " << ReceiveBuffer::DEFAULT_MAX_SIZE
+                                                           << " bytes without completing a response.");
+                return false;
+            }
+            ssize_t nbytes = recv(socket_fd_, dest, recv_buf_.writable(), 0);
+            if (nbytes > 0) {
+                recv_buf_.commit(static_cast<std::size_t>(nbytes));
+                return true;
+            }
+            if (nbytes == 0) { // peer closed connection
+                return false;
+            }
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR("Client: recv: " << strerror(errno));
+            return false;
+        }
+    }
+
+    std::optional<std::string_view> TcpClient::read_line_from_server(bool &success) {
         success = true;
 
         while (true) {
             // First check if we already have a full line in recv_buf_
-            auto nl = std::find(recv_buf_.begin(), recv_buf_.end(), '\n');
-            if (nl != recv_buf_.end()) {
-                std::string line(recv_buf_.begin(), nl);
-                recv_buf_.erase(recv_buf_.begin(), nl + 1);
-                return line;
+            std::string_view data = recv_buf_.data();
+            std::size_t nl = data.find('\n');
+            if (nl != std::string_view::npos) {
+                recv_buf_.consume(nl + 1); // Consumed bytes stay in place until the next receive
+                return data.substr(0, nl);
             }
 
             // More data needed from server
-            ssize_t nbytes = recv(socket_fd_, temp, BUF_SIZE, 0);
-            if (nbytes > 0) {
-                recv_buf_.append(temp, static_cast<std::size_t>(nbytes));
-            } else if (nbytes == 0) { // peer closed connection
-                success = false;
-                return std::nullopt;
-            } else { // error
-                if (errno == EINTR)
-                    continue;
-                perror("Client: recv");
+            if (!receive_more()) {
                 success = false;
                 return std::nullopt;
             }
@@ -149,7 +566,7 @@ namespace Client {
             if (sent_this_call < 0) {
                 if (errno == EINTR)
                     continue; // Interrupted by signal, try again
-                perror("Client: send_all failed");
+                LOG_ERROR("Client: send_all failed: " << strerror(errno));
                 connected_ = false;
                 return false;
             }
@@ -164,7 +581,9 @@ namespace Client {
             close(socket_fd_);
             socket_fd_ = -1;
             connected_ = false;
-            std::cout << "Client: Disconnected from server." << std::endl;
+            recv_buf_.clear();
+            outstanding_.clear();
+            LOG_INFO("Client: Disconnected from server.");
         }
     }
 
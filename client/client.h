@@ -1,12 +1,45 @@
 #pragma once
 
 #include "common/ellipse.h"
+#include "common/protocol.h"
+#include "common/receive_buffer.h"
 #include "ellipse_generator.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace Client {
 
+    /**
+     * @brief A simulation result received from the server.
+     */
+    struct ServerResponse {
+        uint32_t sequence; // Sequence number of the request it answers
+        double covered_area;
+        double percentage_covered;
+    };
+
+    /**
+     * @brief An estimate the server sent while still refining it (see the stream_ms option).
+     */
+    struct PartialResult {
+        uint32_t sequence; // Sequence number of the request being estimated
+        double covered_area;
+        double percentage_covered;
+        double interval_low; // Confidence interval of covered_area, in units²
+        double interval_high;
+        long long samples;   // Points sampled so far
+    };
+
+    /**
+     * @brief Called with each partial result, on the thread waiting for the final response.
+     */
+    using PartialCallback = std::function<void(const PartialResult &partial)>;
+
     /**
      * @brief Manages client-side operations including connecting to server and sending ellipses.
      */
@@ -16,8 +49,9 @@ namespace Client {
          * @brief Constructor.
          * @param host The server hostname or IP address.
          * @param port The server port number.
+         * @param format The wire format to speak; binary is negotiated with a handshake on connect.
          */
-        TcpClient(const std::string &host, int port);
+        TcpClient(const std::string &host, int port, Protocol::WireFormat format = Protocol::WireFormat::Text);
 
         /**
          * @brief Destructor. Closes connection if open.
@@ -30,6 +64,23 @@ namespace Client {
          */
         bool connect_to_server();
 
+        /**
+         * @brief Sets estimate options ("key=value ...", e.g. "engine=scanline") for all later requests.
+         * Binary clients send them once in an Options frame; text clients append them to every line.
+         * @param options The options; an empty string restores the server defaults for text clients.
+         * @return True on success, false otherwise.
+         */
+        bool set_request_options(const std::string &options);
+
+        /**
+         * @brief Resumes (or starts) the server-side session saved under a token.
+         * Must be called before any ellipse is sent. The server keeps the ellipses of answered
+         * requests under the token, so after a reconnect only the remaining ones need to be sent.
+         * @param token The session token: 1 to 64 characters of [A-Za-z0-9_-].
+         * @return The number of ellipses the server restored, or std::nullopt on failure.
+         */
+        std::optional<uint64_t> resume_session(const std::string &token);
+
         /**
          * @brief Sends an ellipse to the server and waits for a response.
          * @param ellipse The ellipse to send.
@@ -37,32 +88,129 @@ namespace Client {
          */
         bool send_ellipse_and_get_response(const Ellipse &ellipse);
 
+        /**
+         * @brief Sends an ellipse without waiting for its response.
+         * Any number of requests may be in flight; collect their results with receive_response().
+         * @param ellipse The ellipse to send.
+         * @return The sequence number of the request, or std::nullopt on failure.
+         */
+        std::optional<uint32_t> submit_ellipse(const Ellipse &ellipse);
+
+        /**
+         * @brief Sends many ellipses as one request; the server adds them all and runs a single estimate.
+         * Requires the binary protocol.
+         * @param ellipses The ellipses to send, at most Protocol::MAX_BATCH_ELLIPSES (MAX_ROTATED_BATCH_ELLIPSES if any is rotated).
+         * @return The sequence number of the request, or std::nullopt on failure.
+         */
+        std::optional<uint32_t> submit_batch(const std::vector<Ellipse> &ellipses);
+
+        /**
+         * @brief Asks the server to add every ellipse of a file in its data directory, then estimate once.
+         * The file is read by the server, so nothing but the path crosses the network.
+         * @param path The path of an ellipse file (see EllipseFile), relative to the server's data directory.
+         * @return The sequence number of the request, or std::nullopt on failure.
+         */
+        std::optional<uint32_t> submit_file(const std::string &path);
+
+        /**
+         * @brief Asks the server to remove an ellipse, then estimate again.
+         * @param id The id of the ellipse: the number of ellipses the session added before it (see Protocol::ELLIPSE_ID_SIZE).
+         * @return The sequence number of the request, or std::nullopt on failure.
+         */
+        std::optional<uint32_t> submit_removal(uint64_t id);
+
+        /**
+         * @brief Asks the server to replace an ellipse, keeping its id, then estimate again.
+         * @param id The id of the ellipse.
+         * @param ellipse The new ellipse.
+         * @return The sequence number of the request, or std::nullopt on failure.
+         */
+        std::optional<uint32_t> submit_update(uint64_t id, const Ellipse &ellipse);
+
+        /**
+         * @brief Waits for the response to the oldest request in flight.
+         * @return The response, or std::nullopt on error, disconnect or a sequence mismatch.
+         */
+        std::optional<ServerResponse> receive_response();
+
+        /**
+         * @brief Sets the function that receives partial results.
+         * The server only streams them for requests with the stream_ms option; they arrive
+         * while receive_response() waits for the final result of the same request.
+         * @param callback The function, or an empty one to drop partial results.
+         */
+        void set_partial_callback(PartialCallback callback);
+
+        /**
+         * @brief Gets the number of requests still waiting for a response.
+         * @return The count of outstanding requests.
+         */
+        size_t get_outstanding_count() const;
+
         /**
          * @brief Closes the connection to the server.
          */
         void disconnect();
 
     private:
+        /**
+         * @brief Checks that the server can take rotated ellipses, logging why not otherwise.
+         * @param rotated Whether the request holds a rotated ellipse.
+         * @return False if it does and the server speaks binary protocol version 2.
+         */
+        bool can_send_rotation(bool rotated) const;
+
         /**
          * @brief Sends ellipse data to the server.
          * @param ellipse The ellipse to send.
+         * @param sequence The sequence number of the request (binary protocol only).
          * @return True on success, false otherwise.
          */
-        bool transmit_ellipse_data(const Ellipse &ellipse);
+        bool transmit_ellipse_data(const Ellipse &ellipse, uint32_t sequence);
+
+        /**
+         * @brief Sends a request that is a binary frame or a text command line.
+         * @param sequence The sequence number of the request.
+         * @param frame The frame, used by binary clients.
+         * @param line The command without options or newline, used by text clients.
+         * @return The sequence number, or std::nullopt on failure.
+         */
+        std::optional<uint32_t> submit_message(uint32_t sequence, const std::string &frame, std::string line);
 
         /**
          * @brief Reads the server's response.
-         * Reads two lines: area and percentage.
+         * Reads two lines (area and percentage) or one result frame, passing any partial
+         * results before them to the partial callback.
+         * @param response Receives the result; its sequence is only overwritten by binary frames.
          * @return True if response read successfully, false otherwise.
          */
-        bool receive_server_response();
+        bool receive_server_response(ServerResponse &response);
+
+        /**
+         * @brief Performs the binary protocol handshake.
+         * @return True if the server accepted a protocol version, false otherwise.
+         */
+        bool perform_handshake();
+
+        /**
+         * @brief Reads one binary frame from the server socket.
+         * @param frame Receives the frame; its payload stays valid until the next read.
+         * @return True if a frame was read, false on error, malformed data or disconnect.
+         */
+        bool read_frame_from_server(Protocol::Frame &frame);
+
+        /**
+         * @brief Receives more bytes from the server into recv_buf_.
+         * @return True if bytes were received, false on error, disconnect or a full buffer.
+         */
+        bool receive_more();
 
         /**
          * @brief Reads a line of text from the server socket.
          * @param success Reference to a boolean flag, set to false on read error or disconnect.
-         * @return The line read (without newline), or std::nullopt on error/disconnect.
+         * @return The line read (without newline), valid until the next read, or std::nullopt on error/disconnect.
          */
-        std::optional<std::string> read_line_from_server(bool &success);
+        std::optional<std::string_view> read_line_from_server(bool &success);
 
         /**
          * @brief Sends a complete message buffer over the socket.
@@ -76,8 +224,14 @@ namespace Client {
         std::string host_;
         int port_;
         int socket_fd_;
-        std::string recv_buf_;
+        ReceiveBuffer recv_buf_;
         bool connected_;
+        Protocol::WireFormat format_;
+        uint8_t protocol_version_; // Negotiated binary protocol version
+        uint32_t next_sequence_;
+        std::deque<uint32_t> outstanding_; // Sequence numbers of requests in flight, oldest first
+        std::string text_options_;         // Appended to every text ellipse line
+        PartialCallback partial_callback_;
     };
 
 } // namespace Client
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "client.h"
 #include "ellipse_generator.h"
-#include <iostream>
+#include "common/ellipse_file.h"
+#include "common/logger.h"
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -9,15 +11,190 @@ const int DEFAULT_SERVER_PORT = 12345;
 const std::string DEFAULT_SERVER_HOST = "127.0.0.1";
 const unsigned int DEFAULT_SEED = 42;
 const int DEFAULT_NUM_ELLIPSES = 10;
+const std::string DEFAULT_PROTOCOL = "text";
+const std::string DEFAULT_MODE = "sync";
+const size_t PIPELINE_WINDOW = 128; // Max requests in flight in pipeline mode
+
+// Logs the partial results the server streams for requests with the stream_ms option.
+void log_partial_results(Client::TcpClient &client) {
+    client.set_partial_callback([](const Client::PartialResult &partial) {
+        LOG_INFO("Request #" << partial.sequence << ": covered area " << partial.covered_area << " in ["
+                 << partial.interval_low << ", " << partial.interval_high << "] after " << partial.samples << " samples");
+    });
+}
+
+// Sends one ellipse at a time and waits for each response.
+bool run_sync(Client::TcpClient &client, Client::EllipseGenerator &generator, int num_ellipses) {
+    for (int i = 0; i < num_ellipses; ++i) {
+        Ellipse e = generator.generate_ellipse();
+        LOG_DEBUG("\n--- Sending Ellipse " << i + 1 << "/" << num_ellipses << " ---");
+        if (!client.send_ellipse_and_get_response(e)) {
+            LOG_ERROR("Error during communication for ellipse " << i + 1 << ".");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Keeps up to PIPELINE_WINDOW ellipses in flight instead of waiting for each response.
+bool run_pipelined(Client::TcpClient &client, Client::EllipseGenerator &generator, int num_ellipses) {
+    for (int i = 0; i < num_ellipses; ++i) {
+        if (client.get_outstanding_count() >= PIPELINE_WINDOW && !client.receive_response()) {
+            LOG_ERROR("Error while receiving pipelined responses.");
+            return false;
+        }
+        if (!client.submit_ellipse(generator.generate_ellipse())) {
+            LOG_ERROR("Error during communication for ellipse " << i + 1 << ".");
+            return false;
+        }
+    }
+    while (client.get_outstanding_count() > 0) {
+        if (!client.receive_response()) {
+            LOG_ERROR("Error while receiving pipelined responses.");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sends all ellipses as batches; the server estimates once per batch.
+bool run_batched(Client::TcpClient &client, Client::EllipseGenerator &generator, int num_ellipses) {
+    int sent = 0;
+    while (sent < num_ellipses) {
+        int batch_size = std::min(num_ellipses - sent, static_cast<int>(Protocol::MAX_BATCH_ELLIPSES));
+        std::vector<Ellipse> batch;
+        batch.reserve(batch_size);
+        for (int i = 0; i < batch_size; ++i) {
+            batch.push_back(generator.generate_ellipse());
+        }
+        if (!client.submit_batch(batch) || !client.receive_response()) {
+            LOG_ERROR("Error during communication for batch starting at ellipse " << sent + 1 << ".");
+            return false;
+        }
+        sent += batch_size;
+    }
+    return true;
+}
+
+// Sends the ellipses one at a time, then moves every one of them and removes every other one,
+// as an interactive editor would. Ids count from the first ellipse of the session.
+bool run_edits(Client::TcpClient &client, Client::EllipseGenerator &generator, int num_ellipses, int first_id) {
+    if (!run_sync(client, generator, num_ellipses)) {
+        return false;
+    }
+    const uint64_t end_id = static_cast<uint64_t>(first_id) + static_cast<uint64_t>(num_ellipses);
+    for (uint64_t id = 0; id < end_id; ++id) {
+        if (!client.submit_update(id, generator.generate_ellipse()) || !client.receive_response()) {
+            LOG_ERROR("Error while moving ellipse " << id << ".");
+            return false;
+        }
+    }
+    for (uint64_t id = 0; id < end_id; id += 2) {
+        if (!client.submit_removal(id) || !client.receive_response()) {
+            LOG_ERROR("Error while removing ellipse " << id << ".");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes generated ellipses to an ellipse file for servers to load in bulk.
+int run_export(int argc, char *argv[]) {
+    if (argc < 3 || argc > 5) {
+        LOG_ERROR("Usage: " << argv[0] << " export <file> [seed] [num_ellipses]");
+        return 1;
+    }
+    unsigned int seed = DEFAULT_SEED;
+    long long num_ellipses = DEFAULT_NUM_ELLIPSES;
+    try {
+        if (argc >= 4)
+            seed = static_cast<unsigned int>(std::stoul(argv[3]));
+        if (argc >= 5)
+            num_ellipses = std::stoll(argv[4]);
+    } catch (const std::exception &e) {
+        LOG_ERROR("Invalid argument. " << e.what());
+        return 1;
+    }
+    if (num_ellipses <= 0) {
+        LOG_ERROR("Number of ellipses must be positive.");
+        return 1;
+    }
+
+    Client::EllipseGenerator generator(seed);
+    std::vector<Ellipse> ellipses(static_cast<std::size_t>(num_ellipses));
+    for (Ellipse &ellipse : ellipses) {
+        ellipse = generator.generate_ellipse();
+    }
+    std::string error;
+    if (!EllipseFile::save(argv[2], ellipses, error)) {
+        LOG_ERROR(error);
+        return 1;
+    }
+    LOG_INFO("Wrote " << num_ellipses << " ellipse(s) with seed " << seed << " to " << argv[2]);
+    return 0;
+}
+
+// Asks the server to load an ellipse file from its data directory and prints the estimate.
+int run_load(int argc, char *argv[]) {
+    if (argc < 3 || argc > 7) {
+        LOG_ERROR("Usage: " << argv[0] << " load <file> [host] [port] [text|binary] [\"key=value ...\"]");
+        return 1;
+    }
+    std::string host = argc >= 4 ? argv[3] : DEFAULT_SERVER_HOST;
+    int port = DEFAULT_SERVER_PORT;
+    try {
+        if (argc >= 5)
+            port = std::stoi(argv[4]);
+    } catch (const std::exception &e) {
+        LOG_ERROR("Invalid argument. " << e.what());
+        return 1;
+    }
+    std::string protocol = argc >= 6 ? argv[5] : DEFAULT_PROTOCOL;
+    if (protocol != "text" && protocol != "binary") {
+        LOG_ERROR("Protocol must be 'text' or 'binary'.");
+        return 1;
+    }
+    std::string options = argc >= 7 ? argv[6] : "";
+
+    Client::TcpClient client(host, port, protocol == "binary" ? Protocol::WireFormat::Binary : Protocol::WireFormat::Text);
+    log_partial_results(client);
+    if (!client.connect_to_server() || (!options.empty() && !client.set_request_options(options))) {
+        LOG_ERROR("Failed to connect to server.");
+        return 1;
+    }
+    std::optional<Client::ServerResponse> response;
+    if (!client.submit_file(argv[2]) || !(response = client.receive_response())) {
+        LOG_ERROR("Failed to load " << argv[2] << " on the server.");
+        return 1;
+    }
+    LOG_INFO("Loaded " << argv[2] << ": covered area " << response->covered_area << ", "
+             << response->percentage_covered << "% of the canvas");
+    client.disconnect();
+    return 0;
+}
 
 int main(int argc, char *argv[]) {
+    if (argc >= 2 && std::string(argv[1]) == "export") {
+        return run_export(argc, argv);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "load") {
+        return run_load(argc, argv);
+    }
+
     std::string host = DEFAULT_SERVER_HOST;
     int port = DEFAULT_SERVER_PORT;
     unsigned int seed = DEFAULT_SEED;
     int num_ellipses = DEFAULT_NUM_ELLIPSES;
+    std::string protocol = DEFAULT_PROTOCOL;
+    std::string mode = DEFAULT_MODE;
+    std::string options;
+    std::string session_token;
 
-    if (argc > 5) {
-        std::cerr << "Usage: " << argv[0] << " [host] [port] [seed] [num_ellipses]" << std::endl;
+    if (argc > 9) {
+        LOG_ERROR("Usage: " << argv[0] << " [host] [port] [seed] [num_ellipses] [text|binary] [sync|pipeline|batch|edit] [\"key=value ...\"]"
+                  << " [session_token]");
+        LOG_ERROR("       " << argv[0] << " export <file> [seed] [num_ellipses]");
+        LOG_ERROR("       " << argv[0] << " load <file> [host] [port] [text|binary] [\"key=value ...\"]");
         return 1;
     }
 
@@ -27,7 +204,7 @@ int main(int argc, char *argv[]) {
         if (argc >= 3) {
             port = std::stoi(argv[2]);
             if (port <= 0 || port > 65535) {
-                std::cerr << "Error: Port number must be between 1 and 65535." << std::endl;
+                LOG_ERROR("Port number must be between 1 and 65535.");
                 return 1;
             }
         }
@@ -37,38 +214,87 @@ int main(int argc, char *argv[]) {
         if (argc >= 5) {
             num_ellipses = std::stoi(argv[4]);
             if (num_ellipses <= 0) {
-                std::cerr << "Error: Number of ellipses must be positive." << std::endl;
+                LOG_ERROR("Number of ellipses must be positive.");
+                return 1;
+            }
+        }
+        if (argc >= 6) {
+            protocol = argv[5];
+            if (protocol != "text" && protocol != "binary") {
+                LOG_ERROR("Protocol must be 'text' or 'binary'.");
+                return 1;
+            }
+        }
+        if (argc >= 7) {
+            mode = argv[6];
+            if (mode != "sync" && mode != "pipeline" && mode != "batch" && mode != "edit") {
+                LOG_ERROR("Mode must be 'sync', 'pipeline', 'batch' or 'edit'.");
+                return 1;
+            }
+            if (mode == "batch" && protocol != "binary") {
+                LOG_ERROR("Batch mode requires the binary protocol.");
                 return 1;
             }
         }
+        if (argc >= 8) {
+            options = argv[7];
+        }
+        if (argc >= 9) {
+            session_token = argv[8];
+        }
     } catch (const std::invalid_argument &e) {
-        std::cerr << "Error: Invalid argument type provided. " << e.what() << std::endl;
+        LOG_ERROR("Invalid argument type provided. " << e.what());
         return 1;
     } catch (const std::out_of_range &e) {
-        std::cerr << "Error: Argument value out of range. " << e.what() << std::endl;
+        LOG_ERROR("Argument value out of range. " << e.what());
         return 1;
     }
 
-    std::cout << "Client configured with:" << std::endl;
-    std::cout << "  Host: " << host << std::endl;
-    std::cout << "  Port: " << port << std::endl;
-    std::cout << "  Seed: " << seed << std::endl;
-    std::cout << "  Number of Ellipses: " << num_ellipses << std::endl;
+    LOG_INFO("Client configured with:");
+    LOG_INFO("  Host: " << host);
+    LOG_INFO("  Port: " << port);
+    LOG_INFO("  Seed: " << seed);
+    LOG_INFO("  Number of Ellipses: " << num_ellipses);
+    LOG_INFO("  Protocol: " << protocol);
+    LOG_INFO("  Mode: " << mode);
+    LOG_INFO("  Options: " << (options.empty() ? "(server defaults)" : options));
+    LOG_INFO("  Session: " << (session_token.empty() ? "(none)" : session_token));
 
-    Client::TcpClient client(host, port);
+    Client::TcpClient client(host, port, protocol == "binary" ? Protocol::WireFormat::Binary : Protocol::WireFormat::Text);
+    log_partial_results(client);
     if (!client.connect_to_server()) {
-        std::cerr << "Failed to connect to server." << std::endl;
+        LOG_ERROR("Failed to connect to server.");
+        return 1;
+    }
+    if (!options.empty() && !client.set_request_options(options)) {
+        LOG_ERROR("Failed to send request options.");
         return 1;
     }
 
     Client::EllipseGenerator generator(seed);
-    for (int i = 0; i < num_ellipses; ++i) {
-        Ellipse e = generator.generate_ellipse();
-        std::cout << "\n--- Sending Ellipse " << i + 1 << "/" << num_ellipses << " ---" << std::endl;
-        if (!client.send_ellipse_and_get_response(e)) {
-            std::cerr << "Error during communication for ellipse " << i + 1 << "." << std::endl;
-            break;
+    int skipped = 0;
+    if (!session_token.empty()) {
+        std::optional<uint64_t> restored = client.resume_session(session_token);
+        if (!restored) {
+            LOG_ERROR("Failed to resume session " << session_token << ".");
+            return 1;
         }
+        // The same seed regenerates the same sequence; skip what the server already has
+        skipped = static_cast<int>(std::min<uint64_t>(*restored, static_cast<uint64_t>(num_ellipses)));
+        for (int i = 0; i < skipped; ++i) {
+            generator.generate_ellipse();
+        }
+        num_ellipses -= skipped;
+        LOG_INFO("Resuming after " << skipped << " ellipse(s); " << num_ellipses << " left to send.");
+    }
+    if (mode == "pipeline") {
+        run_pipelined(client, generator, num_ellipses);
+    } else if (mode == "batch") {
+        run_batched(client, generator, num_ellipses);
+    } else if (mode == "edit") {
+        run_edits(client, generator, num_ellipses, skipped);
+    } else {
+        run_sync(client, generator, num_ellipses);
     }
 
     client.disconnect();
@@ -10,17 +10,17 @@ namespace Canvas {
      * @brief Gets the width of the canvas.
      * @return The width.
      */
-    inline double get_width() { return MAX_X - MIN_X; }
+    constexpr double get_width() { return MAX_X - MIN_X; }
 
     /**
      * @brief Gets the height of the canvas.
      * @return The height.
      */
-    inline double get_height() { return MAX_Y - MIN_Y; }
+    constexpr double get_height() { return MAX_Y - MIN_Y; }
 
     /**
      * @brief Gets the total area of the canvas.
      * @return The total area in units squared.
      */
-    inline double get_area() { return get_width() * get_height(); }
+    constexpr double get_area() { return get_width() * get_height(); }
 } // namespace Canvas
\ No newline at end of file
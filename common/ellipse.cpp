@@ -1,10 +1,76 @@
 #include "ellipse.h"
+#include <cmath>
 
 bool Ellipse::is_inside(double x_coord, double y_coord) const {
     if (a <= 0 || b <= 0) {
         return false;
     }
-    double term_x = (x_coord - cx) / a;
-    double term_y = (y_coord - cy) / b;
+    double u, v;
+    to_axes(x_coord, y_coord, u, v);
+    double term_x = u / a;
+    double term_y = v / b;
     return (term_x * term_x + term_y * term_y) <= 1.0;
-}
\ No newline at end of file
+}
+
+void Ellipse::to_axes(double x_coord, double y_coord, double &u, double &v) const {
+    const double dx = x_coord - cx;
+    const double dy = y_coord - cy;
+    if (angle == 0.0) {
+        u = dx;
+        v = dy;
+        return;
+    }
+    const double c = std::cos(angle);
+    const double s = std::sin(angle);
+    u = dx * c + dy * s;
+    v = dy * c - dx * s;
+}
+
+double Ellipse::get_half_width() const {
+    if (angle == 0.0) {
+        return a;
+    }
+    const double c = std::cos(angle);
+    const double s = std::sin(angle);
+    return std::sqrt(a * a * c * c + b * b * s * s);
+}
+
+double Ellipse::get_half_height() const {
+    if (angle == 0.0) {
+        return b;
+    }
+    const double c = std::cos(angle);
+    const double s = std::sin(angle);
+    return std::sqrt(a * a * s * s + b * b * c * c);
+}
+
+bool Ellipse::get_chord(double y_coord, double &left, double &right) const {
+    const double dy = y_coord - cy;
+    if (angle == 0.0) {
+        const double t = dy / b;
+        if (t * t > 1.0) {
+            return false;
+        }
+        const double half_chord = a * std::sqrt(1.0 - t * t);
+        left = cx - half_chord;
+        right = cx + half_chord;
+        return true;
+    }
+
+    // Solve p·dx² + q·dx + r = 1 for dx, the boundary's offsets from the center on this row
+    const double c = std::cos(angle);
+    const double s = std::sin(angle);
+    const double inv_a2 = 1.0 / (a * a);
+    const double inv_b2 = 1.0 / (b * b);
+    const double p = c * c * inv_a2 + s * s * inv_b2;
+    const double q = 2.0 * c * s * (inv_a2 - inv_b2) * dy;
+    const double r = (s * s * inv_a2 + c * c * inv_b2) * dy * dy;
+    const double discriminant = q * q - 4.0 * p * (r - 1.0);
+    if (discriminant < 0.0) {
+        return false;
+    }
+    const double root = std::sqrt(discriminant);
+    left = cx + (-q - root) / (2.0 * p);
+    right = cx + (-q + root) / (2.0 * p);
+    return true;
+}
@@ -4,16 +4,48 @@
  * @brief Represents an ellipse in a 2D plane.
  */
 struct Ellipse {
-    double cx, cy; // Center coordinates
-    double a, b;   // Axes lengths (horizontal a, vertical b)
+    double cx, cy;      // Center coordinates
+    double a, b;        // Semi-axis lengths (a along the rotated x-axis, b along the rotated y-axis)
+    double angle = 0.0; // Counter-clockwise rotation of the a axis from the x-axis, in radians
 
     /**
      * @brief Checks if a given point (x, y) is inside or on the boundary of the ellipse.
-     * The point (x,y) is inside if ((x-cx)/a)^2 + ((y-cy)/b)^2 <= 1.
-     * Assumes a > 0 and b > 0.
+     * With (u, v) the point's offset from the center along the ellipse's axes, the point
+     * is inside if (u/a)^2 + (v/b)^2 <= 1. Assumes a > 0 and b > 0.
      * @param x_coord The x-coordinate of the point.
      * @param y_coord The y-coordinate of the point.
      * @return True if the point is inside or on the ellipse, false otherwise.
      */
     bool is_inside(double x_coord, double y_coord) const;
-};
\ No newline at end of file
+
+    /**
+     * @brief Gets a point's offset from the center along the ellipse's own axes.
+     * Without rotation this is just (x - cx, y - cy).
+     * @param x_coord The x-coordinate of the point.
+     * @param y_coord The y-coordinate of the point.
+     * @param u Receives the offset along the a axis.
+     * @param v Receives the offset along the b axis.
+     */
+    void to_axes(double x_coord, double y_coord, double &u, double &v) const;
+
+    /**
+     * @brief Gets half the width of the axis-aligned bounding box.
+     * @return The largest horizontal distance from the center to the boundary.
+     */
+    double get_half_width() const;
+
+    /**
+     * @brief Gets half the height of the axis-aligned bounding box.
+     * @return The largest vertical distance from the center to the boundary.
+     */
+    double get_half_height() const;
+
+    /**
+     * @brief Intersects the ellipse with a horizontal line.
+     * @param y_coord The y-coordinate of the line.
+     * @param left Receives the x-coordinate where the line enters the ellipse.
+     * @param right Receives the x-coordinate where the line leaves the ellipse.
+     * @return True if the line crosses the ellipse, false otherwise (left and right are then unset).
+     */
+    bool get_chord(double y_coord, double &left, double &right) const;
+};
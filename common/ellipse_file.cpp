@@ -0,0 +1,133 @@
+#include "ellipse_file.h"
+#include "protocol.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace EllipseFile {
+
+    namespace {
+        void put_uint(std::string &out, uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; ++i) {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        uint64_t get_uint(const char *data, int bytes) {
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        // Doubles per ellipse record in a given file version
+        std::size_t record_doubles(uint32_t version) {
+            return version >= 2 ? 5 : 4;
+        }
+    } // namespace
+
+    bool save(const std::string &path, const std::vector<Ellipse> &ellipses, std::string &error) {
+        std::string data(MAGIC, sizeof(MAGIC));
+        put_uint(data, VERSION, 4);
+        put_uint(data, ellipses.size(), 8);
+        data.reserve(HEADER_SIZE + ellipses.size() * record_doubles(VERSION) * sizeof(double));
+        for (const Ellipse &ellipse : ellipses) {
+            const double values[5] = {ellipse.cx, ellipse.cy, ellipse.a, ellipse.b, ellipse.angle};
+            Protocol::append_doubles(data, values, 5);
+        }
+
+        const std::string temp_path = path + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out.write(data.data(), static_cast<std::streamsize>(data.size())) || !out.flush()) {
+                error = "Could not write " + temp_path;
+                std::remove(temp_path.c_str());
+                return false;
+            }
+        }
+        if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            error = "Could not replace " + path + ". " + strerror(errno);
+            std::remove(temp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool load(const std::string &path, std::vector<Ellipse> &ellipses, std::string &error) {
+        MappedFile file;
+        if (!file.open(path, error)) {
+            return false;
+        }
+        ellipses.resize(file.size());
+        file.read(0, file.size(), ellipses.data());
+        return true;
+    }
+
+    MappedFile::~MappedFile() {
+        if (data_) {
+            munmap(const_cast<char *>(data_), length_);
+        }
+    }
+
+    bool MappedFile::open(const std::string &path, std::string &error) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = "Could not open " + path + ". " + strerror(errno);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) < 0 || static_cast<std::size_t>(info.st_size) < HEADER_SIZE) {
+            error = path + " is too short to be an ellipse file";
+            close(fd);
+            return false;
+        }
+
+        const std::size_t length = static_cast<std::size_t>(info.st_size);
+        void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // The mapping stays valid without the descriptor
+        if (mapping == MAP_FAILED) {
+            error = "Could not map " + path + ". " + strerror(errno);
+            return false;
+        }
+
+        const char *data = static_cast<const char *>(mapping);
+        const uint32_t version = static_cast<uint32_t>(get_uint(data + 4, 4));
+        const uint64_t count = get_uint(data + 8, 8);
+        const std::size_t record_size = record_doubles(version) * sizeof(double);
+        bool valid = std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0 && version >= MIN_VERSION && version <= VERSION &&
+                     count == (length - HEADER_SIZE) / record_size && (length - HEADER_SIZE) % record_size == 0;
+        if (!valid) {
+            error = path + " is not a valid ellipse file";
+            munmap(mapping, length);
+            return false;
+        }
+
+        madvise(mapping, length, MADV_SEQUENTIAL); // Only a hint; records are read front to back
+        if (data_) {
+            munmap(const_cast<char *>(data_), length_);
+        }
+        data_ = data;
+        length_ = length;
+        count_ = static_cast<std::size_t>(count);
+        record_doubles_ = record_doubles(version);
+        return true;
+    }
+
+    void MappedFile::read(std::size_t first, std::size_t count, Ellipse *out) const {
+        const std::size_t record_size = record_doubles_ * sizeof(double);
+        const char *record = data_ + HEADER_SIZE + first * record_size;
+        for (std::size_t i = 0; i < count; ++i, record += record_size) {
+            double values[5] = {};
+            Protocol::decode_doubles(record, values, record_doubles_);
+            out[i] = {values[0], values[1], values[2], values[3], values[4]};
+        }
+    }
+
+} // namespace EllipseFile
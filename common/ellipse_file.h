@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ellipse.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Compact binary file of ellipses, used for session snapshots and bulk loads.
+ *
+ * Layout, little-endian like the wire protocol:
+ *   4 bytes magic "ELPS" | u32 version | u64 ellipse count | count x (cx, cy, a, b, angle) doubles
+ * The 16-byte header keeps the doubles 8-byte aligned when the file is memory-mapped.
+ * Version 1 files, written before ellipses could be rotated, lack the angle and still load.
+ */
+namespace EllipseFile {
+    constexpr char MAGIC[4] = {'E', 'L', 'P', 'S'};
+    constexpr uint32_t VERSION = 2;     // Version 2 added the rotation angle
+    constexpr uint32_t MIN_VERSION = 1; // Oldest version still read
+    constexpr std::size_t HEADER_SIZE = 16;
+    constexpr const char *EXTENSION = ".ellipses";
+
+    /**
+     * @brief Writes ellipses to a file, replacing it atomically.
+     * The data goes to a temporary file that is renamed over the target, so readers
+     * see either the old or the new contents, never a partial file.
+     * @param path The file path.
+     * @param ellipses The ellipses.
+     * @param error Receives a description of the problem on failure.
+     * @return True on success, false otherwise.
+     */
+    bool save(const std::string &path, const std::vector<Ellipse> &ellipses, std::string &error);
+
+    /**
+     * @brief Reads an ellipse file through a read-only memory mapping.
+     * @param path The file path.
+     * @param ellipses Receives the ellipses.
+     * @param error Receives a description of the problem on failure.
+     * @return True on success, false if the file cannot be read or is not a valid ellipse file.
+     */
+    bool load(const std::string &path, std::vector<Ellipse> &ellipses, std::string &error);
+
+    /**
+     * @brief Read-only memory mapping of an ellipse file.
+     * Records are decoded straight from the mapping on access, so files with millions of
+     * ellipses are consumed in chunks without first being copied into a vector.
+     */
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        /**
+         * @brief Maps a file and checks its header and size.
+         * @param path The file path.
+         * @param error Receives a description of the problem on failure.
+         * @return True on success, false if the file cannot be mapped or is not a valid ellipse file.
+         */
+        bool open(const std::string &path, std::string &error);
+
+        /**
+         * @brief Gets the number of ellipses in the file.
+         * @return The ellipse count; 0 if no file is open.
+         */
+        std::size_t size() const { return count_; }
+
+        /**
+         * @brief Decodes a range of ellipses.
+         * @param first The index of the first ellipse.
+         * @param count The number of ellipses; first + count must not exceed size().
+         * @param out Receives the ellipses.
+         */
+        void read(std::size_t first, std::size_t count, Ellipse *out) const;
+
+    private:
+        const char *data_ = nullptr;
+        std::size_t length_ = 0;
+        std::size_t count_ = 0;
+        std::size_t record_doubles_ = 0; // Doubles per ellipse in the mapped file's version
+    };
+} // namespace EllipseFile
@@ -0,0 +1,215 @@
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Log {
+
+    namespace {
+        constexpr std::size_t RING_CAPACITY = 8192; // Messages; a power of two
+        constexpr auto IDLE_WAIT = std::chrono::milliseconds(10);
+
+        // Written before each message, so call sites do not repeat the level
+        const char *label_of(Level level) {
+            switch (level) {
+            case Level::Warning:
+                return "Warning: ";
+            case Level::Error:
+                return "Error: ";
+            default:
+                return "";
+            }
+        }
+
+        /**
+         * @brief Bounded multi-producer ring drained by one writer thread.
+         * Each slot carries a sequence number that tells producers and the writer whose turn
+         * it is, so neither side takes a lock (Vyukov's bounded queue).
+         */
+        class AsyncWriter {
+        public:
+            AsyncWriter() : slots_(RING_CAPACITY), enqueue_pos_(0), dequeue_pos_(0), written_(0), stopping_(false), writer_idle_(false) {
+                for (std::size_t i = 0; i < RING_CAPACITY; ++i) {
+                    slots_[i].sequence.store(i, std::memory_order_relaxed);
+                }
+                Level initial = Level::Info;
+                if (const char *name = std::getenv("ELLIPSE_LOG_LEVEL")) {
+                    if (!parse_level(name, initial)) {
+                        std::fprintf(stderr, "Warning: Unknown ELLIPSE_LOG_LEVEL '%s'; logging info and above\n", name);
+                    }
+                }
+                level_.store(static_cast<int>(initial), std::memory_order_relaxed);
+                writer_ = std::thread(&AsyncWriter::run, this);
+            }
+
+            ~AsyncWriter() {
+                {
+                    std::lock_guard<std::mutex> lock(wake_mutex_);
+                    stopping_ = true;
+                }
+                wake_cv_.notify_one();
+                writer_.join();
+            }
+
+            AsyncWriter(const AsyncWriter &) = delete;
+            AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+            std::atomic<int> &level() {
+                return level_;
+            }
+
+            void push(Level level, std::string message) {
+                std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+                Slot *slot;
+                while (true) {
+                    slot = &slots_[pos & (RING_CAPACITY - 1)];
+                    const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                    const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+                    if (difference == 0) {
+                        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (difference < 0) {
+                        // Full: let the writer catch up rather than lose the message
+                        wake_writer();
+                        std::this_thread::yield();
+                        pos = enqueue_pos_.load(std::memory_order_relaxed);
+                    } else {
+                        pos = enqueue_pos_.load(std::memory_order_relaxed);
+                    }
+                }
+                slot->level = level;
+                slot->message = std::move(message);
+                slot->sequence.store(pos + 1, std::memory_order_release);
+
+                if (writer_idle_.load(std::memory_order_relaxed)) {
+                    wake_writer();
+                }
+            }
+
+            void flush() {
+                const std::size_t target = enqueue_pos_.load(std::memory_order_acquire);
+                while (written_.load(std::memory_order_acquire) < target) {
+                    wake_writer();
+                    std::this_thread::yield();
+                }
+            }
+
+        private:
+            struct Slot {
+                std::atomic<std::size_t> sequence;
+                Level level = Level::Debug;
+                std::string message;
+            };
+
+            void wake_writer() {
+                wake_cv_.notify_one();
+            }
+
+            // Moves every message ready in the ring into the output buffers
+            bool drain(std::string &out, std::string &err) {
+                bool any = false;
+                while (true) {
+                    Slot &slot = slots_[dequeue_pos_ & (RING_CAPACITY - 1)];
+                    if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+                        return any;
+                    }
+                    std::string &target = slot.level >= Level::Warning ? err : out;
+                    target += label_of(slot.level);
+                    target += slot.message;
+                    target += '\n';
+                    slot.message = std::string();
+                    slot.sequence.store(dequeue_pos_ + RING_CAPACITY, std::memory_order_release);
+                    ++dequeue_pos_;
+                    any = true;
+                }
+            }
+
+            void run() {
+                std::string out;
+                std::string err;
+                while (true) {
+                    if (drain(out, err)) {
+                        // One write per stream and batch instead of one flush per line
+                        if (!out.empty()) {
+                            std::fwrite(out.data(), 1, out.size(), stdout);
+                            std::fflush(stdout);
+                            out.clear();
+                        }
+                        if (!err.empty()) {
+                            std::fwrite(err.data(), 1, err.size(), stderr);
+                            std::fflush(stderr);
+                            err.clear();
+                        }
+                        written_.store(dequeue_pos_, std::memory_order_release);
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> lock(wake_mutex_);
+                    if (stopping_) {
+                        return; // Nothing left: drain() just came back empty
+                    }
+                    writer_idle_.store(true, std::memory_order_relaxed);
+                    wake_cv_.wait_for(lock, IDLE_WAIT); // The timeout covers a wake-up missed by a producer
+                    writer_idle_.store(false, std::memory_order_relaxed);
+                }
+            }
+
+            std::vector<Slot> slots_;
+            std::atomic<std::size_t> enqueue_pos_;
+            std::size_t dequeue_pos_;           // Only used by the writer thread
+            std::atomic<std::size_t> written_;  // Messages written out so far
+            std::atomic<int> level_;
+            std::mutex wake_mutex_;             // Only guards the writer's sleep, never the ring
+            std::condition_variable wake_cv_;
+            bool stopping_;
+            std::atomic<bool> writer_idle_;
+            std::thread writer_;
+        };
+
+        // Constructed on first use and destroyed at exit, after draining the ring
+        AsyncWriter &writer() {
+            static AsyncWriter instance;
+            return instance;
+        }
+    } // namespace
+
+    void set_level(Level level) {
+        writer().level().store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    Level get_level() {
+        return static_cast<Level>(writer().level().load(std::memory_order_relaxed));
+    }
+
+    bool is_enabled(Level level) {
+        return level != Level::Off && static_cast<int>(level) >= writer().level().load(std::memory_order_relaxed);
+    }
+
+    bool parse_level(const std::string &name, Level &level) {
+        static const std::pair<const char *, Level> names[] = {
+            {"debug", Level::Debug}, {"info", Level::Info}, {"warning", Level::Warning}, {"error", Level::Error}, {"off", Level::Off}};
+        for (const auto &entry : names) {
+            if (name == entry.first) {
+                level = entry.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void write(Level level, std::string message) {
+        writer().push(level, std::move(message));
+    }
+
+    void flush() {
+        writer().flush();
+    }
+
+} // namespace Log
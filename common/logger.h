@@ -0,0 +1,80 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+
+/**
+ * @brief Asynchronous logging shared by client and server.
+ *
+ * Messages are formatted by the calling thread, pushed into a bounded lock-free ring and
+ * written by a background thread in batches, so request paths never wait for a terminal or
+ * pipe. Debug and Info go to stdout, Warning and Error to stderr, prefixed with "Warning: "
+ * and "Error: ". Messages below the current level cost one atomic load: the LOG_* macros
+ * skip formatting entirely.
+ *
+ * The initial level is read from the ELLIPSE_LOG_LEVEL environment variable
+ * (debug, info, warning, error or off) and defaults to info.
+ */
+namespace Log {
+    enum class Level {
+        Debug,   // Per-request traffic
+        Info,    // Lifecycle events and results
+        Warning, // Recoverable problems
+        Error,   // Failed operations
+        Off      // Nothing is logged
+    };
+
+    /**
+     * @brief Sets the lowest level that is logged.
+     * @param level The level; Level::Off disables logging.
+     */
+    void set_level(Level level);
+
+    /**
+     * @brief Gets the lowest level that is logged.
+     * @return The level.
+     */
+    Level get_level();
+
+    /**
+     * @brief Checks whether messages of a level are logged.
+     * @param level The level.
+     * @return True if they are logged, false otherwise.
+     */
+    bool is_enabled(Level level);
+
+    /**
+     * @brief Parses a level name.
+     * @param name "debug", "info", "warning", "error" or "off".
+     * @param level Receives the level.
+     * @return True if the name is known, false otherwise.
+     */
+    bool parse_level(const std::string &name, Level &level);
+
+    /**
+     * @brief Queues a message for the writer thread, regardless of the current level.
+     * Waits for room only while the ring is full.
+     * @param level The level, which selects stdout or stderr.
+     * @param message The message, without trailing newline.
+     */
+    void write(Level level, std::string message);
+
+    /**
+     * @brief Waits until every message queued so far has been written.
+     */
+    void flush();
+} // namespace Log
+
+#define LOG_AT(level, expression)                          \
+    do {                                                   \
+        if (Log::is_enabled(level)) {                      \
+            std::ostringstream log_stream_;                \
+            log_stream_ << expression;                     \
+            Log::write(level, log_stream_.str());          \
+        }                                                  \
+    } while (0)
+
+#define LOG_DEBUG(expression) LOG_AT(Log::Level::Debug, expression)
+#define LOG_INFO(expression) LOG_AT(Log::Level::Info, expression)
+#define LOG_WARNING(expression) LOG_AT(Log::Level::Warning, expression)
+#define LOG_ERROR(expression) LOG_AT(Log::Level::Error, expression)
@@ -0,0 +1,130 @@
+#include "protocol.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace Protocol {
+
+    namespace {
+        void put_u32(std::string &out, uint32_t value) {
+            for (int i = 0; i < 4; ++i) {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        uint32_t get_u32(const char *data) {
+            uint32_t value = 0;
+            for (int i = 0; i < 4; ++i) {
+                value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        void put_f64(std::string &out, double value) {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            for (int i = 0; i < 8; ++i) {
+                out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+            }
+        }
+
+        double get_f64(const char *data) {
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; ++i) {
+                bits |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+            }
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+    } // namespace
+
+    void append_frame(std::string &out, MessageType type, uint32_t sequence, std::string_view payload) {
+        put_u32(out, static_cast<uint32_t>(payload.size()));
+        out.push_back(static_cast<char>(type));
+        put_u32(out, sequence);
+        out += payload;
+    }
+
+    void append_frame(std::string &out, MessageType type, uint32_t sequence, const double *values, std::size_t count) {
+        put_u32(out, static_cast<uint32_t>(count * sizeof(double)));
+        out.push_back(static_cast<char>(type));
+        put_u32(out, sequence);
+        append_doubles(out, values, count);
+    }
+
+    void append_doubles(std::string &out, const double *values, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            put_f64(out, values[i]);
+        }
+    }
+
+    void decode_doubles(const char *data, double *values, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            values[i] = get_f64(data + i * sizeof(double));
+        }
+    }
+
+    std::size_t read_doubles(std::string_view payload, double *values) {
+        if (payload.size() % sizeof(double) != 0) {
+            return 0;
+        }
+        const std::size_t count = payload.size() / sizeof(double);
+        decode_doubles(payload.data(), values, count);
+        return count;
+    }
+
+    bool read_doubles(std::string_view payload, double *values, std::size_t count) {
+        if (payload.size() != count * sizeof(double)) {
+            return false;
+        }
+        decode_doubles(payload.data(), values, count);
+        return true;
+    }
+
+    ParseStatus parse_frame(std::string_view buffer, Frame &frame, std::size_t &consumed) {
+        if (buffer.size() < FRAME_HEADER_SIZE) {
+            return ParseStatus::Incomplete;
+        }
+
+        uint32_t payload_size = get_u32(buffer.data());
+        if (payload_size > MAX_PAYLOAD_SIZE) {
+            return ParseStatus::Invalid;
+        }
+        if (buffer.size() < FRAME_HEADER_SIZE + payload_size) {
+            return ParseStatus::Incomplete;
+        }
+
+        frame.type = static_cast<MessageType>(static_cast<unsigned char>(buffer[4]));
+        frame.sequence = get_u32(buffer.data() + 5);
+        frame.payload = buffer.substr(FRAME_HEADER_SIZE, payload_size);
+        consumed = FRAME_HEADER_SIZE + payload_size;
+        return ParseStatus::Complete;
+    }
+
+    std::string_view next_token(std::string_view &text) {
+        constexpr std::string_view WHITESPACE = " \t\r\n\v\f";
+        std::size_t start = text.find_first_not_of(WHITESPACE);
+        if (start == std::string_view::npos) {
+            text = {};
+            return {};
+        }
+        std::size_t end = text.find_first_of(WHITESPACE, start);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        std::string_view token = text.substr(start, end - start);
+        text.remove_prefix(end);
+        return token;
+    }
+
+    bool parse_double(std::string_view token, double &value) {
+        if (token.size() > 1 && token[0] == '+' && token[1] != '-') {
+            token.remove_prefix(1); // from_chars does not take a plus sign; stream extraction did
+        }
+        const char *end = token.data() + token.size();
+        auto [ptr, ec] = std::from_chars(token.data(), end, value);
+        return ec == std::errc() && ptr == end && std::isfinite(value);
+    }
+
+} // namespace Protocol
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Binary wire protocol shared by client and server.
+ *
+ * A binary session starts with a two-byte handshake [BINARY_MAGIC, version] from the client,
+ * answered by the server with the version it will speak. Since BINARY_MAGIC is not an ASCII
+ * character, the server can tell binary clients from text clients by the first byte.
+ *
+ * After the handshake every message is a frame:
+ *   u32 payload length | u8 message type | u32 sequence number | payload
+ * All integers and IEEE-754 doubles are little-endian. A Result carries the sequence number
+ * of the request it answers, so clients may pipeline requests.
+ */
+namespace Protocol {
+    constexpr uint8_t BINARY_MAGIC = 0xB7;
+    constexpr uint8_t VERSION = 3;     // Version 2 added sequence numbers and batches, version 3 rotated ellipses
+    constexpr uint8_t MIN_VERSION = 2; // Oldest version still accepted
+    constexpr std::size_t HANDSHAKE_SIZE = 2;
+    constexpr std::size_t FRAME_HEADER_SIZE = 9;
+    constexpr uint32_t MAX_PAYLOAD_SIZE = 1 << 20; // Larger frames are rejected as malformed
+    constexpr std::size_t ELLIPSE_SIZE = 4 * sizeof(double);
+    constexpr std::size_t ROTATED_ELLIPSE_SIZE = 5 * sizeof(double); // Adds the rotation angle in radians
+    constexpr std::size_t MAX_BATCH_ELLIPSES = MAX_PAYLOAD_SIZE / ELLIPSE_SIZE;
+    constexpr std::size_t MAX_ROTATED_BATCH_ELLIPSES = MAX_PAYLOAD_SIZE / ROTATED_ELLIPSE_SIZE;
+
+    // Remove and Update frames name ellipses by id: the order the session added them in,
+    // from 0, counting restored and loaded ellipses. Removals do not renumber the others.
+    constexpr std::size_t ELLIPSE_ID_SIZE = sizeof(double);
+    constexpr std::size_t UPDATE_SIZE = ELLIPSE_ID_SIZE + ROTATED_ELLIPSE_SIZE; // One entry of an Update frame
+    constexpr std::size_t UPDATE_SIZE_V2 = ELLIPSE_ID_SIZE + ELLIPSE_SIZE;      // The same in version 2, without the angle
+
+    /**
+     * @brief Wire format of a session.
+     */
+    enum class WireFormat {
+        Text,  // Newline-terminated ASCII lines
+        Binary // Length-prefixed frames
+    };
+
+    /**
+     * @brief Type byte of a frame.
+     */
+    enum class MessageType : uint8_t {
+        Ellipse = 1,      // Client -> server: cx, cy, a, b (4 doubles)
+        Result = 2,       // Server -> client: covered area, percentage covered (2 doubles)
+        Error = 3,        // Server -> client: UTF-8 message; the server closes the connection after it
+        Batch = 4,        // Client -> server: any number of ellipses (4 doubles each), answered by one Result
+        Options = 5,      // Client -> server: "key=value ..." text applied to all later requests; no reply
+        Session = 6,      // Client -> server: session token, before any ellipse; server -> client: restored ellipse count (1 double)
+        Load = 7,         // Client -> server: path of an ellipse file in the server's data directory, answered like a Batch
+        Partial = 8,      // Server -> client: estimate so far, before the Result (area, percentage, interval low, high, samples)
+        Remove = 9,       // Client -> server: ids of ellipses to remove (1 double each), answered like a Batch
+        Update = 10,      // Client -> server: id, cx, cy, a, b, angle of ellipses to replace (6 doubles each; 5 without angle in version 2), answered like a Batch
+        RotatedBatch = 11 // Client -> server, version 3: any number of ellipses (cx, cy, a, b, angle each), answered like a Batch
+    };
+
+    /**
+     * @brief A decoded frame.
+     * The payload is a view into the buffer it was parsed from and is only valid while
+     * that buffer is unchanged.
+     */
+    struct Frame {
+        MessageType type;
+        uint32_t sequence;
+        std::string_view payload;
+    };
+
+    /**
+     * @brief Outcome of trying to parse a frame from a receive buffer.
+     */
+    enum class ParseStatus {
+        Complete,   // A frame was decoded
+        Incomplete, // More bytes are needed
+        Invalid     // The buffer does not start with a valid frame header
+    };
+
+    /**
+     * @brief Appends a frame to an output buffer.
+     * @param out The buffer to append to.
+     * @param type The message type.
+     * @param sequence The sequence number.
+     * @param payload The payload bytes.
+     */
+    void append_frame(std::string &out, MessageType type, uint32_t sequence, std::string_view payload);
+
+    /**
+     * @brief Appends a frame whose payload is a sequence of doubles.
+     * @param out The buffer to append to.
+     * @param type The message type.
+     * @param sequence The sequence number.
+     * @param values The doubles to encode.
+     * @param count The number of doubles.
+     */
+    void append_frame(std::string &out, MessageType type, uint32_t sequence, const double *values, std::size_t count);
+
+    /**
+     * @brief Appends doubles to a buffer in the wire encoding (little-endian IEEE-754).
+     * @param out The buffer to append to.
+     * @param values The doubles to encode.
+     * @param count The number of doubles.
+     */
+    void append_doubles(std::string &out, const double *values, std::size_t count);
+
+    /**
+     * @brief Decodes doubles in the wire encoding from raw bytes.
+     * @param data The encoded bytes; must hold count * 8 bytes.
+     * @param values Receives the decoded doubles.
+     * @param count The number of doubles.
+     */
+    void decode_doubles(const char *data, double *values, std::size_t count);
+
+    /**
+     * @brief Decodes doubles from a payload.
+     * @param payload The payload bytes.
+     * @param values Receives the decoded doubles; must hold payload.size() / 8 values.
+     * @return The number of doubles decoded, or 0 if the payload size is not a multiple of 8.
+     */
+    std::size_t read_doubles(std::string_view payload, double *values);
+
+    /**
+     * @brief Decodes a payload made of exactly count doubles.
+     * @param payload The payload bytes.
+     * @param values Receives the decoded doubles.
+     * @param count The expected number of doubles.
+     * @return True if the payload has the expected size, false otherwise.
+     */
+    bool read_doubles(std::string_view payload, double *values, std::size_t count);
+
+    /**
+     * @brief Tries to parse one frame from the start of a buffer.
+     * @param buffer The received bytes.
+     * @param frame Receives the frame on success; its payload points into buffer.
+     * @param consumed Receives the number of bytes the frame occupied on success.
+     * @return The parse status.
+     */
+    ParseStatus parse_frame(std::string_view buffer, Frame &frame, std::size_t &consumed);
+
+    /**
+     * @brief Splits the next whitespace-separated token off the front of a text line.
+     * @param text The remaining text; advanced past the token.
+     * @return The token, or an empty view if only whitespace was left.
+     */
+    std::string_view next_token(std::string_view &text);
+
+    /**
+     * @brief Parses a token that must be exactly one finite number, without allocating.
+     * @param token The token, e.g. "-12.5" or "+3e2".
+     * @param value Receives the number on success.
+     * @return True on success, false if the token is not entirely a finite number.
+     */
+    bool parse_double(std::string_view token, double &value);
+} // namespace Protocol
@@ -0,0 +1,37 @@
+#include "receive_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+char *ReceiveBuffer::prepare(std::size_t min_space) {
+    if (full()) {
+        return nullptr;
+    }
+    min_space = std::min(min_space, max_size_ - size());
+    if (capacity_ - end_ >= min_space) {
+        return storage_.get() + end_;
+    }
+
+    const std::size_t unread = size();
+    if (capacity_ - unread >= min_space) {
+        // Enough room once the consumed bytes are reclaimed
+        std::memmove(storage_.get(), storage_.get() + begin_, unread);
+    } else {
+        std::size_t capacity = std::min(std::max({INITIAL_CAPACITY, 2 * capacity_, unread + min_space}), max_size_);
+        std::unique_ptr<char[]> storage(new char[capacity]);
+        if (unread > 0) {
+            std::memcpy(storage.get(), storage_.get() + begin_, unread);
+        }
+        storage_ = std::move(storage);
+        capacity_ = capacity;
+    }
+    begin_ = 0;
+    end_ = unread;
+    return storage_.get() + end_;
+}
+
+void ReceiveBuffer::consume(std::size_t count) {
+    begin_ += count;
+    if (begin_ == end_) {
+        begin_ = end_ = 0; // Cheap rewind while nothing is left to move
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+/**
+ * @brief Reusable buffer for bytes received from a socket.
+ * The socket reads straight into the free space at the end, and parsed messages are
+ * consumed from the front by moving an offset, so neither receiving nor consuming copies
+ * data. The unread bytes are moved to the front only when the free space runs out, and
+ * the storage only grows when a single message does not fit.
+ * The unread bytes are capped at a maximum, so a peer that never completes a message
+ * cannot make the buffer grow without limit; once it is full, prepare() fails.
+ */
+class ReceiveBuffer {
+public:
+    static constexpr std::size_t INITIAL_CAPACITY = 64 * 1024;
+    static constexpr std::size_t DEFAULT_MAX_SIZE = 4 * 1024 * 1024; // Several of the largest protocol frames
+
+    /**
+     * @brief Constructor.
+     * @param max_size The most unread bytes the buffer holds.
+     */
+    explicit ReceiveBuffer(std::size_t max_size = DEFAULT_MAX_SIZE) : max_size_(max_size) {}
+
+    /**
+     * @brief Makes room for at least min_space more bytes, allocating on first use.
+     * Less room is made if min_space would take the unread bytes past the maximum.
+     * Invalidates views returned by data().
+     * @param min_space The number of bytes the caller wants to write.
+     * @return Where to write; writable() bytes are available there. Null if the buffer is full,
+     *         which the caller should treat as a misbehaving peer once it has parsed what it can.
+     */
+    char *prepare(std::size_t min_space);
+
+    /**
+     * @brief Gets the free space after the unread bytes.
+     * @return The number of bytes that can be written at the pointer returned by prepare().
+     */
+    std::size_t writable() const { return std::min(capacity_ - end_, max_size_ - size()); }
+
+    /**
+     * @brief Appends bytes written at the pointer returned by prepare().
+     * @param count The number of bytes written; at most writable().
+     */
+    void commit(std::size_t count) { end_ += count; }
+
+    /**
+     * @brief Gets the unread bytes.
+     * @return A view that stays valid until the next prepare() or clear().
+     */
+    std::string_view data() const { return {storage_.get() + begin_, end_ - begin_}; }
+
+    /**
+     * @brief Drops bytes from the front once they have been parsed.
+     * Does not move data, so views from data() stay valid.
+     * @param count The number of bytes; at most size().
+     */
+    void consume(std::size_t count);
+
+    /**
+     * @brief Drops all unread bytes; keeps the storage for reuse.
+     */
+    void clear() { begin_ = end_ = 0; }
+
+    std::size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+    bool full() const { return size() >= max_size_; }
+
+private:
+    std::size_t max_size_;
+    std::unique_ptr<char[]> storage_;
+    std::size_t capacity_ = 0;
+    std::size_t begin_ = 0; // First unread byte
+    std::size_t end_ = 0;   // One past the last received byte
+};
@@ -0,0 +1,551 @@
+#include "containment_kernel.h"
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONTAINMENT_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Server {
+
+    namespace {
+        /**
+         * @brief Precomputed containment coefficients of a single ellipse.
+         */
+        struct Coefficients {
+            double cx, cy, xx, xy, yy;
+        };
+
+        Coefficients make_coefficients(const Ellipse &ellipse) {
+            if (!(ellipse.a > 0) || !(ellipse.b > 0)) {
+                // Infinite coefficients make the form infinite (or NaN), so the test always fails
+                const double infinity = std::numeric_limits<double>::infinity();
+                return {ellipse.cx, ellipse.cy, infinity, infinity, infinity};
+            }
+            const double inv_a2 = 1.0 / (ellipse.a * ellipse.a);
+            const double inv_b2 = 1.0 / (ellipse.b * ellipse.b);
+            switch (shape_of(ellipse)) {
+            case ShapeKind::Circle:
+                return {ellipse.cx, ellipse.cy, inv_a2, 0.0, inv_a2};
+            case ShapeKind::AxisAligned:
+                return {ellipse.cx, ellipse.cy, inv_a2, 0.0, inv_b2};
+            case ShapeKind::Rotated:
+                break;
+            }
+            // Expanding (u/a)² + (v/b)² with u = c·dx + s·dy and v = c·dy - s·dx
+            const double c = std::cos(ellipse.angle);
+            const double s = std::sin(ellipse.angle);
+            return {ellipse.cx, ellipse.cy, c * c * inv_a2 + s * s * inv_b2, 2.0 * c * s * (inv_a2 - inv_b2),
+                    s * s * inv_a2 + c * c * inv_b2};
+        }
+    } // namespace
+
+    ShapeKind shape_of(const Ellipse &ellipse) {
+        if (ellipse.a == ellipse.b) {
+            return ShapeKind::Circle;
+        }
+        return ellipse.angle == 0.0 ? ShapeKind::AxisAligned : ShapeKind::Rotated;
+    }
+
+    void EllipseSoA::push_back(const Ellipse &ellipse) {
+        Coefficients c = make_coefficients(ellipse);
+        cx.push_back(c.cx);
+        cy.push_back(c.cy);
+        xx.push_back(c.xx);
+        xy.push_back(c.xy);
+        yy.push_back(c.yy);
+    }
+
+    void EllipseSoA::swap_remove(size_t index) {
+        cx[index] = cx.back();
+        cy[index] = cy.back();
+        xx[index] = xx.back();
+        xy[index] = xy.back();
+        yy[index] = yy.back();
+        cx.pop_back();
+        cy.pop_back();
+        xx.pop_back();
+        xy.pop_back();
+        yy.pop_back();
+    }
+
+    void EllipseSoA::clear() {
+        cx.clear();
+        cy.clear();
+        xx.clear();
+        xy.clear();
+        yy.clear();
+    }
+
+    size_t EllipseSoA::size() const {
+        return cx.size();
+    }
+
+    namespace ContainmentKernel {
+        namespace {
+
+            // The vector paths evaluate the same expression in the same order (no FMA),
+            // so every implementation of a shape's kernels gives bit-identical answers.
+            template <ShapeKind Shape>
+            inline double quadratic_form(double dx, double dy, double xx, double xy, double yy) {
+                if constexpr (Shape == ShapeKind::Circle) {
+                    return (dx * dx + dy * dy) * xx;
+                } else if constexpr (Shape == ShapeKind::AxisAligned) {
+                    return (dx * dx) * xx + (dy * dy) * yy;
+                } else {
+                    return (dx * dx) * xx + (dx * dy) * xy + (dy * dy) * yy;
+                }
+            }
+
+            template <ShapeKind Shape>
+            inline bool is_inside(double x, double y, const EllipseSoA &ellipses, size_t j) {
+                return quadratic_form<Shape>(x - ellipses.cx[j], y - ellipses.cy[j], ellipses.xx[j], ellipses.xy[j],
+                                             ellipses.yy[j]) <= 1.0;
+            }
+
+            template <ShapeKind Shape>
+            inline bool is_inside(double x, double y, const Coefficients &c) {
+                return quadratic_form<Shape>(x - c.cx, y - c.cy, c.xx, c.xy, c.yy) <= 1.0;
+            }
+
+            /**
+             * @brief Moves a point to the kept or the removed side during a compaction.
+             */
+            inline void sort_point(bool inside, size_t i, double *xs, double *ys, size_t &kept, double *inside_xs,
+                                   double *inside_ys) {
+                if (!inside) {
+                    xs[kept] = xs[i];
+                    ys[kept] = ys[i];
+                    kept++;
+                } else if (inside_xs) {
+                    inside_xs[i - kept] = xs[i];
+                    inside_ys[i - kept] = ys[i];
+                }
+            }
+
+            template <ShapeKind Shape>
+            bool is_covered_scalar(const EllipseSoA &ellipses, double x, double y) {
+                const size_t n = ellipses.size();
+                for (size_t j = 0; j < n; ++j) {
+                    if (is_inside<Shape>(x, y, ellipses, j)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            template <ShapeKind Shape>
+            size_t count_covered_scalar(const EllipseSoA &ellipses, const double *xs, const double *ys, size_t count,
+                                        unsigned char *covered) {
+                size_t hits = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    bool hit = is_covered_scalar<Shape>(ellipses, xs[i], ys[i]);
+                    hits += hit;
+                    if (covered) {
+                        covered[i] = hit;
+                    }
+                }
+                return hits;
+            }
+
+            template <ShapeKind Shape>
+            size_t remove_inside_scalar(const Ellipse &ellipse, double *xs, double *ys, size_t count, double *inside_xs,
+                                        double *inside_ys) {
+                const Coefficients c = make_coefficients(ellipse);
+
+                size_t kept = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    sort_point(is_inside<Shape>(xs[i], ys[i], c), i, xs, ys, kept, inside_xs, inside_ys);
+                }
+                return kept;
+            }
+
+            template <ShapeKind Shape>
+            size_t find_covering_scalar(const EllipseSoA &ellipses, double x, double y) {
+                const size_t n = ellipses.size();
+                for (size_t j = 0; j < n; ++j) {
+                    if (is_inside<Shape>(x, y, ellipses, j)) {
+                        return j;
+                    }
+                }
+                return n;
+            }
+
+            template <ShapeKind Shape>
+            size_t find_covering_scalar(const EllipseSoA &ellipses, const double *xs, const double *ys, size_t count,
+                                        size_t *owners) {
+                const size_t n = ellipses.size();
+                size_t hits = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    owners[i] = find_covering_scalar<Shape>(ellipses, xs[i], ys[i]);
+                    hits += owners[i] != n;
+                }
+                return hits;
+            }
+
+#ifdef CONTAINMENT_KERNEL_X86
+            template <ShapeKind Shape>
+            __attribute__((target("avx2"))) inline __m256d quadratic_form_avx2(__m256d dx, __m256d dy, __m256d xx,
+                                                                               __m256d xy, __m256d yy) {
+                if constexpr (Shape == ShapeKind::Circle) {
+                    return _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), xx);
+                } else if constexpr (Shape == ShapeKind::AxisAligned) {
+                    return _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(dx, dx), xx), _mm256_mul_pd(_mm256_mul_pd(dy, dy), yy));
+                } else {
+                    __m256d sum = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(dx, dx), xx), _mm256_mul_pd(_mm256_mul_pd(dx, dy), xy));
+                    return _mm256_add_pd(sum, _mm256_mul_pd(_mm256_mul_pd(dy, dy), yy));
+                }
+            }
+
+            template <ShapeKind Shape>
+            __attribute__((target("avx2"))) inline bool is_covered_avx2(const EllipseSoA &ellipses, double x, double y) {
+                const size_t n = ellipses.size();
+                const size_t vector_end = n - n % 4;
+                const double *cx = ellipses.cx.data();
+                const double *cy = ellipses.cy.data();
+                const double *xx = ellipses.xx.data();
+                const double *xy = ellipses.xy.data();
+                const double *yy = ellipses.yy.data();
+                const __m256d one = _mm256_set1_pd(1.0);
+                const __m256d vx = _mm256_set1_pd(x);
+                const __m256d vy = _mm256_set1_pd(y);
+
+                // Four ellipses per step, stopping at the first group with a hit
+                for (size_t j = 0; j < vector_end; j += 4) {
+                    __m256d dx = _mm256_sub_pd(vx, _mm256_loadu_pd(cx + j));
+                    __m256d dy = _mm256_sub_pd(vy, _mm256_loadu_pd(cy + j));
+                    // Only rotated ellipses read xy, and circles read neither xy nor yy
+                    __m256d vxx = _mm256_loadu_pd(xx + j);
+                    __m256d vxy = Shape == ShapeKind::Rotated ? _mm256_loadu_pd(xy + j) : vxx;
+                    __m256d vyy = Shape == ShapeKind::Circle ? vxx : _mm256_loadu_pd(yy + j);
+                    __m256d form = quadratic_form_avx2<Shape>(dx, dy, vxx, vxy, vyy);
+                    if (_mm256_movemask_pd(_mm256_cmp_pd(form, one, _CMP_LE_OQ)) != 0) {
+                        return true;
+                    }
+                }
+                for (size_t j = vector_end; j < n; ++j) {
+                    if (is_inside<Shape>(x, y, ellipses, j)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /**
+             * @brief Tests four points against ellipse j, returning the lanes inside it.
+             */
+            template <ShapeKind Shape>
+            __attribute__((target("avx2"))) inline int inside_lanes_avx2(const EllipseSoA &ellipses, size_t j, __m256d x,
+                                                                         __m256d y) {
+                __m256d dx = _mm256_sub_pd(x, _mm256_set1_pd(ellipses.cx[j]));
+                __m256d dy = _mm256_sub_pd(y, _mm256_set1_pd(ellipses.cy[j]));
+                __m256d form = quadratic_form_avx2<Shape>(dx, dy, _mm256_set1_pd(ellipses.xx[j]), _mm256_set1_pd(ellipses.xy[j]),
+                                                          _mm256_set1_pd(ellipses.yy[j]));
+                return _mm256_movemask_pd(_mm256_cmp_pd(form, _mm256_set1_pd(1.0), _CMP_LE_OQ));
+            }
+
+            // Batches run four points per step through the ellipses, so the few ellipses of a grid cell fill the lanes
+            template <ShapeKind Shape>
+            __attribute__((target("avx2"))) size_t count_covered_avx2(const EllipseSoA &ellipses, const double *xs,
+                                                                      const double *ys, size_t count,
+                                                                      unsigned char *covered) {
+                const size_t n = ellipses.size();
+                const size_t vector_end = count - count % 4;
+                size_t hits = 0;
+                for (size_t i = 0; i < vector_end; i += 4) {
+                    const __m256d x = _mm256_loadu_pd(xs + i);
+                    const __m256d y = _mm256_loadu_pd(ys + i);
+                    int inside = 0;
+                    for (size_t j = 0; j < n && inside != 0xF; ++j) {
+                        inside |= inside_lanes_avx2<Shape>(ellipses, j, x, y);
+                    }
+                    hits += static_cast<size_t>(__builtin_popcount(inside));
+                    if (covered) {
+                        for (int lane = 0; lane < 4; ++lane) {
+                            covered[i + lane] = (inside >> lane) & 1;
+                        }
+                    }
+                }
+                for (size_t i = vector_end; i < count; ++i) {
+                    bool hit = is_covered_scalar<Shape>(ellipses, xs[i], ys[i]);
+                    hits += hit;
+                    if (covered) {
+                        covered[i] = hit;
+                    }
+                }
+                return hits;
+            }
+
+            template <ShapeKind Shape>
+            __attribute__((target("avx2"))) size_t find_covering_avx2(const EllipseSoA &ellipses, const double *xs,
+                                                                      const double *ys, size_t count, size_t *owners) {
+                const size_t n = ellipses.size();
+                const size_t vector_end = count - count % 4;
+                size_t hits = 0;
+                for (size_t i = 0; i < vector_end; i += 4) {
+                    const __m256d x = _mm256_loadu_pd(xs + i);
+                    const __m256d y = _mm256_loadu_pd(ys + i);
+                    int inside = 0;
+                    for (int lane = 0; lane < 4; ++lane) {
+                        owners[i + lane] = n;
+                    }
+                    // The first ellipse found inside a lane owns it, as in the scalar search
+                    for (size_t j = 0; j < n && inside != 0xF; ++j) {
+                        int found = inside_lanes_avx2<Shape>(ellipses, j, x, y) & ~inside;
+                        inside |= found;
+                        for (; found; found &= found - 1) {
+                            owners[i + __builtin_ctz(found)] = j;
+                        }
+                    }
+                    hits += static_cast<size_t>(__builtin_popcount(inside));
+                }
+                return hits + find_covering_scalar<Shape>(ellipses, xs + vector_end, ys + vector_end, count - vector_end,
+                                                          owners + vector_end);
+            }
+
+            template <ShapeKind Shape>
+            __attribute__((target("avx2"))) size_t remove_inside_avx2(const Ellipse &ellipse, double *xs, double *ys,
+                                                                      size_t count, double *inside_xs, double *inside_ys) {
+                const Coefficients c = make_coefficients(ellipse);
+                const __m256d cx = _mm256_set1_pd(c.cx);
+                const __m256d cy = _mm256_set1_pd(c.cy);
+                const __m256d xx = _mm256_set1_pd(c.xx);
+                const __m256d xy = _mm256_set1_pd(c.xy);
+                const __m256d yy = _mm256_set1_pd(c.yy);
+                const __m256d one = _mm256_set1_pd(1.0);
+                const size_t vector_end = count - count % 4;
+
+                size_t kept = 0;
+                for (size_t i = 0; i < vector_end; i += 4) {
+                    __m256d x = _mm256_loadu_pd(xs + i);
+                    __m256d y = _mm256_loadu_pd(ys + i);
+                    __m256d form = quadratic_form_avx2<Shape>(_mm256_sub_pd(x, cx), _mm256_sub_pd(y, cy), xx, xy, yy);
+                    int inside = _mm256_movemask_pd(_mm256_cmp_pd(form, one, _CMP_LE_OQ));
+
+                    // kept <= i, so compacting lane by lane never overwrites unread points
+                    for (int lane = 0; lane < 4; ++lane) {
+                        sort_point(inside & (1 << lane), i + lane, xs, ys, kept, inside_xs, inside_ys);
+                    }
+                }
+                for (size_t i = vector_end; i < count; ++i) {
+                    sort_point(is_inside<Shape>(xs[i], ys[i], c), i, xs, ys, kept, inside_xs, inside_ys);
+                }
+                return kept;
+            }
+
+            template <ShapeKind Shape>
+            __attribute__((target("avx512f"))) inline __m512d quadratic_form_avx512(__m512d dx, __m512d dy, __m512d xx,
+                                                                                    __m512d xy, __m512d yy) {
+                if constexpr (Shape == ShapeKind::Circle) {
+                    return _mm512_mul_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)), xx);
+                } else if constexpr (Shape == ShapeKind::AxisAligned) {
+                    return _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(dx, dx), xx), _mm512_mul_pd(_mm512_mul_pd(dy, dy), yy));
+                } else {
+                    __m512d sum = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(dx, dx), xx), _mm512_mul_pd(_mm512_mul_pd(dx, dy), xy));
+                    return _mm512_add_pd(sum, _mm512_mul_pd(_mm512_mul_pd(dy, dy), yy));
+                }
+            }
+
+            template <ShapeKind Shape>
+            __attribute__((target("avx512f"))) inline bool is_covered_avx512(const EllipseSoA &ellipses, double x, double y) {
+                const size_t n = ellipses.size();
+                const size_t vector_end = n - n % 8;
+                const double *cx = ellipses.cx.data();
+                const double *cy = ellipses.cy.data();
+                const double *xx = ellipses.xx.data();
+                const double *xy = ellipses.xy.data();
+                const double *yy = ellipses.yy.data();
+                const __m512d one = _mm512_set1_pd(1.0);
+                const __m512d vx = _mm512_set1_pd(x);
+                const __m512d vy = _mm512_set1_pd(y);
+
+                // Eight ellipses per step, stopping at the first group with a hit
+                for (size_t j = 0; j < vector_end; j += 8) {
+                    __m512d dx = _mm512_sub_pd(vx, _mm512_loadu_pd(cx + j));
+                    __m512d dy = _mm512_sub_pd(vy, _mm512_loadu_pd(cy + j));
+                    // Only rotated ellipses read xy, and circles read neither xy nor yy
+                    __m512d vxx = _mm512_loadu_pd(xx + j);
+                    __m512d vxy = Shape == ShapeKind::Rotated ? _mm512_loadu_pd(xy + j) : vxx;
+                    __m512d vyy = Shape == ShapeKind::Circle ? vxx : _mm512_loadu_pd(yy + j);
+                    __m512d form = quadratic_form_avx512<Shape>(dx, dy, vxx, vxy, vyy);
+                    if (_mm512_cmp_pd_mask(form, one, _CMP_LE_OQ) != 0) {
+                        return true;
+                    }
+                }
+                for (size_t j = vector_end; j < n; ++j) {
+                    if (is_inside<Shape>(x, y, ellipses, j)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /**
+             * @brief Tests eight points against ellipse j, returning the lanes inside it.
+             */
+            template <ShapeKind Shape>
+            __attribute__((target("avx512f"))) inline unsigned inside_lanes_avx512(const EllipseSoA &ellipses, size_t j,
+                                                                                   __m512d x, __m512d y) {
+                __m512d dx = _mm512_sub_pd(x, _mm512_set1_pd(ellipses.cx[j]));
+                __m512d dy = _mm512_sub_pd(y, _mm512_set1_pd(ellipses.cy[j]));
+                __m512d form = quadratic_form_avx512<Shape>(dx, dy, _mm512_set1_pd(ellipses.xx[j]), _mm512_set1_pd(ellipses.xy[j]),
+                                                            _mm512_set1_pd(ellipses.yy[j]));
+                return _mm512_cmp_pd_mask(form, _mm512_set1_pd(1.0), _CMP_LE_OQ);
+            }
+
+            // Batches run eight points per step through the ellipses, so the few ellipses of a grid cell fill the lanes
+            template <ShapeKind Shape>
+            __attribute__((target("avx512f"))) size_t count_covered_avx512(const EllipseSoA &ellipses, const double *xs,
+                                                                           const double *ys, size_t count,
+                                                                           unsigned char *covered) {
+                const size_t n = ellipses.size();
+                const size_t vector_end = count - count % 8;
+                size_t hits = 0;
+                for (size_t i = 0; i < vector_end; i += 8) {
+                    const __m512d x = _mm512_loadu_pd(xs + i);
+                    const __m512d y = _mm512_loadu_pd(ys + i);
+                    unsigned inside = 0;
+                    for (size_t j = 0; j < n && inside != 0xFF; ++j) {
+                        inside |= inside_lanes_avx512<Shape>(ellipses, j, x, y);
+                    }
+                    hits += static_cast<size_t>(__builtin_popcount(inside));
+                    if (covered) {
+                        for (int lane = 0; lane < 8; ++lane) {
+                            covered[i + lane] = (inside >> lane) & 1;
+                        }
+                    }
+                }
+                for (size_t i = vector_end; i < count; ++i) {
+                    bool hit = is_covered_scalar<Shape>(ellipses, xs[i], ys[i]);
+                    hits += hit;
+                    if (covered) {
+                        covered[i] = hit;
+                    }
+                }
+                return hits;
+            }
+
+            template <ShapeKind Shape>
+            __attribute__((target("avx512f"))) size_t find_covering_avx512(const EllipseSoA &ellipses, const double *xs,
+                                                                           const double *ys, size_t count, size_t *owners) {
+                const size_t n = ellipses.size();
+                const size_t vector_end = count - count % 8;
+                size_t hits = 0;
+                for (size_t i = 0; i < vector_end; i += 8) {
+                    const __m512d x = _mm512_loadu_pd(xs + i);
+                    const __m512d y = _mm512_loadu_pd(ys + i);
+                    unsigned inside = 0;
+                    for (int lane = 0; lane < 8; ++lane) {
+                        owners[i + lane] = n;
+                    }
+                    // The first ellipse found inside a lane owns it, as in the scalar search
+                    for (size_t j = 0; j < n && inside != 0xFF; ++j) {
+                        unsigned found = inside_lanes_avx512<Shape>(ellipses, j, x, y) & ~inside;
+                        inside |= found;
+                        for (; found; found &= found - 1) {
+                            owners[i + __builtin_ctz(found)] = j;
+                        }
+                    }
+                    hits += static_cast<size_t>(__builtin_popcount(inside));
+                }
+                return hits + find_covering_scalar<Shape>(ellipses, xs + vector_end, ys + vector_end, count - vector_end,
+                                                          owners + vector_end);
+            }
+
+            template <ShapeKind Shape>
+            __attribute__((target("avx512f"))) size_t remove_inside_avx512(const Ellipse &ellipse, double *xs,
+                                                                           double *ys, size_t count, double *inside_xs,
+                                                                           double *inside_ys) {
+                const Coefficients c = make_coefficients(ellipse);
+                const __m512d cx = _mm512_set1_pd(c.cx);
+                const __m512d cy = _mm512_set1_pd(c.cy);
+                const __m512d xx = _mm512_set1_pd(c.xx);
+                const __m512d xy = _mm512_set1_pd(c.xy);
+                const __m512d yy = _mm512_set1_pd(c.yy);
+                const __m512d one = _mm512_set1_pd(1.0);
+                const size_t vector_end = count - count % 8;
+
+                size_t kept = 0;
+                for (size_t i = 0; i < vector_end; i += 8) {
+                    __m512d x = _mm512_loadu_pd(xs + i);
+                    __m512d y = _mm512_loadu_pd(ys + i);
+                    __m512d form = quadratic_form_avx512<Shape>(_mm512_sub_pd(x, cx), _mm512_sub_pd(y, cy), xx, xy, yy);
+                    __mmask8 outside = _mm512_cmp_pd_mask(form, one, _CMP_NLE_UQ);
+
+                    // Compress the outside lanes to the front; kept <= i keeps unread points intact
+                    const __mmask8 inside = static_cast<__mmask8>(~outside);
+                    if (inside_xs && inside) {
+                        _mm512_mask_compressstoreu_pd(inside_xs + (i - kept), inside, x);
+                        _mm512_mask_compressstoreu_pd(inside_ys + (i - kept), inside, y);
+                    }
+                    _mm512_mask_compressstoreu_pd(xs + kept, outside, x);
+                    _mm512_mask_compressstoreu_pd(ys + kept, outside, y);
+                    kept += static_cast<size_t>(__builtin_popcount(outside));
+                }
+                for (size_t i = vector_end; i < count; ++i) {
+                    sort_point(is_inside<Shape>(xs[i], ys[i], c), i, xs, ys, kept, inside_xs, inside_ys);
+                }
+                return kept;
+            }
+#endif
+
+            template <ShapeKind Shape>
+            ShapeKernels scalar_kernels() {
+                return {Shape, is_covered_scalar<Shape>, count_covered_scalar<Shape>, remove_inside_scalar<Shape>,
+                        find_covering_scalar<Shape>};
+            }
+
+#ifdef CONTAINMENT_KERNEL_X86
+            template <ShapeKind Shape>
+            ShapeKernels avx2_kernels() {
+                return {Shape, is_covered_avx2<Shape>, count_covered_avx2<Shape>, remove_inside_avx2<Shape>,
+                        find_covering_avx2<Shape>};
+            }
+
+            template <ShapeKind Shape>
+            ShapeKernels avx512_kernels() {
+                return {Shape, is_covered_avx512<Shape>, count_covered_avx512<Shape>, remove_inside_avx512<Shape>,
+                        find_covering_avx512<Shape>};
+            }
+#endif
+
+            struct KernelTable {
+                const char *isa;
+                ShapeKernels by_shape[3]; // Indexed by ShapeKind
+            };
+
+            KernelTable select_kernels() {
+#ifdef CONTAINMENT_KERNEL_X86
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx512f")) {
+                    return {"avx512", {avx512_kernels<ShapeKind::Circle>(), avx512_kernels<ShapeKind::AxisAligned>(),
+                                       avx512_kernels<ShapeKind::Rotated>()}};
+                }
+                if (__builtin_cpu_supports("avx2")) {
+                    return {"avx2", {avx2_kernels<ShapeKind::Circle>(), avx2_kernels<ShapeKind::AxisAligned>(),
+                                     avx2_kernels<ShapeKind::Rotated>()}};
+                }
+#endif
+                return {"scalar", {scalar_kernels<ShapeKind::Circle>(), scalar_kernels<ShapeKind::AxisAligned>(),
+                                   scalar_kernels<ShapeKind::Rotated>()}};
+            }
+
+            const KernelTable &kernels() {
+                static const KernelTable table = select_kernels();
+                return table;
+            }
+
+        } // namespace
+
+        const ShapeKernels &kernels_for(ShapeKind shape) {
+            return kernels().by_shape[static_cast<int>(shape)];
+        }
+
+        const char *active_isa() {
+            return kernels().isa;
+        }
+
+    } // namespace ContainmentKernel
+
+} // namespace Server
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "common/ellipse.h"
+#include <cstddef>
+#include <vector>
+
+namespace Server {
+
+    /**
+     * @brief Shape classes with their own containment kernels, from cheapest to most general.
+     * Each class includes the ones before it, so kernels for a wider class are correct for
+     * every narrower one.
+     */
+    enum class ShapeKind {
+        Circle,      // a == b; the rotation does not matter
+        AxisAligned, // No rotation
+        Rotated      // Any rotation
+    };
+
+    /**
+     * @brief Gets the narrowest shape class an ellipse belongs to.
+     * @param ellipse The ellipse.
+     * @return Its shape class.
+     */
+    ShapeKind shape_of(const Ellipse &ellipse);
+
+    /**
+     * @brief Ellipses stored as a structure of arrays for vectorized containment tests.
+     * Each ellipse keeps its center and the coefficients of its quadratic form, so a test is
+     * xx·dx² + xy·dx·dy + yy·dy² <= 1 (dx = x-cx, dy = y-cy) without divisions, trigonometry
+     * or validity branches. Unrotated ellipses have xy = 0 and circles also have xx = yy,
+     * which lets their kernels skip the terms and loads they do not need.
+     */
+    struct EllipseSoA {
+        std::vector<double> cx;
+        std::vector<double> cy;
+        std::vector<double> xx;
+        std::vector<double> xy;
+        std::vector<double> yy;
+
+        /**
+         * @brief Appends an ellipse. Ellipses with a <= 0 or b <= 0 never contain a point.
+         * @param ellipse The ellipse to append.
+         */
+        void push_back(const Ellipse &ellipse);
+
+        /**
+         * @brief Removes one ellipse by moving the last one into its place.
+         * @param index The position of the ellipse to remove.
+         */
+        void swap_remove(size_t index);
+
+        /**
+         * @brief Removes all ellipses.
+         */
+        void clear();
+
+        /**
+         * @brief Gets the number of stored ellipses.
+         * @return The ellipse count.
+         */
+        size_t size() const;
+    };
+
+    /**
+     * @brief Division-free containment kernels with AVX-512 / AVX2 / scalar implementations.
+     * Every shape class gets its own compiled kernels. The instruction set is chosen once
+     * at startup from the CPU features; for a given shape class all of them produce
+     * identical results.
+     */
+    namespace ContainmentKernel {
+
+        /**
+         * @brief The kernels for one shape class, compiled for the active instruction set.
+         * Callers pick the table for the widest shape they hold once and then call through it,
+         * so the shape is never tested per point.
+         */
+        struct ShapeKernels {
+            ShapeKind shape;
+
+            /**
+             * @brief Tests a single point against all ellipses.
+             * Arguments: the ellipses, then the point's x and y. Returns true if the point
+             * is inside at least one ellipse.
+             */
+            bool (*is_covered)(const EllipseSoA &ellipses, double x, double y);
+
+            /**
+             * @brief Tests a batch of points against all ellipses.
+             * The vector paths test several points per step against one ellipse at a time, so
+             * they stay efficient for the handful of ellipses a grid cell holds.
+             * Arguments: the ellipses, the points' x and y arrays, the point count, and an
+             * optional array receiving 1 for each covered point and 0 otherwise. Returns the
+             * number of points inside at least one ellipse.
+             */
+            size_t (*count_covered)(const EllipseSoA &ellipses, const double *xs, const double *ys, size_t count,
+                                    unsigned char *covered);
+
+            /**
+             * @brief Removes the points inside an ellipse, compacting the rest in order.
+             * Arguments: the ellipse, the points' x and y arrays (compacted in place), the point
+             * count, and optional arrays with room for count that receive the removed points in
+             * order. Returns the number of points kept (those outside the ellipse).
+             */
+            size_t (*remove_inside)(const Ellipse &ellipse, double *xs, double *ys, size_t count, double *inside_xs,
+                                    double *inside_ys);
+
+            /**
+             * @brief Finds, for a batch of points, the first ellipse that contains each one.
+             * Costs the same as count_covered, so callers that need owners test each point once.
+             * Arguments: the ellipses, the points' x and y arrays, the point count, and an array
+             * receiving the index of each point's ellipse, or ellipses.size() if none contains it.
+             * Returns the number of points inside at least one ellipse.
+             */
+            size_t (*find_covering)(const EllipseSoA &ellipses, const double *xs, const double *ys, size_t count,
+                                    size_t *owners);
+        };
+
+        /**
+         * @brief Gets the kernels for a shape class.
+         * @param shape The widest shape among the ellipses the kernels will test.
+         * @return The kernel table; valid for the lifetime of the program.
+         */
+        const ShapeKernels &kernels_for(ShapeKind shape);
+
+        /**
+         * @brief Gets the name of the instruction set the kernels run with.
+         * @return "avx512", "avx2" or "scalar".
+         */
+        const char *active_isa();
+
+    } // namespace ContainmentKernel
+
+} // namespace Server
@@ -0,0 +1,166 @@
+#include "coverage_raster.h"
+#include "common/canvas.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Server {
+
+    namespace {
+        // Clamps before converting, so huge, infinite or NaN coordinates stay well defined
+        int clamp_to_index(double value, int max_index) {
+            if (!(value > 0.0)) {
+                return 0;
+            }
+            return value >= max_index ? max_index : static_cast<int>(value);
+        }
+
+        // Same form as the containment kernels, so a cell agrees with a point test at its center
+        bool contains(const Ellipse &ellipse, double x, double y) {
+            double dx, dy;
+            ellipse.to_axes(x, y, dx, dy);
+            return (dx * dx) * (1.0 / (ellipse.a * ellipse.a)) + (dy * dy) * (1.0 / (ellipse.b * ellipse.b)) <= 1.0;
+        }
+    } // namespace
+
+    CoverageRaster::CoverageRaster(int resolution)
+        : resolution_(std::max(1, resolution)),
+          words_per_row_((resolution_ + 63) / 64),
+          cell_width_(Canvas::get_width() / resolution_),
+          cell_height_(Canvas::get_height() / resolution_),
+          covered_cells_(0) {}
+
+    void CoverageRaster::insert(const Ellipse &ellipse) {
+        int row_begin, row_end;
+        if (!row_range(ellipse, row_begin, row_end)) {
+            return;
+        }
+        if (bits_.empty()) {
+            bits_.assign(static_cast<size_t>(resolution_) * words_per_row_, 0);
+        }
+        draw(ellipse, row_begin, row_end, true);
+    }
+
+    void CoverageRaster::erase(const std::vector<Ellipse> &ellipses, size_t index) {
+        const Ellipse &erased = ellipses[index];
+        int row_begin, row_end;
+        if (bits_.empty() || !row_range(erased, row_begin, row_end)) {
+            return;
+        }
+        draw(erased, row_begin, row_end, false);
+
+        // Any cell the erased ellipse shared lies in the bounding boxes of both ellipses; one
+        // cell of slack keeps rounding in the boundary tests from missing a neighbor
+        const double half_width = erased.get_half_width() + cell_width_;
+        const double half_height = erased.get_half_height() + cell_height_;
+        for (size_t i = 0; i < ellipses.size(); ++i) {
+            const Ellipse &other = ellipses[i];
+            if (i == index || other.a <= 0 || other.b <= 0 ||
+                std::fabs(other.cx - erased.cx) > half_width + other.get_half_width() ||
+                std::fabs(other.cy - erased.cy) > half_height + other.get_half_height()) {
+                continue;
+            }
+            draw(other, row_begin, row_end, true);
+        }
+    }
+
+    bool CoverageRaster::row_range(const Ellipse &ellipse, int &row_begin, int &row_end) const {
+        if (ellipse.a <= 0 || ellipse.b <= 0) {
+            return false; // Covers nothing
+        }
+        const double half_height = ellipse.get_half_height();
+        if (ellipse.cy + half_height < Canvas::MIN_Y || ellipse.cy - half_height > Canvas::MAX_Y) {
+            return false; // Misses the canvas vertically
+        }
+
+        // Rows whose centers may lie within the vertical extent, with one row of slack for rounding
+        row_begin = clamp_to_index(std::floor((ellipse.cy - half_height - Canvas::MIN_Y) / cell_height_ - 0.5), resolution_ - 1);
+        row_end = clamp_to_index(std::ceil((ellipse.cy + half_height - Canvas::MIN_Y) / cell_height_ - 0.5), resolution_ - 1);
+        return true;
+    }
+
+    void CoverageRaster::draw(const Ellipse &ellipse, int first_row, int last_row, bool set) {
+        int row_begin, row_end;
+        if (!row_range(ellipse, row_begin, row_end)) {
+            return;
+        }
+        row_begin = std::max(row_begin, first_row);
+        row_end = std::min(row_end, last_row);
+
+        auto center_x = [&](int col) { return Canvas::MIN_X + (col + 0.5) * cell_width_; };
+
+        for (int row = row_begin; row <= row_end; ++row) {
+            const double y = Canvas::MIN_Y + (row + 0.5) * cell_height_;
+            double left, right;
+            if (!ellipse.get_chord(y, left, right)) {
+                continue;
+            }
+
+            // Estimate the span from the chord, then settle its ends with the exact test.
+            // An ellipse is convex, so the covered centers of a row are contiguous.
+            const double first = (left - Canvas::MIN_X) / cell_width_ - 0.5;
+            const double last = (right - Canvas::MIN_X) / cell_width_ - 0.5;
+            if (last < -1.0 || first > resolution_) {
+                continue;
+            }
+            int col_begin = clamp_to_index(std::ceil(first), resolution_ - 1);
+            int col_end = clamp_to_index(std::floor(last), resolution_ - 1);
+
+            while (col_begin > 0 && contains(ellipse, center_x(col_begin - 1), y)) {
+                --col_begin;
+            }
+            while (col_begin <= col_end && !contains(ellipse, center_x(col_begin), y)) {
+                ++col_begin;
+            }
+            while (col_end < resolution_ - 1 && contains(ellipse, center_x(col_end + 1), y)) {
+                ++col_end;
+            }
+            while (col_end >= col_begin && !contains(ellipse, center_x(col_end), y)) {
+                --col_end;
+            }
+
+            if (col_begin <= col_end) {
+                fill_span(row, col_begin, col_end, set);
+            }
+        }
+    }
+
+    void CoverageRaster::clear() {
+        bits_ = std::vector<uint64_t>();
+        covered_cells_ = 0;
+    }
+
+    double CoverageRaster::covered_area() const {
+        return static_cast<double>(covered_cells_) * cell_width_ * cell_height_;
+    }
+
+    int CoverageRaster::get_resolution() const {
+        return resolution_;
+    }
+
+    void CoverageRaster::fill_span(int row, int col_begin, int col_end, bool set) {
+        uint64_t *words = bits_.data() + static_cast<size_t>(row) * words_per_row_;
+        const int word_begin = col_begin / 64;
+        const int word_end = col_end / 64;
+
+        for (int word = word_begin; word <= word_end; ++word) {
+            uint64_t mask = ~uint64_t{0};
+            if (word == word_begin) {
+                mask &= ~uint64_t{0} << (col_begin % 64);
+            }
+            if (word == word_end) {
+                mask &= ~uint64_t{0} >> (63 - col_end % 64);
+            }
+
+            if (set) {
+                const uint64_t newly_set = mask & ~words[word];
+                covered_cells_ += __builtin_popcountll(newly_set);
+                words[word] |= newly_set;
+            } else {
+                const uint64_t newly_clear = mask & words[word];
+                covered_cells_ -= __builtin_popcountll(newly_clear);
+                words[word] &= ~newly_clear;
+            }
+        }
+    }
+
+} // namespace Server
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "common/ellipse.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Server {
+
+    /**
+     * @brief Bit-packed occupancy grid over the canvas.
+     * A cell is covered when its center lies inside an ellipse. Each inserted ellipse sets
+     * the bits of its row spans, and the number of set bits is maintained while doing so,
+     * so the covered area is available in constant time whatever the ellipse count.
+     * Erasing an ellipse clears its spans and redraws, within its rows, only the ellipses
+     * whose bounding boxes overlap it.
+     */
+    class CoverageRaster {
+    public:
+        static constexpr int DEFAULT_RESOLUTION = 1024;
+
+        /**
+         * @brief Constructor. No memory is allocated until the first insert.
+         * @param resolution The number of cells along each canvas axis.
+         */
+        explicit CoverageRaster(int resolution = DEFAULT_RESOLUTION);
+
+        /**
+         * @brief Marks the cells whose centers lie inside an ellipse.
+         * @param ellipse The ellipse.
+         */
+        void insert(const Ellipse &ellipse);
+
+        /**
+         * @brief Uncovers the cells of an inserted ellipse that no other ellipse covers.
+         * @param ellipses The ellipses that stay covered, plus the erased one. Ones not inserted
+         *        yet may be included; inserting them later counts nothing twice.
+         * @param index The position of the erased ellipse in ellipses.
+         */
+        void erase(const std::vector<Ellipse> &ellipses, size_t index);
+
+        /**
+         * @brief Clears every cell and releases the bitmap.
+         */
+        void clear();
+
+        /**
+         * @brief Gets the area of the covered cells.
+         * @return The covered area in units squared.
+         */
+        double covered_area() const;
+
+        /**
+         * @brief Gets the number of cells along each canvas axis.
+         * @return The resolution.
+         */
+        int get_resolution() const;
+
+    private:
+        /**
+         * @brief Gets the rows whose centers may lie inside an ellipse.
+         * @param ellipse The ellipse, with positive axes.
+         * @param row_begin Receives the first row.
+         * @param row_end Receives the last row.
+         * @return False if the ellipse misses the canvas vertically.
+         */
+        bool row_range(const Ellipse &ellipse, int &row_begin, int &row_end) const;
+
+        /**
+         * @brief Sets or clears the cells whose centers lie inside an ellipse, within some rows.
+         * Both directions compute the same spans, so a clear undoes exactly what a set drew.
+         * @param ellipse The ellipse.
+         * @param first_row The first row to draw.
+         * @param last_row The last row to draw.
+         * @param set True to set the bits, false to clear them.
+         */
+        void draw(const Ellipse &ellipse, int first_row, int last_row, bool set);
+
+        /**
+         * @brief Sets or clears the bits of columns [col_begin, col_end] in one row.
+         * @param row The row.
+         * @param col_begin The first column.
+         * @param col_end The last column.
+         * @param set True to set the bits, false to clear them.
+         */
+        void fill_span(int row, int col_begin, int col_end, bool set);
+
+        int resolution_;
+        int words_per_row_;
+        double cell_width_;
+        double cell_height_;
+        std::vector<uint64_t> bits_; // Row-major; bit c % 64 of word c / 64 is column c
+        long long covered_cells_;    // Number of set bits in bits_
+    };
+
+} // namespace Server
@@ -0,0 +1,300 @@
+#include "ellipse_grid.h"
+#include "common/canvas.h"
+#include <algorithm>
+
+namespace Server {
+
+    namespace {
+        // Same form as the unrotated containment kernels, so "full" agrees with per-point tests
+        bool contains(const Ellipse &ellipse, double x, double y) {
+            double dx, dy;
+            ellipse.to_axes(x, y, dx, dy);
+            return (dx * dx) * (1.0 / (ellipse.a * ellipse.a)) + (dy * dy) * (1.0 / (ellipse.b * ellipse.b)) <= 1.0;
+        }
+
+        // In the ellipse's own frame, scaled so that it becomes the unit circle, the cell is a
+        // parallelogram. They overlap iff the origin lies inside it or an edge comes within 1.
+        bool overlaps_rotated(const Ellipse &ellipse, double x0, double y0, double x1, double y1) {
+            const double corners[4][2] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+            double us[4], vs[4];
+            for (int i = 0; i < 4; ++i) {
+                ellipse.to_axes(corners[i][0], corners[i][1], us[i], vs[i]);
+                us[i] /= ellipse.a;
+                vs[i] /= ellipse.b;
+            }
+
+            int left_of = 0; // Edges with the origin on their left
+            for (int i = 0; i < 4; ++i) {
+                const int j = (i + 1) % 4;
+                const double du = us[j] - us[i];
+                const double dv = vs[j] - vs[i];
+                left_of += du * vs[i] - dv * us[i] < 0.0;
+                const double t = std::clamp(-(us[i] * du + vs[i] * dv) / (du * du + dv * dv), 0.0, 1.0);
+                const double nearest_u = us[i] + t * du;
+                const double nearest_v = vs[i] + t * dv;
+                if (nearest_u * nearest_u + nearest_v * nearest_v <= 1.0) {
+                    return true;
+                }
+            }
+            return left_of == 0 || left_of == 4;
+        }
+    } // namespace
+
+    EllipseGrid::EllipseGrid(int resolution)
+        : resolution_(std::max(1, resolution)),
+          cell_width_(Canvas::get_width() / resolution_),
+          cell_height_(Canvas::get_height() / resolution_),
+          inv_cell_width_(resolution_ / Canvas::get_width()),
+          inv_cell_height_(resolution_ / Canvas::get_height()),
+          cells_(static_cast<size_t>(resolution_) * resolution_),
+          kernels_(&ContainmentKernel::kernels_for(ShapeKind::Circle)) {}
+
+    void EllipseGrid::insert(const Ellipse &ellipse, size_t id) {
+        const ShapeKind shape = shape_of(ellipse);
+        if (shape > kernels_->shape) {
+            kernels_ = &ContainmentKernel::kernels_for(shape);
+        }
+        update_cells(ellipse, id, true);
+    }
+
+    void EllipseGrid::erase(const Ellipse &ellipse, size_t id) {
+        update_cells(ellipse, id, false);
+    }
+
+    void EllipseGrid::update_cells(const Ellipse &ellipse, size_t id, bool insert) {
+        if (ellipse.a <= 0 || ellipse.b <= 0) {
+            return; // Covers nothing
+        }
+        const double half_width = ellipse.get_half_width();
+        const double half_height = ellipse.get_half_height();
+        if (ellipse.cx + half_width < Canvas::MIN_X || ellipse.cx - half_width > Canvas::MAX_X ||
+            ellipse.cy + half_height < Canvas::MIN_Y || ellipse.cy - half_height > Canvas::MAX_Y) {
+            return; // Bounding box misses the canvas
+        }
+
+        const int col_begin = to_cell(ellipse.cx - half_width, Canvas::MIN_X, inv_cell_width_);
+        const int col_end = to_cell(ellipse.cx + half_width, Canvas::MIN_X, inv_cell_width_);
+        const int row_begin = to_cell(ellipse.cy - half_height, Canvas::MIN_Y, inv_cell_height_);
+        const int row_end = to_cell(ellipse.cy + half_height, Canvas::MIN_Y, inv_cell_height_);
+
+        for (int row = row_begin; row <= row_end; ++row) {
+            const double y0 = Canvas::MIN_Y + row * cell_height_;
+            const double y1 = y0 + cell_height_;
+            for (int col = col_begin; col <= col_end; ++col) {
+                Cell &cell = cells_[static_cast<size_t>(row) * resolution_ + col];
+                const double x0 = Canvas::MIN_X + col * cell_width_;
+                const double x1 = x0 + cell_width_;
+
+                // An ellipse is convex, so it contains the cell iff it contains all four corners
+                if (contains(ellipse, x0, y0) && contains(ellipse, x1, y0) &&
+                    contains(ellipse, x0, y1) && contains(ellipse, x1, y1)) {
+                    if (insert) {
+                        cell.full_by.push_back(id);
+                    } else {
+                        cell.full_by.erase(std::find(cell.full_by.begin(), cell.full_by.end(), id));
+                    }
+                    continue;
+                }
+
+                // Unless rotated, the cell point closest to the center (in the ellipse's scaled
+                // metric) is the center clamped to the cell; if it is outside, the ellipse misses the cell.
+                if (shape_of(ellipse) != ShapeKind::Rotated) {
+                    const double nearest_x = std::clamp(ellipse.cx, x0, x1);
+                    const double nearest_y = std::clamp(ellipse.cy, y0, y1);
+                    if (!contains(ellipse, nearest_x, nearest_y)) {
+                        continue;
+                    }
+                } else if (!overlaps_rotated(ellipse, x0, y0, x1, y1)) {
+                    continue;
+                }
+                if (insert) {
+                    cell.ellipses.push_back(ellipse);
+                    cell.ids.push_back(id);
+                } else {
+                    // Order within a cell does not matter, so the last ellipse fills the gap
+                    const size_t index = static_cast<size_t>(std::find(cell.ids.begin(), cell.ids.end(), id) - cell.ids.begin());
+                    cell.ellipses.swap_remove(index);
+                    cell.ids[index] = cell.ids.back();
+                    cell.ids.pop_back();
+                }
+            }
+        }
+    }
+
+    void EllipseGrid::clear() {
+        for (Cell &cell : cells_) {
+            cell = Cell();
+        }
+        kernels_ = &ContainmentKernel::kernels_for(ShapeKind::Circle);
+    }
+
+    bool EllipseGrid::is_covered(double x, double y) const {
+        const Cell &cell = cells_[cell_index(x, y)];
+        return cell.is_full() || kernels_->is_covered(cell.ellipses, x, y);
+    }
+
+    size_t EllipseGrid::count_covered(const double *xs, const double *ys, size_t count, unsigned char *covered) const {
+        size_t hits = 0;
+        for (size_t start = 0; start < count; start += GROUP_SIZE) {
+            const size_t size = std::min(GROUP_SIZE, count - start);
+            CellBatches &batches =
+                group_by_cell(xs + start, ys + start, size, covered ? covered + start : nullptr, nullptr);
+            hits += batches.settled_hits;
+            for (size_t k = 0; k < batches.cells.size(); ++k) {
+                const EllipseSoA &ellipses = cells_[batches.cells[k]].ellipses;
+                const size_t begin = batches.begins[k];
+                const size_t points = batches.begins[k + 1] - begin;
+                if (prefers_batch_kernel(points, ellipses.size())) {
+                    hits += kernels_->count_covered(ellipses, batches.xs.data() + begin, batches.ys.data() + begin, points,
+                                                    covered ? batches.covered.data() + begin : nullptr);
+                    continue;
+                }
+                // Vectors across the cell's ellipses, which also stop at the first hit
+                for (size_t position = begin; position < begin + points; ++position) {
+                    const bool hit = kernels_->is_covered(ellipses, batches.xs[position], batches.ys[position]);
+                    hits += hit;
+                    if (covered) {
+                        batches.covered[position] = hit;
+                    }
+                }
+            }
+            if (covered) {
+                for (size_t position = 0; position < batches.order.size(); ++position) {
+                    covered[start + batches.order[position]] = batches.covered[position];
+                }
+            }
+        }
+        return hits;
+    }
+
+    size_t EllipseGrid::find_covering(const double *xs, const double *ys, size_t count, size_t *owners) const {
+        size_t hits = 0;
+        for (size_t start = 0; start < count; start += GROUP_SIZE) {
+            const size_t size = std::min(GROUP_SIZE, count - start);
+            CellBatches &batches = group_by_cell(xs + start, ys + start, size, nullptr, owners + start);
+            hits += batches.settled_hits;
+            for (size_t k = 0; k < batches.cells.size(); ++k) {
+                const Cell &cell = cells_[batches.cells[k]];
+                const size_t begin = batches.begins[k];
+                const size_t end = batches.begins[k + 1];
+                if (prefers_batch_kernel(end - begin, cell.ids.size())) {
+                    hits += kernels_->find_covering(cell.ellipses, batches.xs.data() + begin, batches.ys.data() + begin,
+                                                    end - begin, batches.owners.data() + begin);
+                } else {
+                    // One point at a time, as in count_covered; only covered points search for their owner
+                    for (size_t position = begin; position < end; ++position) {
+                        if (kernels_->is_covered(cell.ellipses, batches.xs[position], batches.ys[position])) {
+                            hits += kernels_->find_covering(cell.ellipses, &batches.xs[position], &batches.ys[position],
+                                                            1, &batches.owners[position]);
+                        } else {
+                            batches.owners[position] = cell.ids.size();
+                        }
+                    }
+                }
+                // Kernel indices are positions within the cell; map them to ids
+                for (size_t position = begin; position < end; ++position) {
+                    const size_t index = batches.owners[position];
+                    owners[start + batches.order[position]] = index < cell.ids.size() ? cell.ids[index] : NO_ELLIPSE;
+                }
+            }
+        }
+        return hits;
+    }
+
+    EllipseGrid::CellBatches &EllipseGrid::group_by_cell(const double *xs, const double *ys, size_t count,
+                                                         unsigned char *covered, size_t *owners) const {
+        // Per thread, since compute threads share the grid
+        thread_local CellBatches batches;
+        batches.cells.clear();
+        batches.begins.clear();
+        batches.settled_hits = 0;
+        batches.pending.resize(count);
+        batches.cell_of.resize(count);
+        if (batches.counts.size() < cells_.size()) {
+            batches.counts.resize(cells_.size(), 0);
+        }
+
+        // Empty and full cells need no kernel, so their points are answered here and not sorted
+        size_t partial = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t index = static_cast<uint32_t>(cell_index(xs[i], ys[i]));
+            const Cell &cell = cells_[index];
+            if (cell.is_full() || cell.ids.empty()) {
+                const bool full = cell.is_full();
+                batches.settled_hits += full;
+                if (covered) {
+                    covered[i] = full;
+                }
+                if (owners) {
+                    owners[i] = full ? cell.full_by.front() : NO_ELLIPSE;
+                }
+                continue;
+            }
+            batches.pending[partial] = i;
+            batches.cell_of[partial++] = index;
+            if (batches.counts[index]++ == 0) {
+                batches.cells.push_back(index);
+            }
+        }
+
+        // Counting sort of the rest; only the cells the batch touches are visited
+        size_t begin = 0;
+        for (uint32_t cell : batches.cells) {
+            batches.begins.push_back(begin);
+            begin += batches.counts[cell];
+            batches.counts[cell] = batches.begins.back(); // Now the next free position of the cell
+        }
+        batches.begins.push_back(begin);
+
+        batches.order.resize(partial);
+        batches.xs.resize(partial);
+        batches.ys.resize(partial);
+        batches.covered.resize(covered ? partial : 0);
+        batches.owners.resize(owners ? partial : 0);
+        for (size_t k = 0; k < partial; ++k) {
+            const size_t i = batches.pending[k];
+            const size_t position = batches.counts[batches.cell_of[k]]++;
+            batches.order[position] = i;
+            batches.xs[position] = xs[i];
+            batches.ys[position] = ys[i];
+        }
+        for (uint32_t cell : batches.cells) {
+            batches.counts[cell] = 0;
+        }
+        return batches;
+    }
+
+    size_t EllipseGrid::cell_index(double x, double y) const {
+        const int col = to_cell(x, Canvas::MIN_X, inv_cell_width_);
+        const int row = to_cell(y, Canvas::MIN_Y, inv_cell_height_);
+        return static_cast<size_t>(row) * resolution_ + col;
+    }
+
+    PartialRegion EllipseGrid::partial_region() const {
+        PartialRegion region{{}, {}, cell_width_, cell_height_, 0, cells_.size()};
+        for (int row = 0; row < resolution_; ++row) {
+            for (int col = 0; col < resolution_; ++col) {
+                const Cell &cell = cells_[static_cast<size_t>(row) * resolution_ + col];
+                if (cell.is_full()) {
+                    ++region.full_cells;
+                } else if (cell.ellipses.size() > 0) {
+                    region.x0.push_back(Canvas::MIN_X + col * cell_width_);
+                    region.y0.push_back(Canvas::MIN_Y + row * cell_height_);
+                }
+            }
+        }
+        return region;
+    }
+
+    int EllipseGrid::to_cell(double value, double min, double inv_cell_size) const {
+        double scaled = (value - min) * inv_cell_size;
+        if (!(scaled >= 0.0)) { // Also catches NaN
+            return 0;
+        }
+        if (scaled >= resolution_) {
+            return resolution_ - 1;
+        }
+        return static_cast<int>(scaled);
+    }
+
+} // namespace Server
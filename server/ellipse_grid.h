@@ -0,0 +1,201 @@
+#pragma once
+
+#include "common/ellipse.h"
+#include "containment_kernel.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Server {
+
+    /**
+     * @brief The grid cells whose coverage is uncertain: they overlap an ellipse but are not full.
+     * Every point of the canvas outside these cells is either certainly covered (full cells)
+     * or certainly not (cells no ellipse touches).
+     */
+    struct PartialRegion {
+        std::vector<double> x0; // Left edge of each partial cell
+        std::vector<double> y0; // Bottom edge of each partial cell
+        double cell_width;
+        double cell_height;
+        size_t full_cells;      // Number of cells entirely inside an ellipse
+        size_t total_cells;     // Number of cells in the grid
+    };
+
+    /**
+     * @brief Uniform grid over the canvas that buckets ellipses by the cells they touch.
+     * A point is only tested against the ellipses of its own cell. Cells lying entirely
+     * inside an ellipse are marked full; their points are covered without any test. Each
+     * ellipse is stored under the id its owner gave it, so it can be erased again, and a
+     * full cell keeps the ellipses that only overlap it in case the ones filling it go.
+     * The grid tests points with the containment kernels of the widest shape inserted so
+     * far; the table is switched only when an insert widens it, so a session of circles
+     * keeps the circle kernels throughout.
+     */
+    class EllipseGrid {
+    public:
+        /**
+         * @brief Constructor.
+         * @param resolution The number of cells along each canvas axis.
+         */
+        explicit EllipseGrid(int resolution = DEFAULT_RESOLUTION);
+
+        /**
+         * @brief Adds an ellipse to every cell it overlaps.
+         * @param ellipse The ellipse to add.
+         * @param id The id to erase it by later.
+         */
+        void insert(const Ellipse &ellipse, size_t id);
+
+        /**
+         * @brief Removes an ellipse that was inserted before.
+         * @param ellipse The ellipse, exactly as inserted.
+         * @param id The id it was inserted with.
+         */
+        void erase(const Ellipse &ellipse, size_t id);
+
+        /**
+         * @brief Removes all ellipses.
+         */
+        void clear();
+
+        /**
+         * @brief Checks if a canvas point is inside at least one ellipse.
+         * @param x The x-coordinate of the point.
+         * @param y The y-coordinate of the point.
+         * @return True if the point is covered, false otherwise.
+         */
+        bool is_covered(double x, double y) const;
+
+        /**
+         * @brief Tests a batch of canvas points.
+         * Points in partial cells are grouped by cell, GROUP_SIZE at a time; each group goes through the batch
+         * kernel in one call, unless it is too small to fill the vectors or its cell holds many ellipses.
+         * @param xs The x-coordinates of the points.
+         * @param ys The y-coordinates of the points.
+         * @param count The number of points.
+         * @param covered If not null, receives 1 for each covered point and 0 otherwise.
+         * @return The number of covered points.
+         */
+        size_t count_covered(const double *xs, const double *ys, size_t count, unsigned char *covered) const;
+
+        /**
+         * @brief Finds an ellipse containing each point of a batch, at the cost of count_covered().
+         * @param xs The x-coordinates of the points.
+         * @param ys The y-coordinates of the points.
+         * @param count The number of points.
+         * @param owners Receives the id of an ellipse containing each point, or NO_ELLIPSE.
+         * @return The number of covered points.
+         */
+        size_t find_covering(const double *xs, const double *ys, size_t count, size_t *owners) const;
+
+        /**
+         * @brief Gets the containment kernels the grid tests with.
+         * They handle every ellipse inserted so far, so callers testing points against one
+         * of those ellipses use them too.
+         * @return The kernels for the widest shape inserted since construction or clear().
+         */
+        const ContainmentKernel::ShapeKernels &get_kernels() const { return *kernels_; }
+
+        /**
+         * @brief Collects the partial cells and counts the full ones.
+         * @return The region where sampling is still needed.
+         */
+        PartialRegion partial_region() const;
+
+        static constexpr int DEFAULT_RESOLUTION = 32;
+        static constexpr size_t NO_ELLIPSE = static_cast<size_t>(-1);
+        static constexpr size_t GROUP_SIZE = 1 << 16; // Points sorted by cell at a time, so the scratch stays in cache
+
+    private:
+        /**
+         * @brief Ellipses overlapping one grid cell.
+         */
+        struct Cell {
+            EllipseSoA ellipses;         // Ellipses overlapping the cell without containing it
+            std::vector<size_t> ids;     // Id of each of those ellipses
+            std::vector<size_t> full_by; // Ids of the ellipses containing the whole cell
+
+            bool is_full() const { return !full_by.empty(); }
+        };
+
+        /**
+         * @brief The points of a batch in partial cells, sorted by cell, in per-thread scratch buffers.
+         * The points of cells[k] are at positions begins[k] to begins[k + 1] of xs and ys;
+         * order maps each position back to the point's index in the batch.
+         */
+        struct CellBatches {
+            std::vector<uint32_t> cells;
+            std::vector<size_t> begins;
+            std::vector<size_t> order;
+            std::vector<double> xs;
+            std::vector<double> ys;
+            std::vector<unsigned char> covered; // Kernel results by position, for the caller to scatter back
+            std::vector<size_t> owners;         // Likewise
+            std::vector<size_t> pending;        // Points left for the kernels, in batch order
+            std::vector<uint32_t> cell_of;      // Cell of each of those points
+            std::vector<size_t> counts;         // Points per cell, indexed by cell; all zero between calls
+            size_t settled_hits = 0;            // Points of full cells
+        };
+
+        static constexpr size_t MIN_KERNEL_POINTS = 16;   // Fewer points of a cell do not fill the batch vectors
+        static constexpr size_t MAX_KERNEL_ELLIPSES = 16; // Beyond this, stopping at a point's first hit wins
+
+        /**
+         * @brief Chooses between the batch kernel and one is_covered() call per point for a cell's points.
+         * @param points The number of points in the cell.
+         * @param ellipses The number of ellipses in the cell.
+         * @return True to use the batch kernel.
+         */
+        static bool prefers_batch_kernel(size_t points, size_t ellipses) {
+            return points >= MIN_KERNEL_POINTS && ellipses <= MAX_KERNEL_ELLIPSES;
+        }
+
+        /**
+         * @brief Answers the points of empty and full cells and sorts the rest by cell.
+         * @param xs The x-coordinates of the points.
+         * @param ys The y-coordinates of the points.
+         * @param count The number of points.
+         * @param covered If not null, receives 1 for each point of a full cell and 0 for each of an empty one.
+         * @param owners If not null, receives the owner of each point of a full or empty cell.
+         * @return The calling thread's scratch buffers, valid until its next call.
+         */
+        CellBatches &group_by_cell(const double *xs, const double *ys, size_t count, unsigned char *covered,
+                                   size_t *owners) const;
+
+        /**
+         * @brief Gets the cell a canvas point falls in.
+         * @param x The x-coordinate of the point.
+         * @param y The y-coordinate of the point.
+         * @return The row-major cell index.
+         */
+        size_t cell_index(double x, double y) const;
+
+        /**
+         * @brief Adds an ellipse to, or removes it from, every cell it overlaps.
+         * Both directions classify the cells the same way, so an erase undoes its insert exactly.
+         * @param ellipse The ellipse.
+         * @param id Its id.
+         * @param insert True to add, false to remove.
+         */
+        void update_cells(const Ellipse &ellipse, size_t id, bool insert);
+
+        /**
+         * @brief Maps a coordinate to its cell column or row, clamped to the grid.
+         * @param value The coordinate.
+         * @param min The canvas minimum along that axis.
+         * @param inv_cell_size The inverse of the cell size along that axis.
+         * @return The column or row index.
+         */
+        int to_cell(double value, double min, double inv_cell_size) const;
+
+        int resolution_;
+        double cell_width_;
+        double cell_height_;
+        double inv_cell_width_;
+        double inv_cell_height_;
+        std::vector<Cell> cells_; // Row-major, resolution_ x resolution_
+        const ContainmentKernel::ShapeKernels *kernels_;
+    };
+
+} // namespace Server
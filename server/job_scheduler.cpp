@@ -0,0 +1,46 @@
+#include "job_scheduler.h"
+#include <utility>
+
+namespace Server {
+
+    JobScheduler::JobScheduler(ThreadPool &pool) : pool_(pool) {}
+
+    bool JobScheduler::LessUrgent::operator()(const Entry &a, const Entry &b) const {
+        if (a.priority != b.priority) {
+            return a.priority < b.priority;
+        }
+        if (a.deadline != b.deadline) {
+            return a.deadline > b.deadline;
+        }
+        return a.order > b.order;
+    }
+
+    void JobScheduler::submit(int priority, Clock::time_point deadline, std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push({priority, deadline, next_order_++, std::move(job)});
+        }
+        // One pool task per job; which job it runs is decided only when it starts
+        pool_.submit([this] { run_next(); });
+    }
+
+    std::size_t JobScheduler::get_queued_count() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size();
+    }
+
+    void JobScheduler::run_next() {
+        std::function<void()> job;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty()) {
+                return;
+            }
+            // top() is const; the entry is popped right after, so moving the job out is safe
+            job = std::move(const_cast<Entry &>(queue_.top()).job);
+            queue_.pop();
+        }
+        job();
+    }
+
+} // namespace Server
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace Server {
+
+    /**
+     * @brief Orders compute jobs by priority, then by deadline, on a thread pool.
+     * Jobs wait in a priority queue rather than in the pool's FIFO: every submit queues one
+     * pool task that, when a worker picks it up, runs whichever job is most urgent at that
+     * moment. Among equal priorities the earliest deadline runs first, and jobs without a
+     * deadline run in submission order after those with one.
+     */
+    class JobScheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Constructor.
+         * @param pool The workers that run the jobs; must outlive the scheduler's pending tasks.
+         */
+        explicit JobScheduler(ThreadPool &pool);
+
+        JobScheduler(const JobScheduler &) = delete;
+        JobScheduler &operator=(const JobScheduler &) = delete;
+
+        /**
+         * @brief Queues a job.
+         * @param priority Higher priorities run first.
+         * @param deadline When the job's answer is due; Clock::time_point::max() if never.
+         * @param job The work to run on a pool thread.
+         */
+        void submit(int priority, Clock::time_point deadline, std::function<void()> job);
+
+        /**
+         * @brief Gets the number of jobs waiting for a worker.
+         * @return The queue length.
+         */
+        std::size_t get_queued_count() const;
+
+    private:
+        struct Entry {
+            int priority;
+            Clock::time_point deadline;
+            uint64_t order; // Submission order, to keep equal jobs first come, first served
+            std::function<void()> job;
+        };
+
+        /**
+         * @brief Orders the heap so that its top is the most urgent job.
+         */
+        struct LessUrgent {
+            bool operator()(const Entry &a, const Entry &b) const;
+        };
+
+        /**
+         * @brief Pops and runs the most urgent job (pool thread).
+         */
+        void run_next();
+
+        ThreadPool &pool_;
+        mutable std::mutex mutex_;
+        std::priority_queue<Entry, std::vector<Entry>, LessUrgent> queue_;
+        uint64_t next_order_ = 0;
+    };
+
+} // namespace Server
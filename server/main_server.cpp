@@ -1,38 +1,61 @@
 #include "server.h"
-#include <iostream>
+#include "common/logger.h"
+#include <optional>
 #include <stdexcept>
 #include <string>
 
 const int DEFAULT_PORT = 12345;
+const int DEFAULT_NUM_THREADS = 1;
 
 int main(int argc, char *argv[]) {
     int port = DEFAULT_PORT;
+    int num_threads = DEFAULT_NUM_THREADS;
+    std::optional<unsigned int> seed;
+    std::optional<std::string> snapshot_dir;
+    std::optional<std::string> data_dir;
 
-    if (argc > 2) {
-        std::cerr << "Usage: " << argv[0] << " [port]" << std::endl;
+    if (argc > 6) {
+        LOG_ERROR("Usage: " << argv[0] << " [port] [threads] [seed] [snapshot_dir] [data_dir]");
         return 1;
     }
-    if (argc == 2) {
-        try {
+
+    try {
+        if (argc >= 2) {
             port = std::stoi(argv[1]);
             if (port <= 0 || port > 65535) {
-                std::cerr << "Error: Port number must be between 1 and 65535." << std::endl;
+                LOG_ERROR("Port number must be between 1 and 65535.");
+                return 1;
+            }
+        }
+        if (argc >= 3) {
+            num_threads = std::stoi(argv[2]);
+            if (num_threads <= 0) {
+                LOG_ERROR("Number of threads must be positive.");
                 return 1;
             }
-        } catch (const std::invalid_argument &e) {
-            std::cerr << "Error: Invalid port number '" << argv[1] << "'. Must be an integer." << std::endl;
-            return 1;
-        } catch (const std::out_of_range &e) {
-            std::cerr << "Error: Port number '" << argv[1] << "' out of range." << std::endl;
-            return 1;
         }
+        if (argc >= 4) {
+            seed = static_cast<unsigned int>(std::stoul(argv[3]));
+        }
+        if (argc >= 5 && argv[4][0] != '\0') {
+            snapshot_dir = argv[4];
+        }
+        if (argc >= 6) {
+            data_dir = argv[5];
+        }
+    } catch (const std::invalid_argument &e) {
+        LOG_ERROR("Invalid argument type provided. " << e.what());
+        return 1;
+    } catch (const std::out_of_range &e) {
+        LOG_ERROR("Argument value out of range. " << e.what());
+        return 1;
     }
 
     try {
-        Server::TcpServer server(port);
+        Server::TcpServer server(port, static_cast<unsigned int>(num_threads), seed, snapshot_dir, data_dir);
         server.start();
     } catch (const std::exception &e) {
-        std::cerr << "Server runtime error: " << e.what() << std::endl;
+        LOG_ERROR("Server runtime error: " << e.what());
         return 1;
     }
 
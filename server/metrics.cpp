@@ -0,0 +1,133 @@
+#include "metrics.h"
+#include <sstream>
+#include <thread>
+
+namespace Server {
+
+    namespace {
+        const char *const COUNTER_NAMES[] = {
+            "ellipse_bytes_received_total",
+            "ellipse_bytes_sent_total",
+            "ellipse_sessions_accepted_total",
+            "ellipse_sessions_closed_total",
+            "ellipse_protocol_errors_total",
+            "ellipse_requests_total",
+            "ellipse_cache_hits_total",
+            "ellipse_samples_total",
+            "ellipse_estimate_microseconds_total",
+            "ellipse_estimates_interrupted_total",
+            "ellipse_requests_coalesced_total",
+            "ellipse_jobs_cancelled_total",
+            "ellipse_partial_results_total",
+            "ellipse_edits_total",
+            "ellipse_jobs_failed_total",
+        };
+        const char *const HISTOGRAM_NAMES[] = {
+            "ellipse_estimate_latency_microseconds",
+            "ellipse_samples_per_estimate",
+        };
+        static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) == static_cast<std::size_t>(Counter::Count));
+        static_assert(sizeof(HISTOGRAM_NAMES) / sizeof(HISTOGRAM_NAMES[0]) == static_cast<std::size_t>(Histogram::Count));
+
+        std::atomic<uint64_t> next_instance_id{1};
+
+        // Last shard used by this thread; avoids the registry lock on every record
+        thread_local uint64_t cached_instance_id = 0;
+        thread_local void *cached_shard = nullptr;
+
+        int bucket_of(uint64_t value) {
+            int bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+            return bucket < Metrics::HISTOGRAM_BUCKETS ? bucket : Metrics::HISTOGRAM_BUCKETS - 1;
+        }
+    } // namespace
+
+    Metrics::Metrics() : instance_id_(next_instance_id.fetch_add(1)) {}
+
+    Metrics::~Metrics() = default;
+
+    void Metrics::add(Counter counter, uint64_t amount) {
+        bump(local_shard().counters[static_cast<std::size_t>(counter)], amount);
+    }
+
+    void Metrics::record(Histogram histogram, uint64_t value) {
+        Shard &shard = local_shard();
+        const std::size_t index = static_cast<std::size_t>(histogram);
+        bump(shard.buckets[index][bucket_of(value)], 1);
+        bump(shard.sums[index], value);
+    }
+
+    uint64_t Metrics::get(Counter counter) const {
+        std::lock_guard<std::mutex> lock(shards_mutex_);
+        uint64_t total = 0;
+        for (const auto &shard : shards_) {
+            total += shard->counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    std::string Metrics::render() const {
+        std::array<uint64_t, NUM_COUNTERS> counters{};
+        std::array<std::array<uint64_t, HISTOGRAM_BUCKETS>, NUM_HISTOGRAMS> buckets{};
+        std::array<uint64_t, NUM_HISTOGRAMS> sums{};
+        {
+            std::lock_guard<std::mutex> lock(shards_mutex_);
+            for (const auto &shard : shards_) {
+                for (std::size_t c = 0; c < NUM_COUNTERS; ++c) {
+                    counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+                }
+                for (std::size_t h = 0; h < NUM_HISTOGRAMS; ++h) {
+                    for (int b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+                        buckets[h][b] += shard->buckets[h][b].load(std::memory_order_relaxed);
+                    }
+                    sums[h] += shard->sums[h].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::ostringstream out;
+        for (std::size_t c = 0; c < NUM_COUNTERS; ++c) {
+            out << "# TYPE " << COUNTER_NAMES[c] << " counter\n"
+                << COUNTER_NAMES[c] << " " << counters[c] << "\n";
+        }
+        for (std::size_t h = 0; h < NUM_HISTOGRAMS; ++h) {
+            const char *name = HISTOGRAM_NAMES[h];
+            out << "# TYPE " << name << " histogram\n";
+            uint64_t cumulative = 0;
+            for (int b = 0; b < HISTOGRAM_BUCKETS - 1; ++b) {
+                cumulative += buckets[h][b];
+                if (buckets[h][b] != 0) { // Empty buckets add nothing to the cumulative counts
+                    out << name << "_bucket{le=\"" << ((uint64_t{1} << b) - 1) << "\"} " << cumulative << "\n";
+                }
+            }
+            cumulative += buckets[h][HISTOGRAM_BUCKETS - 1];
+            out << name << "_bucket{le=\"+Inf\"} " << cumulative << "\n"
+                << name << "_sum " << sums[h] << "\n"
+                << name << "_count " << cumulative << "\n";
+        }
+        return out.str();
+    }
+
+    Metrics::Shard &Metrics::local_shard() {
+        if (cached_instance_id == instance_id_) {
+            return *static_cast<Shard *>(cached_shard);
+        }
+
+        // A thread switching between instances finds its shard again by thread id, so the
+        // shard count stays at one per thread per instance. Ids are only reused once their thread
+        // has exited, so a shard never has two writers.
+        Shard *raw = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(shards_mutex_);
+            auto [it, inserted] = shard_of_thread_.try_emplace(std::this_thread::get_id(), nullptr);
+            if (inserted) {
+                shards_.push_back(std::make_unique<Shard>());
+                it->second = shards_.back().get();
+            }
+            raw = it->second;
+        }
+        cached_instance_id = instance_id_;
+        cached_shard = raw;
+        return *raw;
+    }
+
+} // namespace Server
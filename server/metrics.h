@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Server {
+
+    /**
+     * @brief Monotonic event counters.
+     */
+    enum class Counter {
+        BytesIn,              // Bytes received from clients
+        BytesOut,             // Bytes sent to clients
+        SessionsAccepted,     // Client connections accepted
+        SessionsClosed,       // Client connections closed
+        ProtocolErrors,       // Sessions rejected for malformed input
+        Requests,             // Requests answered with an estimate
+        CacheHits,            // Requests answered from the result cache
+        SamplesDrawn,         // Points tested by Monte Carlo estimates
+        EstimateMicros,       // Compute time spent in estimates
+        EstimatesInterrupted, // Estimates cut short by a deadline or a newer request
+        RequestsCoalesced,    // Requests answered by the estimate of a newer request
+        JobsCancelled,        // Queued jobs dropped because their client disconnected
+        PartialResults,       // Estimates streamed to clients before convergence
+        EllipseEdits,         // Ellipses removed or replaced by clients
+        JobsFailed,           // Jobs that threw; their sessions are rejected
+        Count                 // Number of counters; not a counter
+    };
+
+    /**
+     * @brief Value distributions, kept in power-of-two buckets.
+     */
+    enum class Histogram {
+        EstimateLatencyMicros, // Time per estimate, including cache hits
+        SamplesPerEstimate,    // Points tested per Monte Carlo estimate
+        Count                  // Number of histograms; not a histogram
+    };
+
+    /**
+     * @brief Low-overhead server metrics.
+     * Every recording thread writes only to its own cache-line aligned shard, with relaxed
+     * atomic stores and no locks or contended read-modify-write operations. Rendering sums
+     * the shards; a mutex is only taken when a thread records into a different instance than
+     * last time.
+     */
+    class Metrics {
+    public:
+        static constexpr int HISTOGRAM_BUCKETS = 40; // Bucket i holds values in [2^(i-1), 2^i); the last one everything above
+
+        Metrics();
+        ~Metrics();
+
+        Metrics(const Metrics &) = delete;
+        Metrics &operator=(const Metrics &) = delete;
+
+        /**
+         * @brief Adds to a counter.
+         * @param counter The counter.
+         * @param amount The amount to add.
+         */
+        void add(Counter counter, uint64_t amount = 1);
+
+        /**
+         * @brief Records one value in a histogram.
+         * @param histogram The histogram.
+         * @param value The value.
+         */
+        void record(Histogram histogram, uint64_t value);
+
+        /**
+         * @brief Gets the current total of a counter over all threads.
+         * @param counter The counter.
+         * @return The total.
+         */
+        uint64_t get(Counter counter) const;
+
+        /**
+         * @brief Renders all metrics in the Prometheus text exposition format.
+         * @return One "name value" line per counter, plus bucket, sum and count lines per histogram.
+         */
+        std::string render() const;
+
+    private:
+        static constexpr std::size_t NUM_COUNTERS = static_cast<std::size_t>(Counter::Count);
+        static constexpr std::size_t NUM_HISTOGRAMS = static_cast<std::size_t>(Histogram::Count);
+
+        /**
+         * @brief The metrics written by one thread.
+         */
+        struct alignas(64) Shard {
+            std::array<std::atomic<uint64_t>, NUM_COUNTERS> counters{};
+            std::array<std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS>, NUM_HISTOGRAMS> buckets{};
+            std::array<std::atomic<uint64_t>, NUM_HISTOGRAMS> sums{};
+        };
+
+        /**
+         * @brief Gets the calling thread's shard, creating it on the thread's first use of this instance.
+         * @return The shard; only the calling thread writes to it.
+         */
+        Shard &local_shard();
+
+        /**
+         * @brief Increments a value that only the calling thread writes.
+         */
+        static void bump(std::atomic<uint64_t> &value, uint64_t amount) {
+            value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        const uint64_t instance_id_; // Distinguishes instances in the per-thread shard lookup
+        mutable std::mutex shards_mutex_;
+        std::vector<std::unique_ptr<Shard>> shards_; // Outlive their threads, so totals never drop
+        std::unordered_map<std::thread::id, Shard *> shard_of_thread_;
+    };
+
+} // namespace Server
@@ -1,98 +1,491 @@
 #include "monte_carlo_simulator.h"
 #include "common/canvas.h"
-#include "common/point.h"
+#include "common/logger.h"
+#include <algorithm>
 #include <cmath>
-#include <iostream>
+#include <memory>
+#include <vector>
 
 namespace Server {
 
-    MonteCarloSimulator::MonteCarloSimulator()
-        : random_generator_(std::random_device{}()) {}
+    MonteCarloSimulator::MonteCarloSimulator(const SimulatorConfig &config)
+        : empty_slots_(0),
+          grid_(config.grid_resolution),
+          scanline_strips_(config.scanline_strips),
+          raster_(config.raster_resolution),
+          raster_synced_count_(0),
+          pool_(config.pool),
+          seed_(config.seed ? *config.seed : std::random_device{}()),
+          generator_kind_(config.generator),
+          streams_(std::max(1u, config.num_streams)),
+          incremental_(config.incremental),
+          max_sample_set_(config.max_sample_set),
+          sample_budget_(config.sample_budget),
+          sample_set_size_(0),
+          sample_set_hits_(0) {
+        seed_streams();
+    }
+
+    MonteCarloSimulator::~MonteCarloSimulator() {
+        if (sample_budget_) {
+            sample_budget_->release(sample_set_size_);
+        }
+    }
+
+    bool MonteCarloSimulator::is_empty_slot(const Ellipse &ellipse) {
+        return ellipse.cx == EMPTY_SLOT.cx && ellipse.cy == EMPTY_SLOT.cy && ellipse.a == EMPTY_SLOT.a &&
+               ellipse.b == EMPTY_SLOT.b && ellipse.angle == EMPTY_SLOT.angle;
+    }
 
     void MonteCarloSimulator::add_ellipse(const Ellipse &ellipse) {
+        const size_t id = ellipses_.size();
         ellipses_.push_back(ellipse);
+        if (is_empty_slot(ellipse)) {
+            ++empty_slots_;
+            return;
+        }
+        grid_.insert(ellipse, id);
+
+        if (incremental_ && !uncovered_xs_.empty()) {
+            remove_covered_samples(ellipse, id);
+        }
     }
 
-    MonteCarloResult MonteCarloSimulator::estimate_area() {
-        if (ellipses_.empty()) {
+    void MonteCarloSimulator::add_ellipses(const Ellipse *ellipses, size_t count) {
+        const size_t first_id = ellipses_.size();
+        ellipses_.insert(ellipses_.end(), ellipses, ellipses + count);
+        for (size_t i = 0; i < count; ++i) {
+            if (is_empty_slot(ellipses[i])) {
+                ++empty_slots_;
+            } else {
+                grid_.insert(ellipses[i], first_id + i);
+            }
+        }
+
+        if (incremental_ && !uncovered_xs_.empty() && count > 0) {
+            remove_grid_covered_samples();
+        }
+    }
+
+    bool MonteCarloSimulator::remove_ellipse(size_t id) {
+        if (!get_ellipse(id)) {
+            return false;
+        }
+        detach_ellipse(id);
+        ellipses_[id] = EMPTY_SLOT;
+        ++empty_slots_;
+        return true;
+    }
+
+    bool MonteCarloSimulator::update_ellipse(size_t id, const Ellipse &ellipse) {
+        if (!get_ellipse(id)) {
+            return false;
+        }
+        detach_ellipse(id);
+        ellipses_[id] = ellipse;
+        if (id < raster_synced_count_) {
+            raster_.insert(ellipse);
+        }
+        if (is_empty_slot(ellipse)) {
+            ++empty_slots_;
+            return true;
+        }
+        grid_.insert(ellipse, id);
+
+        if (incremental_ && !uncovered_xs_.empty()) {
+            remove_covered_samples(ellipse, id);
+        }
+        return true;
+    }
+
+    std::optional<Ellipse> MonteCarloSimulator::get_ellipse(size_t id) const {
+        if (id >= ellipses_.size() || is_empty_slot(ellipses_[id])) {
+            return std::nullopt;
+        }
+        return ellipses_[id];
+    }
+
+    MonteCarloResult MonteCarloSimulator::estimate_area(const EstimateOptions &options, const EstimateControl &control) {
+        if (get_ellipse_count() == 0) {
             return {0.0, 0.0};
         }
 
-        const double TOTAL_CANVAS_AREA = Canvas::get_area();
+        if (options.engine == AreaEngine::Scanline) {
+            double covered_area = ScanlineIntegrator::covered_area(ellipses_, scanline_strips_, pool_);
+            LOG_DEBUG("Scanline integration over " << scanline_strips_ << " strips");
+            return {covered_area, covered_area / Canvas::get_area() * 100.0, covered_area, covered_area, 0};
+        }
+
+        if (options.engine == AreaEngine::Raster) {
+            for (; raster_synced_count_ < ellipses_.size(); ++raster_synced_count_) {
+                raster_.insert(ellipses_[raster_synced_count_]);
+            }
+            double covered_area = raster_.covered_area();
+            LOG_DEBUG("Raster coverage at " << raster_.get_resolution() << "x" << raster_.get_resolution() << " cells");
+            return {covered_area, covered_area / Canvas::get_area() * 100.0, covered_area, covered_area, 0};
+        }
+
+        if (options.restrict_to_ellipses && options.sampler == SamplerKind::Uniform) {
+            return estimate_in_partial_cells(options.stopping, control);
+        }
+
+        SequentialStopping stopping(options.stopping);
+        if (options.sampler != SamplerKind::Uniform) {
+            return estimate_with_replicates(options.sampler, stopping, control);
+        }
+
+        // In incremental mode the persistent sample set counts first; it only needs to grow when
+        // its samples are not enough to reach the requested precision. Past its cap, the
+        // missing samples are drawn fresh and pooled with it.
+        long long total_points_sampled = incremental_ ? sample_set_size_ : 0;
+        long long points_inside_any_ellipse = incremental_ ? sample_set_hits_ : 0;
+        bool interrupted = false;
+        std::chrono::steady_clock::time_point next_report{};
+
+        while (!stopping.is_satisfied(total_points_sampled, points_inside_any_ellipse)) {
+            if (total_points_sampled > 0 && control.should_stop()) {
+                interrupted = true;
+                break;
+            }
+            if (total_points_sampled > 0 && control.progress_due(next_report)) {
+                control.on_progress(make_result(total_points_sampled, points_inside_any_ellipse,
+                                                stopping.binomial_interval(total_points_sampled, points_inside_any_ellipse)));
+            }
+            const long long round = control.limit_round(stopping.next_round_samples(total_points_sampled, points_inside_any_ellipse));
+            if (incremental_ && sample_set_size_ < max_sample_set_) {
+                const long long before_size = sample_set_size_;
+                const long long before_hits = sample_set_hits_;
+                if (extend_sample_set(samples_per_stream(std::min(round, max_sample_set_ - sample_set_size_)))) {
+                    total_points_sampled += sample_set_size_ - before_size;
+                    points_inside_any_ellipse += sample_set_hits_ - before_hits;
+                    continue;
+                }
+            }
+            size_t per_stream = samples_per_stream(round);
+            points_inside_any_ellipse += sample_round(false, SamplerKind::Uniform, per_stream);
+            total_points_sampled += static_cast<long long>(streams_.size() * per_stream);
+        }
+
+        MonteCarloResult result = make_result(total_points_sampled, points_inside_any_ellipse,
+                                              stopping.binomial_interval(total_points_sampled, points_inside_any_ellipse));
+        result.interrupted = interrupted;
+        return result;
+    }
+
+    void MonteCarloSimulator::clear_ellipses() {
+        ellipses_.clear();
+        empty_slots_ = 0;
+        grid_.clear();
+        raster_.clear();
+        raster_synced_count_ = 0;
+        uncovered_xs_ = {}; // Free the memory too, since its budget is given back
+        uncovered_ys_ = {};
+        covered_ = {};
+        if (sample_budget_) {
+            sample_budget_->release(sample_set_size_);
+        }
+        sample_set_size_ = 0;
+        sample_set_hits_ = 0;
+        seed_streams();
+    }
+
+    size_t MonteCarloSimulator::get_ellipse_count() const {
+        return ellipses_.size() - empty_slots_;
+    }
+
+    bool MonteCarloSimulator::is_incremental() const {
+        return incremental_;
+    }
+
+    void MonteCarloSimulator::seed_streams() {
+        for (size_t stream = 0; stream < streams_.size(); ++stream) {
+            streams_[stream].random.seed(generator_kind_, seed_, static_cast<unsigned int>(stream));
+        }
+    }
+
+    size_t MonteCarloSimulator::samples_per_stream(long long samples) const {
+        const long long batches = (samples + POINTS_PER_BATCH - 1) / POINTS_PER_BATCH;
+        const long long num_streams = static_cast<long long>(streams_.size());
+        return static_cast<size_t>(std::max(1LL, (batches + num_streams - 1) / num_streams)) * POINTS_PER_BATCH;
+    }
+
+    long long MonteCarloSimulator::sample_round(bool track_covered, SamplerKind sampler, size_t batch_size, const PartialRegion *region) {
+        auto run_stream = [&](size_t stream_index) {
+            StreamState &stream = streams_[stream_index];
+
+            stream.xs.resize(batch_size);
+            stream.ys.resize(batch_size);
+            stream.owners.resize(track_covered ? batch_size : 0);
+            if (region) {
+                PointSampler::fill_region(*region, stream.random, stream.xs.data(), stream.ys.data(), batch_size);
+            } else {
+                PointSampler::fill(sampler, stream.random, stream.xs.data(), stream.ys.data(), batch_size);
+            }
+
+            stream.hits = static_cast<long long>(
+                track_covered ? grid_.find_covering(stream.xs.data(), stream.ys.data(), batch_size, stream.owners.data())
+                              : grid_.count_covered(stream.xs.data(), stream.ys.data(), batch_size, nullptr));
+        };
+
+        if (pool_) {
+            pool_->parallel_for(streams_.size(), run_stream);
+        } else {
+            for (size_t stream = 0; stream < streams_.size(); ++stream) {
+                run_stream(stream);
+            }
+        }
+
+        // Reduce in stream order so the result does not depend on thread scheduling
+        long long hits = 0;
+        for (const StreamState &stream : streams_) {
+            hits += stream.hits;
+        }
+        return hits;
+    }
+
+    MonteCarloResult MonteCarloSimulator::estimate_in_partial_cells(const StoppingCriteria &criteria, const EstimateControl &control) {
+        const PartialRegion region = grid_.partial_region();
+        const double cell_fraction = 1.0 / static_cast<double>(region.total_cells);
+        const SampledRegion sampled{region.full_cells * cell_fraction, region.x0.size() * cell_fraction};
+        LOG_DEBUG("Sampling " << region.x0.size() << " partial cells; " << region.full_cells << " of "
+                  << region.total_cells << " cells are fully covered");
+
+        if (region.x0.empty()) {
+            double covered_area = sampled.fixed_fraction * Canvas::get_area();
+            return {covered_area, sampled.fixed_fraction * 100.0, covered_area, covered_area, 0};
+        }
+
+        SequentialStopping stopping(criteria, sampled);
         long long total_points_sampled = 0;
         long long points_inside_any_ellipse = 0;
+        bool interrupted = false;
+        std::chrono::steady_clock::time_point next_report{};
+
+        while (!stopping.is_satisfied(total_points_sampled, points_inside_any_ellipse)) {
+            if (total_points_sampled > 0 && control.should_stop()) {
+                interrupted = true;
+                break;
+            }
+            if (total_points_sampled > 0 && control.progress_due(next_report)) {
+                control.on_progress(make_result(total_points_sampled, points_inside_any_ellipse,
+                                                stopping.binomial_interval(total_points_sampled, points_inside_any_ellipse), sampled));
+            }
+            const long long round = control.limit_round(stopping.next_round_samples(total_points_sampled, points_inside_any_ellipse));
+            size_t per_stream = samples_per_stream(round);
+            points_inside_any_ellipse += sample_round(false, SamplerKind::Uniform, per_stream, &region);
+            total_points_sampled += static_cast<long long>(streams_.size() * per_stream);
+        }
 
-        std::uniform_real_distribution<double> distrib_x(Canvas::MIN_X, Canvas::MAX_X);
-        std::uniform_real_distribution<double> distrib_y(Canvas::MIN_Y, Canvas::MAX_Y);
+        MonteCarloResult result = make_result(total_points_sampled, points_inside_any_ellipse,
+                                              stopping.binomial_interval(total_points_sampled, points_inside_any_ellipse), sampled);
+        result.interrupted = interrupted;
+        return result;
+    }
+
+    MonteCarloResult MonteCarloSimulator::estimate_with_replicates(SamplerKind sampler, const SequentialStopping &stopping,
+                                                                   const EstimateControl &control) {
+        const size_t batch_size = PointSampler::STRUCTURED_BATCH_SIZE;
+        long long replicates = 0;
+        long long points_inside_any_ellipse = 0;
+        double fraction_sum = 0.0;
+        double fraction_sum_sq = 0.0;
+        bool interrupted = false;
+        std::chrono::steady_clock::time_point next_report{};
 
         while (true) {
-            for (int i = 0; i < POINTS_PER_BATCH; ++i) {
-                Point p = {distrib_x(random_generator_), distrib_y(random_generator_)};
-                total_points_sampled++;
-                for (const auto &ellipse : ellipses_) {
-                    if (ellipse.is_inside(p.x, p.y)) {
-                        points_inside_any_ellipse++;
-                        break; // Point is covered
-                    }
-                }
+            points_inside_any_ellipse += sample_round(false, sampler, batch_size);
+            for (const StreamState &stream : streams_) {
+                double fraction = static_cast<double>(stream.hits) / batch_size;
+                fraction_sum += fraction;
+                fraction_sum_sq += fraction * fraction;
+                ++replicates;
+            }
+            if (stopping.is_replicate_satisfied(replicates, static_cast<long long>(batch_size), fraction_sum, fraction_sum_sq)) {
+                break;
+            }
+            // The spread needs two batches before it says anything
+            if (replicates >= 2 && control.should_stop()) {
+                interrupted = true;
+                break;
+            }
+            if (replicates >= 2 && control.progress_due(next_report)) {
+                control.on_progress(make_result(replicates * static_cast<long long>(batch_size), points_inside_any_ellipse,
+                                                stopping.replicate_interval(replicates, fraction_sum, fraction_sum_sq)));
             }
+        }
+
+        MonteCarloResult result = make_result(replicates * static_cast<long long>(batch_size), points_inside_any_ellipse,
+                                              stopping.replicate_interval(replicates, fraction_sum, fraction_sum_sq));
+        result.interrupted = interrupted;
+        return result;
+    }
+
+    bool MonteCarloSimulator::extend_sample_set(size_t per_stream) {
+        const long long drawn = static_cast<long long>(streams_.size() * per_stream);
+        if (sample_budget_ && !sample_budget_->try_reserve(drawn)) {
+            return false;
+        }
+        sample_set_hits_ += sample_round(true, SamplerKind::Uniform, per_stream);
+        sample_set_size_ += drawn;
 
-            // If no points hit, continue sampling or determine area is effectively zero.
-            if (points_inside_any_ellipse == 0) {
-                if (total_points_sampled >= MAX_TOTAL_SAMPLES / 2 && ellipses_.size() > 0) { // Arbitrary large number for "effectively zero"
-                    // If many samples and still no hits, likely area is very small or zero
-                    break;
+        for (const StreamState &stream : streams_) {
+            for (size_t i = 0; i < per_stream; ++i) {
+                if (stream.owners[i] == EllipseGrid::NO_ELLIPSE) {
+                    uncovered_xs_.push_back(stream.xs[i]);
+                    uncovered_ys_.push_back(stream.ys[i]);
+                } else {
+                    CoveredSamples &owner = covered_samples(stream.owners[i]);
+                    owner.xs.push_back(stream.xs[i]);
+                    owner.ys.push_back(stream.ys[i]);
                 }
-                if (total_points_sampled >= MAX_TOTAL_SAMPLES)
-                    break; // Safety break
-                continue;  // Continue sampling
             }
+        }
+        return true;
+    }
 
-            double current_estimated_proportion = static_cast<double>(points_inside_any_ellipse) / total_points_sampled;
+    void MonteCarloSimulator::remove_covered_samples(const Ellipse &ellipse, size_t id) {
+        const size_t total = uncovered_xs_.size();
+        const size_t max_chunks = pool_ ? pool_->size() + 1 : 1;
+        const size_t num_chunks = std::max<size_t>(1, std::min(max_chunks, total / MIN_POINTS_PER_FILTER_CHUNK));
+        const size_t chunk_size = (total + num_chunks - 1) / num_chunks;
+        std::vector<size_t> kept(num_chunks, 0);
 
-            if (total_points_sampled < MIN_SAMPLES_FOR_ERROR_CHECK && total_points_sampled < MAX_TOTAL_SAMPLES) {
-                continue; // Not enough samples yet to reliably check error
-            }
+        // The grid already holds the ellipse, so its kernels cover the ellipse's shape
+        const ContainmentKernel::ShapeKernels &kernels = grid_.get_kernels();
 
-            double relative_error;
-            if (current_estimated_proportion <= 1e-9) {              // Proportion is effectively zero
-                relative_error = 1.0;                                // High error, continue sampling
-            } else if (current_estimated_proportion >= 1.0 - 1e-9) { // Proportion is effectively one
-                relative_error = 0.0;                                // No error, effectively covers everything
-            } else {
-                relative_error = std::sqrt((1.0 - current_estimated_proportion) /
-                                           (current_estimated_proportion * total_points_sampled));
-            }
+        // Left uninitialized: usually few points are inside, and only their pages get touched
+        std::unique_ptr<double[]> inside_xs(new double[total]);
+        std::unique_ptr<double[]> inside_ys(new double[total]);
+
+        // Each chunk moves its still-uncovered points to its front, keeping their order
+        auto filter_chunk = [&](size_t chunk) {
+            size_t begin = std::min(total, chunk * chunk_size);
+            size_t end = std::min(total, (chunk + 1) * chunk_size);
+            kept[chunk] = kernels.remove_inside(ellipse, uncovered_xs_.data() + begin, uncovered_ys_.data() + begin,
+                                                end - begin, inside_xs.get() + begin, inside_ys.get() + begin);
+        };
+
+        if (num_chunks > 1) {
+            pool_->parallel_for(num_chunks, filter_chunk);
+        } else {
+            filter_chunk(0);
+        }
 
-            if (relative_error <= TARGET_RELATIVE_ERROR) {
-                std::cout << "Stabilization achieved with relative error: " << relative_error * 100 << "%" << std::endl;
-                break; // Stabilization achieved
+        // Compact the kept prefixes; the outcome is the same as filtering in one pass
+        size_t write = kept[0];
+        for (size_t chunk = 1; chunk < num_chunks; ++chunk) {
+            size_t begin = std::min(total, chunk * chunk_size);
+            if (write != begin) {
+                std::move(uncovered_xs_.begin() + begin, uncovered_xs_.begin() + begin + kept[chunk], uncovered_xs_.begin() + write);
+                std::move(uncovered_ys_.begin() + begin, uncovered_ys_.begin() + begin + kept[chunk], uncovered_ys_.begin() + write);
             }
+            write += kept[chunk];
+        }
 
-            if (total_points_sampled >= MAX_TOTAL_SAMPLES) {
-                std::cerr << "Warning: Max samples (" << MAX_TOTAL_SAMPLES
-                          << ") reached. Using current estimate with relative error: "
-                          << relative_error * 100 << "%" << std::endl;
-                break;
+        CoveredSamples &owned = covered_samples(id);
+        for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+            size_t begin = std::min(total, chunk * chunk_size);
+            size_t end = std::min(total, (chunk + 1) * chunk_size);
+            size_t inside = end - begin - kept[chunk];
+            owned.xs.insert(owned.xs.end(), inside_xs.get() + begin, inside_xs.get() + begin + inside);
+            owned.ys.insert(owned.ys.end(), inside_ys.get() + begin, inside_ys.get() + begin + inside);
+        }
+
+        sample_set_hits_ += static_cast<long long>(total - write);
+        uncovered_xs_.resize(write);
+        uncovered_ys_.resize(write);
+    }
+
+    void MonteCarloSimulator::remove_grid_covered_samples() {
+        const size_t total = uncovered_xs_.size();
+        const size_t max_chunks = pool_ ? pool_->size() + 1 : 1;
+        const size_t num_chunks = std::max<size_t>(1, std::min(max_chunks, total / MIN_POINTS_PER_FILTER_CHUNK));
+        const size_t chunk_size = (total + num_chunks - 1) / num_chunks;
+        std::vector<size_t> owners(total);
+
+        // The remaining samples were uncovered before, so only the new ellipses can cover them
+        auto classify_chunk = [&](size_t chunk) {
+            size_t begin = std::min(total, chunk * chunk_size);
+            size_t end = std::min(total, (chunk + 1) * chunk_size);
+            grid_.find_covering(uncovered_xs_.data() + begin, uncovered_ys_.data() + begin, end - begin, owners.data() + begin);
+        };
+
+        if (num_chunks > 1) {
+            pool_->parallel_for(num_chunks, classify_chunk);
+        } else {
+            classify_chunk(0);
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < total; ++i) {
+            if (owners[i] == EllipseGrid::NO_ELLIPSE) {
+                uncovered_xs_[write] = uncovered_xs_[i];
+                uncovered_ys_[write] = uncovered_ys_[i];
+                ++write;
+            } else {
+                CoveredSamples &owner = covered_samples(owners[i]);
+                owner.xs.push_back(uncovered_xs_[i]);
+                owner.ys.push_back(uncovered_ys_[i]);
             }
         }
 
-        std::cout << "number of points inside any ellipse: " << points_inside_any_ellipse << std::endl;
-        std::cout << "total number of points sampled: " << total_points_sampled << std::endl;
+        sample_set_hits_ += static_cast<long long>(total - write);
+        uncovered_xs_.resize(write);
+        uncovered_ys_.resize(write);
+    }
 
-        double final_proportion = (total_points_sampled == 0) ? 0.0 : static_cast<double>(points_inside_any_ellipse) / total_points_sampled;
-        double covered_area = final_proportion * TOTAL_CANVAS_AREA;
-        double percentage_covered = final_proportion * 100.0;
+    void MonteCarloSimulator::release_covered_samples(size_t id) {
+        if (id >= covered_.size()) {
+            return; // Never owned a sample
+        }
+        // Take the bucket out first: reattributing may grow covered_ and move it
+        CoveredSamples released = std::move(covered_[id]);
+        covered_[id] = CoveredSamples{};
 
-        return {covered_area, percentage_covered};
+        std::vector<size_t> owners(released.xs.size());
+        grid_.find_covering(released.xs.data(), released.ys.data(), released.xs.size(), owners.data());
+        for (size_t i = 0; i < released.xs.size(); ++i) {
+            if (owners[i] != EllipseGrid::NO_ELLIPSE) {
+                CoveredSamples &samples = covered_samples(owners[i]);
+                samples.xs.push_back(released.xs[i]);
+                samples.ys.push_back(released.ys[i]);
+            } else {
+                uncovered_xs_.push_back(released.xs[i]);
+                uncovered_ys_.push_back(released.ys[i]);
+                --sample_set_hits_;
+            }
+        }
     }
 
-    void MonteCarloSimulator::clear_ellipses() {
-        ellipses_.clear();
+    MonteCarloSimulator::CoveredSamples &MonteCarloSimulator::covered_samples(size_t id) {
+        if (id >= covered_.size()) {
+            covered_.resize(ellipses_.size());
+        }
+        return covered_[id];
     }
 
-    size_t MonteCarloSimulator::get_ellipse_count() const {
-        return ellipses_.size();
+    void MonteCarloSimulator::detach_ellipse(size_t id) {
+        grid_.erase(ellipses_[id], id);
+        if (id < raster_synced_count_) {
+            raster_.erase(ellipses_, id);
+        }
+        if (incremental_) {
+            release_covered_samples(id);
+        }
+    }
+
+    MonteCarloResult MonteCarloSimulator::make_result(long long total_points_sampled, long long points_inside_any_ellipse,
+                                                      const ProportionInterval &interval, const SampledRegion &region) const {
+        LOG_DEBUG("number of points inside any ellipse: " << points_inside_any_ellipse);
+        LOG_DEBUG("total number of points sampled: " << total_points_sampled);
+
+        double sampled_proportion = (total_points_sampled == 0) ? 0.0 : static_cast<double>(points_inside_any_ellipse) / total_points_sampled;
+        double final_proportion = region.fixed_fraction + region.sampled_fraction * sampled_proportion;
+        double covered_area = final_proportion * Canvas::get_area();
+        double percentage_covered = final_proportion * 100.0;
+
+        return {covered_area, percentage_covered, interval.low * Canvas::get_area(), interval.high * Canvas::get_area(),
+                total_points_sampled};
     }
 
-} // namespace Server
\ No newline at end of file
+} // namespace Server
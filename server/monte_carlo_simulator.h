@@ -1,6 +1,19 @@
 #pragma once
 
 #include "common/ellipse.h"
+#include "coverage_raster.h"
+#include "ellipse_grid.h"
+#include "point_sampler.h"
+#include "random_generator.h"
+#include "sample_budget.h"
+#include "scanline_integrator.h"
+#include "sequential_stopping.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
 #include <random>
 #include <vector>
 
@@ -12,51 +25,386 @@ namespace Server {
     struct MonteCarloResult {
         double covered_area;
         double percentage_covered;
+        double interval_low = 0.0;  // Confidence interval of covered_area, in units²
+        double interval_high = 0.0;
+        long long samples = 0;      // Points sampled for the estimate; 0 for deterministic engines
+        bool interrupted = false;   // Cut short by an EstimateControl before reaching the stopping criteria
+    };
+
+    /**
+     * @brief Method used to compute the covered area.
+     */
+    enum class AreaEngine {
+        MonteCarlo, // Random sampling until the relative error target is met
+        Scanline,   // Deterministic strip-by-strip integration of the ellipse chords
+        Raster      // Covered cells of a fixed-resolution occupancy bitmap
+    };
+
+    /**
+     * @brief Per-request settings of an area estimate.
+     */
+    struct EstimateOptions {
+        AreaEngine engine = AreaEngine::MonteCarlo;
+        SamplerKind sampler = SamplerKind::Uniform; // Point placement of the Monte Carlo engine
+        StoppingCriteria stopping;                  // Precision at which the Monte Carlo engine stops
+        bool restrict_to_ellipses = false;          // Sample only grid cells partly covered by ellipses
+
+        // Scheduling of the request; they do not change what is estimated
+        int priority = 0;          // Requests with a higher priority run first
+        double deadline_ms = 0.0;  // Answer with the best estimate so far this long after arrival; 0 disables
+        bool coalesce = false;     // May be answered by the estimate of a newer request of the same session
+        double stream_ms = 0.0;    // Send the estimate so far this often until it converges; 0 disables
+    };
+
+    /**
+     * @brief Lets the caller watch and cut short a running sampling estimate.
+     * Checked between sampling rounds, never before the first one, so an interrupted or
+     * reported estimate always rests on some samples and carries the interval reached so far.
+     * While anything can interrupt or observe the estimate, rounds are limited to
+     * MAX_WATCHED_ROUND_SAMPLES points, so a check comes every few milliseconds instead of
+     * after a round that has doubled towards millions of points.
+     */
+    struct EstimateControl {
+        static constexpr long long MAX_WATCHED_ROUND_SAMPLES = 1 << 18;
+
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        const std::atomic<bool> *stop = nullptr; // Stop as soon as this becomes true; not owned
+        std::function<void(const MonteCarloResult &)> on_progress; // Receives estimates before convergence; may be empty
+        std::chrono::steady_clock::duration progress_interval{};   // Least time between two on_progress calls
+
+        /**
+         * @brief Checks whether the estimate should stop now.
+         * @return True once the deadline has passed or stop is set.
+         */
+        bool should_stop() const {
+            return (stop && stop->load(std::memory_order_relaxed)) ||
+                   (deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline);
+        }
+
+        /**
+         * @brief Limits the size of the next sampling round.
+         * @param samples The round size the stopping rule asks for.
+         * @return samples, capped at MAX_WATCHED_ROUND_SAMPLES if a deadline, stop flag or progress callback is set.
+         */
+        long long limit_round(long long samples) const {
+            const bool watched = stop || on_progress || deadline != std::chrono::steady_clock::time_point::max();
+            return watched ? std::min(samples, MAX_WATCHED_ROUND_SAMPLES) : samples;
+        }
+
+        /**
+         * @brief Checks whether progress should be reported now, and if so when next.
+         * The first check of an estimate is always due.
+         * @param next_report When the next report is due; start with a default-constructed time point.
+         * @return True if on_progress is set and due.
+         */
+        bool progress_due(std::chrono::steady_clock::time_point &next_report) const {
+            if (!on_progress) {
+                return false;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if (now < next_report) {
+                return false;
+            }
+            next_report = now + progress_interval;
+            return true;
+        }
+    };
+
+    /**
+     * @brief Configuration of a MonteCarloSimulator.
+     */
+    struct SimulatorConfig {
+        // Keep a persistent sample set between estimates so that adding an ellipse only
+        // re-tests the samples that are still uncovered. If false, every estimate resamples
+        // the whole canvas against all ellipses.
+        bool incremental = true;
+
+        // Most samples the persistent set keeps, covered or not (16 bytes each). Estimates
+        // that need more draw the rest fresh each time, as in non-incremental mode, and
+        // pool them with the kept ones. 2^20 samples reach the default 1% tolerance down to
+        // about 1% coverage.
+        long long max_sample_set = 1 << 20;
+
+        // Limit on persistent samples shared with other simulators, e.g. all sessions of a
+        // server. Not owned; nullptr leaves only max_sample_set.
+        SampleBudget *sample_budget = nullptr;
+
+        // Number of independent RNG streams. Sampling work is split across the streams and
+        // results are identical for a given seed and stream count, whatever the pool size.
+        unsigned int num_streams = 1;
+
+        // Seed for the RNG streams; drawn from std::random_device if not set.
+        std::optional<unsigned int> seed;
+
+        // Generator family of the RNG streams.
+        GeneratorKind generator = GeneratorKind::Xoshiro256Plus;
+
+        // Workers used to run the streams in parallel. Not owned; nullptr runs everything
+        // on the calling thread.
+        ThreadPool *pool = nullptr;
+
+        // Cells per canvas axis of the spatial grid used to prune containment tests.
+        int grid_resolution = EllipseGrid::DEFAULT_RESOLUTION;
+
+        // Horizontal strips used by the scanline engine.
+        int scanline_strips = ScanlineIntegrator::DEFAULT_STRIPS;
+
+        // Cells per canvas axis of the raster engine's occupancy bitmap.
+        int raster_resolution = CoverageRaster::DEFAULT_RESOLUTION;
     };
 
     /**
      * @brief Performs Monte Carlo simulation to estimate area covered by ellipses.
+     * Ellipses are identified by the order they were added in, starting at 0. A removed
+     * ellipse leaves an empty slot (EMPTY_SLOT), so later ids never shift; empty slots
+     * cover nothing and are not counted.
      */
     class MonteCarloSimulator {
     public:
+        static constexpr Ellipse EMPTY_SLOT{0.0, 0.0, 0.0, 0.0, 0.0};
+
         /**
          * @brief Constructor.
+         * @param config The simulator configuration.
+         */
+        explicit MonteCarloSimulator(const SimulatorConfig &config = {});
+
+        /**
+         * @brief Destructor. Gives the persistent samples back to the shared budget.
          */
-        MonteCarloSimulator();
+        ~MonteCarloSimulator();
+
+        MonteCarloSimulator(const MonteCarloSimulator &) = delete;
+        MonteCarloSimulator &operator=(const MonteCarloSimulator &) = delete;
+
+        /**
+         * @brief Checks whether an ellipse marks the slot of a removed one.
+         * @param ellipse The ellipse.
+         * @return True if it equals EMPTY_SLOT.
+         */
+        static bool is_empty_slot(const Ellipse &ellipse);
 
         /**
          * @brief Adds an ellipse to the simulator.
-         * @param ellipse The ellipse to add.
+         * Adding EMPTY_SLOT reserves an id without adding anything, e.g. to restore a saved set.
+         * @param ellipse The ellipse to add; its id is the number of ellipses added before it.
          */
         void add_ellipse(const Ellipse &ellipse);
 
+        /**
+         * @brief Adds many ellipses at once.
+         * Same result as calling add_ellipse() for each, but in incremental mode the
+         * persistent samples are filtered once against all new ellipses instead of once per ellipse.
+         * @param ellipses The ellipses to add.
+         * @param count The number of ellipses.
+         */
+        void add_ellipses(const Ellipse *ellipses, size_t count);
+
+        /**
+         * @brief Removes an ellipse.
+         * In incremental mode only the persistent samples attributed to the ellipse are
+         * tested again, and the raster engine only redraws the ellipse's own rows.
+         * @param id The id of the ellipse.
+         * @return False if there is no ellipse with this id.
+         */
+        bool remove_ellipse(size_t id);
+
+        /**
+         * @brief Replaces an ellipse, keeping its id.
+         * Costs one removal plus one add.
+         * @param id The id of the ellipse.
+         * @param ellipse The new ellipse.
+         * @return False if there is no ellipse with this id.
+         */
+        bool update_ellipse(size_t id, const Ellipse &ellipse);
+
+        /**
+         * @brief Gets an ellipse by id.
+         * @param id The id of the ellipse.
+         * @return The ellipse, or std::nullopt if the id was never given out or the ellipse was removed.
+         */
+        std::optional<Ellipse> get_ellipse(size_t id) const;
+
         /**
          * @brief Estimates the total area covered by all added ellipses.
-         * Runs trials until the estimated area stabilizes (relative error <= 1%).
+         * The Monte Carlo engine samples in growing rounds until the confidence interval of
+         * the estimate meets options.stopping; in incremental mode only the samples needed
+         * beyond the persistent set are drawn. Structured samplers always draw fresh batches, since the persistent set
+         * holds uniform points, and so do estimates restricted to the cells near ellipses. The scanline engine integrates the union deterministically instead,
+         * and the raster engine counts covered bitmap cells.
+         * @param options The engine and settings to use for this estimate.
+         * @param control When to stop sampling early and report progress; the deterministic engines always finish silently.
          * @return A MonteCarloResult struct with the covered area and percentage.
          */
-        MonteCarloResult estimate_area();
+        MonteCarloResult estimate_area(const EstimateOptions &options = {}, const EstimateControl &control = {});
 
         /**
-         * @brief Clears all stored ellipses.
+         * @brief Clears all stored ellipses and the persistent samples, and reseeds the RNG streams.
          */
         void clear_ellipses();
 
         /**
          * @brief Gets the number of ellipses currently stored.
-         * @return The count of ellipses.
+         * @return The count of ellipses, not counting empty slots.
          */
         size_t get_ellipse_count() const;
 
+        /**
+         * @brief Checks whether the simulator reuses samples between estimates.
+         * @return True in incremental mode, false otherwise.
+         */
+        bool is_incremental() const;
+
     private:
-        std::vector<Ellipse> ellipses_;
-        std::mt19937 random_generator_; // For generating points in simulation
+        /**
+         * @brief Persistent samples attributed to one ellipse that covers them.
+         */
+        struct CoveredSamples {
+            std::vector<double> xs;
+            std::vector<double> ys;
+        };
+
+        /**
+         * @brief Seeds every RNG stream from seed_ and its stream index.
+         */
+        void seed_streams();
+
+        /**
+         * @brief Splits a sample count over the streams, in whole POINTS_PER_BATCH batches.
+         * @param samples The number of samples wanted.
+         * @return The number of points each stream draws; at least one batch.
+         */
+        size_t samples_per_stream(long long samples) const;
+
+        /**
+         * @brief Draws one batch per stream into the stream buffers and counts the covered points.
+         * @param track_covered If true, each stream also records which ellipse covers each of its points, in the same pass.
+         * @param sampler How the points of each batch are placed.
+         * @param batch_size The number of points per stream.
+         * @param region If not null, points are drawn from these grid cells instead of the whole canvas.
+         * @return The number of covered points over all streams.
+         */
+        long long sample_round(bool track_covered, SamplerKind sampler, size_t batch_size, const PartialRegion *region = nullptr);
+
+        /**
+         * @brief Estimates the area by sampling only the grid cells that are partly covered.
+         * Full cells are counted exactly and cells no ellipse touches contribute nothing, so
+         * no samples are spent where the outcome is already known.
+         * @param criteria The stopping criteria.
+         * @param control When to stop early and report progress.
+         * @return The estimate.
+         */
+        MonteCarloResult estimate_in_partial_cells(const StoppingCriteria &criteria, const EstimateControl &control);
+
+        /**
+         * @brief Estimates the area with a structured sampler.
+         * Every batch is an independent randomization of the sampler's point set; the error
+         * is estimated from the spread of the per-batch covered fractions.
+         * @param sampler The sampler; must not be SamplerKind::Uniform.
+         * @param stopping The stopping rule.
+         * @param control When to stop early and report progress.
+         * @return The estimate.
+         */
+        MonteCarloResult estimate_with_replicates(SamplerKind sampler, const SequentialStopping &stopping,
+                                                  const EstimateControl &control);
+
+        /**
+         * @brief Draws points into the persistent sample set (incremental mode).
+         * Each point is tested against all stored ellipses; uncovered points are kept
+         * so that later ellipses only need to be tested against them.
+         * @param per_stream The number of points each stream draws.
+         * @return False if the shared budget has no room for them; nothing is drawn then.
+         */
+        bool extend_sample_set(size_t per_stream);
+
+        /**
+         * @brief Moves the uncovered persistent samples inside an ellipse to the covered ones (incremental mode).
+         * @param ellipse The newly added ellipse.
+         * @param id Its id, which the moved samples are attributed to.
+         */
+        void remove_covered_samples(const Ellipse &ellipse, size_t id);
+
+        /**
+         * @brief Moves the uncovered persistent samples inside any stored ellipse to the covered ones (incremental mode).
+         * Used after bulk adds, where one grid lookup per sample beats one pass per ellipse.
+         */
+        void remove_grid_covered_samples();
+
+        /**
+         * @brief Reattributes the persistent samples of an ellipse that left the grid (incremental mode).
+         * Each of them goes to another ellipse covering it, or back to the uncovered samples.
+         * @param id The id of the ellipse.
+         */
+        void release_covered_samples(size_t id);
+
+        /**
+         * @brief Returns the covered samples attributed to an ellipse, growing covered_ if needed.
+         * @param id The id of a stored ellipse.
+         * @return Its bucket of covered samples.
+         */
+        CoveredSamples &covered_samples(size_t id);
+
+        /**
+         * @brief Takes an ellipse out of the grid, and out of the raster if it was rasterized.
+         * @param id The id of a stored ellipse.
+         */
+        void detach_ellipse(size_t id);
+
+        /**
+         * @brief Converts hit counts into a covered area and percentage.
+         * @param total_points_sampled The number of points sampled.
+         * @param points_inside_any_ellipse The number of those points inside any ellipse.
+         * @param interval Confidence interval of the covered fraction of the canvas.
+         * @param region Where the points were sampled.
+         * @return The corresponding MonteCarloResult.
+         */
+        MonteCarloResult make_result(long long total_points_sampled, long long points_inside_any_ellipse,
+                                     const ProportionInterval &interval, const SampledRegion &region = {}) const;
+
+        /**
+         * @brief Generator and batch buffers of one RNG stream.
+         */
+        struct StreamState {
+            RandomStream random;                  // For generating points in simulation
+            std::vector<double> xs;               // Current batch, x-coordinates
+            std::vector<double> ys;               // Current batch, y-coordinates
+            std::vector<size_t> owners;           // Current batch, id of an ellipse covering each point or NO_ELLIPSE; only when tracked
+            long long hits = 0;                   // Covered points in the current batch
+        };
+
+        std::vector<Ellipse> ellipses_; // Indexed by id; removed ellipses are EMPTY_SLOT
+        size_t empty_slots_;            // Number of EMPTY_SLOT entries in ellipses_
+        EllipseGrid grid_;              // Same ellipses, bucketed by grid cell for containment tests
+
+        int scanline_strips_;
+
+        // Occupancy bitmap for the raster engine. Ellipses are rasterized on the first raster
+        // query after they were added, so sessions that never use the engine pay nothing.
+        // Removed and replaced ellipses that were rasterized are erased from their rows alone.
+        CoverageRaster raster_;
+        size_t raster_synced_count_; // Leading ellipses_ already rasterized
+
+        // Parallel sampling
+        ThreadPool *pool_;
+        unsigned int seed_;
+        GeneratorKind generator_kind_;
+        std::vector<StreamState> streams_;
+
+        // Persistent sample set for incremental mode, stored as structure of arrays. Covered
+        // samples are bucketed by the id of one ellipse covering them, so that removing an
+        // ellipse only touches its own samples.
+        bool incremental_;
+        long long max_sample_set_;
+        SampleBudget *sample_budget_;         // Where sample_set_size_ samples are reserved; may be null
+        std::vector<double> uncovered_xs_;     // Samples not inside any ellipse yet, x-coordinates
+        std::vector<double> uncovered_ys_;     // Samples not inside any ellipse yet, y-coordinates
+        std::vector<CoveredSamples> covered_;  // Indexed by id like ellipses_; grown on first use
+        long long sample_set_size_;            // Total samples drawn into the set
+        long long sample_set_hits_;            // Samples inside at least one ellipse
 
         // Constants for simulation
         static constexpr int POINTS_PER_BATCH = 1000;
-        static constexpr double TARGET_RELATIVE_ERROR = 0.01;          // 1%
-        static constexpr long long MIN_SAMPLES_FOR_ERROR_CHECK = 5000; // 5000; // Minimum total points before checking error
-        static constexpr long long MAX_TOTAL_SAMPLES = 20000000;       // 20000000; // Safety cap for samples
+        static constexpr size_t MIN_POINTS_PER_FILTER_CHUNK = 16384; // Below this, filtering samples is not worth a thread
     };
 
-} // namespace Server
\ No newline at end of file
+} // namespace Server
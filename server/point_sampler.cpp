@@ -0,0 +1,144 @@
+#include "point_sampler.h"
+#include "common/canvas.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace Server {
+    namespace PointSampler {
+
+        namespace {
+
+            constexpr std::size_t STRATA_PER_AXIS = 32; // STRATA_PER_AXIS^2 == STRUCTURED_BATCH_SIZE
+            constexpr double TWO_POW_MINUS_32 = 1.0 / 4294967296.0;
+
+            using UnitPoints = std::array<double, STRUCTURED_BATCH_SIZE>;
+            using SobolPoints = std::array<uint32_t, STRUCTURED_BATCH_SIZE>;
+
+            double radical_inverse(std::size_t index, unsigned int base) {
+                double inverse = 0.0;
+                double digit_weight = 1.0 / base;
+                while (index > 0) {
+                    inverse += static_cast<double>(index % base) * digit_weight;
+                    index /= base;
+                    digit_weight /= base;
+                }
+                return inverse;
+            }
+
+            /**
+             * @brief First STRUCTURED_BATCH_SIZE Halton points in [0,1)^2, computed once.
+             */
+            const std::array<UnitPoints, 2> &halton_points() {
+                static const std::array<UnitPoints, 2> points = [] {
+                    std::array<UnitPoints, 2> result{};
+                    for (std::size_t i = 0; i < STRUCTURED_BATCH_SIZE; ++i) {
+                        result[0][i] = radical_inverse(i, 2);
+                        result[1][i] = radical_inverse(i, 3);
+                    }
+                    return result;
+                }();
+                return points;
+            }
+
+            /**
+             * @brief First STRUCTURED_BATCH_SIZE Sobol points as 32-bit fractions, computed once.
+             * Dimension 0 is the van der Corput sequence; dimension 1 uses the primitive
+             * polynomial x + 1 with initial direction number m1 = 1.
+             */
+            const std::array<SobolPoints, 2> &sobol_points() {
+                static const std::array<SobolPoints, 2> points = [] {
+                    std::array<uint32_t, 32> directions_x{};
+                    std::array<uint32_t, 32> directions_y{};
+                    directions_x[0] = directions_y[0] = 1u << 31;
+                    for (std::size_t bit = 1; bit < 32; ++bit) {
+                        directions_x[bit] = 1u << (31 - bit);
+                        directions_y[bit] = directions_y[bit - 1] ^ (directions_y[bit - 1] >> 1);
+                    }
+
+                    std::array<SobolPoints, 2> result{};
+                    for (std::size_t i = 0; i < STRUCTURED_BATCH_SIZE; ++i) {
+                        uint32_t x = 0;
+                        uint32_t y = 0;
+                        for (std::size_t bit = 0; (i >> bit) != 0; ++bit) {
+                            if ((i >> bit) & 1u) {
+                                x ^= directions_x[bit];
+                                y ^= directions_y[bit];
+                            }
+                        }
+                        result[0][i] = x;
+                        result[1][i] = y;
+                    }
+                    return result;
+                }();
+                return points;
+            }
+
+        } // namespace
+
+        void fill(SamplerKind kind, RandomStream &random, double *xs, double *ys, std::size_t count) {
+            constexpr double width = Canvas::get_width();
+            constexpr double height = Canvas::get_height();
+
+            switch (kind) {
+            case SamplerKind::Uniform:
+                random.fill_uniform(xs, count, Canvas::MIN_X, Canvas::MAX_X);
+                random.fill_uniform(ys, count, Canvas::MIN_Y, Canvas::MAX_Y);
+                break;
+            case SamplerKind::Stratified: {
+                // Draw all jitters in bulk, then move each point into its own cell
+                random.fill_uniform(xs, count, 0.0, 1.0);
+                random.fill_uniform(ys, count, 0.0, 1.0);
+                const double cell_width = width / STRATA_PER_AXIS;
+                const double cell_height = height / STRATA_PER_AXIS;
+                for (std::size_t i = 0; i < count; ++i) {
+                    std::size_t column = i % STRATA_PER_AXIS;
+                    std::size_t row = i / STRATA_PER_AXIS;
+                    xs[i] = Canvas::MIN_X + (column + xs[i]) * cell_width;
+                    ys[i] = Canvas::MIN_Y + (row + ys[i]) * cell_height;
+                }
+                break;
+            }
+            case SamplerKind::Halton: {
+                // Cranley-Patterson rotation: shift every point by the same random offset, modulo 1
+                double shift[2];
+                random.fill_uniform(shift, 2, 0.0, 1.0);
+                const auto &points = halton_points();
+                for (std::size_t i = 0; i < count; ++i) {
+                    double u = points[0][i] + shift[0];
+                    double v = points[1][i] + shift[1];
+                    xs[i] = Canvas::MIN_X + (u - std::floor(u)) * width;
+                    ys[i] = Canvas::MIN_Y + (v - std::floor(v)) * height;
+                }
+                break;
+            }
+            case SamplerKind::Sobol: {
+                // Digital shift: XOR every point with the same random bits, which keeps the net structure
+                const uint32_t shift_x = random.next_bits();
+                const uint32_t shift_y = random.next_bits();
+                const auto &points = sobol_points();
+                for (std::size_t i = 0; i < count; ++i) {
+                    xs[i] = Canvas::MIN_X + (points[0][i] ^ shift_x) * TWO_POW_MINUS_32 * width;
+                    ys[i] = Canvas::MIN_Y + (points[1][i] ^ shift_y) * TWO_POW_MINUS_32 * height;
+                }
+                break;
+            }
+            }
+        }
+
+        void fill_region(const PartialRegion &region, RandomStream &random, double *xs, double *ys, std::size_t count) {
+            // One uniform draw in [0, cells) picks the cell with its integer part and supplies
+            // the x offset with its fractional part, which is uniform and independent of it
+            const std::size_t num_cells = region.x0.size();
+            random.fill_uniform(xs, count, 0.0, static_cast<double>(num_cells));
+            random.fill_uniform(ys, count, 0.0, 1.0);
+            for (std::size_t i = 0; i < count; ++i) {
+                std::size_t cell = std::min(static_cast<std::size_t>(xs[i]), num_cells - 1);
+                xs[i] = region.x0[cell] + (xs[i] - cell) * region.cell_width;
+                ys[i] = region.y0[cell] + ys[i] * region.cell_height;
+            }
+        }
+
+    } // namespace PointSampler
+} // namespace Server
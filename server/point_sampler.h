@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ellipse_grid.h"
+#include "random_generator.h"
+#include <cstddef>
+
+namespace Server {
+
+    /**
+     * @brief Strategy used to place the sample points of one batch on the canvas.
+     */
+    enum class SamplerKind {
+        Uniform,    // Independent uniform points
+        Stratified, // One jittered point per cell of a regular grid
+        Halton,     // Halton sequence (bases 2 and 3) with a random toroidal shift
+        Sobol       // Two-dimensional Sobol sequence with a random digital shift
+    };
+
+    /**
+     * @brief Fills batches of canvas points using a SamplerKind.
+     * The structured samplers randomize a fixed point set afresh for every batch, so each
+     * batch is an independent, unbiased estimate of the covered fraction. The spread of
+     * those per-batch estimates is what the error estimate is computed from.
+     */
+    namespace PointSampler {
+
+        /// Points per batch of the structured samplers (a power of two and a perfect square).
+        constexpr std::size_t STRUCTURED_BATCH_SIZE = 1024;
+
+        /**
+         * @brief Fills one batch of points.
+         * For the structured samplers count must be STRUCTURED_BATCH_SIZE.
+         * @param kind The sampler.
+         * @param random Source of the randomization.
+         * @param xs Receives the x-coordinates.
+         * @param ys Receives the y-coordinates.
+         * @param count The number of points.
+         */
+        void fill(SamplerKind kind, RandomStream &random, double *xs, double *ys, std::size_t count);
+
+        /**
+         * @brief Fills a batch of points uniform over the partial cells of a grid.
+         * @param region The cells to sample; must not be empty.
+         * @param random Source of the points.
+         * @param xs Receives the x-coordinates.
+         * @param ys Receives the y-coordinates.
+         * @param count The number of points.
+         */
+        void fill_region(const PartialRegion &region, RandomStream &random, double *xs, double *ys, std::size_t count);
+
+    } // namespace PointSampler
+
+} // namespace Server
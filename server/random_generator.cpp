@@ -0,0 +1,148 @@
+#include "random_generator.h"
+
+namespace Server {
+
+    namespace {
+
+        constexpr double TWO_POW_MINUS_53 = 1.0 / 9007199254740992.0;
+
+        // Jump polynomials from the xoshiro256 reference implementation
+        constexpr uint64_t JUMP[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                      0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL}; // 2^128 steps
+        constexpr uint64_t LONG_JUMP[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                           0x77710069854ee241ULL, 0x39109bb02acbe635ULL}; // 2^192 steps
+
+        inline uint64_t rotl(uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        uint64_t splitmix64(uint64_t &x) {
+            uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        /**
+         * @brief A single xoshiro256 state, used while seeding and jumping.
+         */
+        struct ScalarState {
+            uint64_t s[4];
+
+            void step() {
+                const uint64_t t = s[1] << 17;
+                s[2] ^= s[0];
+                s[3] ^= s[1];
+                s[1] ^= s[2];
+                s[0] ^= s[3];
+                s[2] ^= t;
+                s[3] = rotl(s[3], 45);
+            }
+
+            void jump(const uint64_t (&polynomial)[4]) {
+                uint64_t jumped[4] = {0, 0, 0, 0};
+                for (uint64_t word : polynomial) {
+                    for (int bit = 0; bit < 64; ++bit) {
+                        if (word & (uint64_t{1} << bit)) {
+                            for (int i = 0; i < 4; ++i) {
+                                jumped[i] ^= s[i];
+                            }
+                        }
+                        step();
+                    }
+                }
+                for (int i = 0; i < 4; ++i) {
+                    s[i] = jumped[i];
+                }
+            }
+        };
+
+    } // namespace
+
+    void Xoshiro256PlusX4::seed(uint64_t seed, unsigned int stream) {
+        ScalarState state;
+        for (uint64_t &word : state.s) {
+            word = splitmix64(seed);
+        }
+        for (unsigned int i = 0; i < stream; ++i) {
+            state.jump(LONG_JUMP);
+        }
+
+        for (std::size_t lane = 0; lane < LANES; ++lane) {
+            for (int i = 0; i < 4; ++i) {
+                state_[i][lane] = state.s[i];
+            }
+            state.jump(JUMP);
+        }
+        buffered_ = LANES;
+    }
+
+    void Xoshiro256PlusX4::step(uint64_t out[LANES]) {
+        for (std::size_t lane = 0; lane < LANES; ++lane) {
+            uint64_t s0 = state_[0][lane];
+            uint64_t s1 = state_[1][lane];
+            uint64_t s2 = state_[2][lane];
+            uint64_t s3 = state_[3][lane];
+
+            out[lane] = s0 + s3;
+
+            const uint64_t t = s1 << 17;
+            s2 ^= s0;
+            s3 ^= s1;
+            s1 ^= s2;
+            s0 ^= s3;
+            s2 ^= t;
+            s3 = rotl(s3, 45);
+
+            state_[0][lane] = s0;
+            state_[1][lane] = s1;
+            state_[2][lane] = s2;
+            state_[3][lane] = s3;
+        }
+    }
+
+    void Xoshiro256PlusX4::fill_uniform(double *out, std::size_t count, double lo, double hi) {
+        // The upper 53 bits of xoshiro256+ are full quality; the lowest bits are not used
+        const double scale = (hi - lo) * TWO_POW_MINUS_53;
+        std::size_t i = 0;
+        for (; i + LANES <= count; i += LANES) {
+            uint64_t bits[LANES];
+            step(bits);
+            for (std::size_t lane = 0; lane < LANES; ++lane) {
+                out[i + lane] = lo + static_cast<double>(bits[lane] >> 11) * scale;
+            }
+        }
+        for (; i < count; ++i) {
+            out[i] = lo + static_cast<double>(next() >> 11) * scale;
+        }
+    }
+
+    void RandomStream::seed(GeneratorKind kind, unsigned int seed, unsigned int stream) {
+        kind_ = kind;
+        if (kind_ == GeneratorKind::Mt19937) {
+            std::seed_seq seq{seed, stream};
+            mt_.seed(seq);
+        } else {
+            xoshiro_.seed(seed, stream);
+        }
+    }
+
+    void RandomStream::fill_uniform(double *out, std::size_t count, double lo, double hi) {
+        if (kind_ == GeneratorKind::Mt19937) {
+            std::uniform_real_distribution<double> distrib(lo, hi);
+            for (std::size_t i = 0; i < count; ++i) {
+                out[i] = distrib(mt_);
+            }
+        } else {
+            xoshiro_.fill_uniform(out, count, lo, hi);
+        }
+    }
+
+    uint32_t RandomStream::next_bits() {
+        if (kind_ == GeneratorKind::Mt19937) {
+            return static_cast<uint32_t>(mt_());
+        }
+        return static_cast<uint32_t>(xoshiro_.next() >> 32);
+    }
+
+} // namespace Server
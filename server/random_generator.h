@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+namespace Server {
+
+    /**
+     * @brief Pseudo-random generator family used for sampling.
+     */
+    enum class GeneratorKind {
+        Mt19937,       // std::mt19937 with one std::uniform_real_distribution call per value
+        Xoshiro256Plus // Lane-parallel xoshiro256+, filling whole buffers at once
+    };
+
+    /**
+     * @brief Four interleaved xoshiro256+ generators stepped together.
+     * The lanes are one seeded state and its successive 2^128-step jumps, so their outputs
+     * never overlap. The state is stored lane-innermost so that one step of all lanes is
+     * a handful of vectorizable operations.
+     */
+    class Xoshiro256PlusX4 {
+    public:
+        static constexpr std::size_t LANES = 4;
+
+        /**
+         * @brief Seeds the generator for one parallel stream.
+         * Stream n starts 2^192 * n steps after stream 0, which is far beyond what any stream uses.
+         * @param seed The common seed, expanded with SplitMix64.
+         * @param stream The stream index.
+         */
+        void seed(uint64_t seed, unsigned int stream);
+
+        /**
+         * @brief Returns the next 64-bit output.
+         */
+        uint64_t next() {
+            if (buffered_ == LANES) {
+                step(buffer_);
+                buffered_ = 0;
+            }
+            return buffer_[buffered_++];
+        }
+
+        /**
+         * @brief Fills a buffer with doubles uniform in [lo, hi).
+         * @param out Receives the values.
+         * @param count The number of values.
+         * @param lo The lower bound.
+         * @param hi The upper bound.
+         */
+        void fill_uniform(double *out, std::size_t count, double lo, double hi);
+
+    private:
+        /**
+         * @brief Advances every lane by one step.
+         * @param out Receives one output per lane.
+         */
+        void step(uint64_t out[LANES]);
+
+        uint64_t state_[4][LANES] = {};
+        uint64_t buffer_[LANES] = {};
+        std::size_t buffered_ = LANES; // Outputs of buffer_ already handed out
+    };
+
+    /**
+     * @brief The random source of one sampling stream, backed by a GeneratorKind.
+     */
+    class RandomStream {
+    public:
+        /**
+         * @brief Seeds the stream.
+         * @param kind The generator family.
+         * @param seed The common seed of all streams.
+         * @param stream The stream index; different indices give independent sequences.
+         */
+        void seed(GeneratorKind kind, unsigned int seed, unsigned int stream);
+
+        /**
+         * @brief Fills a buffer with doubles uniform in [lo, hi).
+         * @param out Receives the values.
+         * @param count The number of values.
+         * @param lo The lower bound.
+         * @param hi The upper bound.
+         */
+        void fill_uniform(double *out, std::size_t count, double lo, double hi);
+
+        /**
+         * @brief Returns 32 random bits.
+         */
+        uint32_t next_bits();
+
+    private:
+        GeneratorKind kind_ = GeneratorKind::Xoshiro256Plus;
+        std::mt19937 mt_;
+        Xoshiro256PlusX4 xoshiro_;
+    };
+
+} // namespace Server
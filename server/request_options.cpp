@@ -0,0 +1,173 @@
+#include "request_options.h"
+#include "common/protocol.h"
+#include <cmath>
+
+namespace Server {
+    namespace RequestOptions {
+
+        namespace {
+
+            // Clients pick these; bounding them keeps the millisecond-to-time_point conversions in range
+            constexpr double MAX_DEADLINE_MS = 3600000.0;
+            constexpr double MAX_STREAM_MS = 3600000.0;
+
+        } // namespace
+
+        bool apply(std::string_view token, EstimateOptions &options, std::string &error) {
+            std::size_t eq = token.find('=');
+            if (eq == std::string_view::npos) {
+                error = "Expected key=value option, got '" + std::string(token) + "'";
+                return false;
+            }
+            const std::string_view key = token.substr(0, eq);
+            const std::string_view value = token.substr(eq + 1);
+
+            if (key == "engine") {
+                if (value == "mc") {
+                    options.engine = AreaEngine::MonteCarlo;
+                } else if (value == "scanline") {
+                    options.engine = AreaEngine::Scanline;
+                } else if (value == "raster") {
+                    options.engine = AreaEngine::Raster;
+                } else {
+                    error = "Unknown engine '" + std::string(value) + "' (expected mc, scanline or raster)";
+                    return false;
+                }
+                return true;
+            }
+
+            if (key == "sampler") {
+                if (value == "uniform") {
+                    options.sampler = SamplerKind::Uniform;
+                } else if (value == "stratified") {
+                    options.sampler = SamplerKind::Stratified;
+                } else if (value == "halton") {
+                    options.sampler = SamplerKind::Halton;
+                } else if (value == "sobol") {
+                    options.sampler = SamplerKind::Sobol;
+                } else {
+                    error = "Unknown sampler '" + std::string(value) + "' (expected uniform, stratified, halton or sobol)";
+                    return false;
+                }
+                return true;
+            }
+
+            if (key == "region") {
+                if (value == "canvas") {
+                    options.restrict_to_ellipses = false;
+                } else if (value == "ellipses") {
+                    options.restrict_to_ellipses = true;
+                } else {
+                    error = "Unknown region '" + std::string(value) + "' (expected canvas or ellipses)";
+                    return false;
+                }
+                return true;
+            }
+
+            if (key == "rel_tol" || key == "abs_tol") {
+                double tolerance;
+                if (!Protocol::parse_double(value, tolerance) || tolerance < 0.0) {
+                    error = "Invalid " + std::string(key) + " '" + std::string(value) + "' (expected a number >= 0)";
+                    return false;
+                }
+                (key == "rel_tol" ? options.stopping.relative_tolerance : options.stopping.absolute_tolerance) = tolerance;
+                return true;
+            }
+
+            if (key == "min_area") {
+                double area;
+                if (!Protocol::parse_double(value, area) || area < 0.0) {
+                    error = "Invalid min_area '" + std::string(value) + "' (expected a number >= 0)";
+                    return false;
+                }
+                options.stopping.negligible_area = area;
+                return true;
+            }
+
+            if (key == "conf") {
+                double confidence;
+                if (!Protocol::parse_double(value, confidence) || confidence <= 0.0 || confidence >= 1.0) {
+                    error = "Invalid conf '" + std::string(value) + "' (expected a probability between 0 and 1)";
+                    return false;
+                }
+                options.stopping.confidence = confidence;
+                return true;
+            }
+
+            if (key == "interval") {
+                if (value == "wilson") {
+                    options.stopping.method = IntervalMethod::Wilson;
+                } else if (value == "agresti") {
+                    options.stopping.method = IntervalMethod::AgrestiCoull;
+                } else if (value == "jeffreys") {
+                    options.stopping.method = IntervalMethod::Jeffreys;
+                } else {
+                    error = "Unknown interval '" + std::string(value) + "' (expected wilson, agresti or jeffreys)";
+                    return false;
+                }
+                return true;
+            }
+
+            if (key == "priority") {
+                double priority;
+                if (!Protocol::parse_double(value, priority) || priority < -1000 || priority > 1000 ||
+                    priority != std::trunc(priority)) {
+                    error = "Invalid priority '" + std::string(value) + "' (expected an integer between -1000 and 1000)";
+                    return false;
+                }
+                options.priority = static_cast<int>(priority);
+                return true;
+            }
+
+            if (key == "deadline_ms") {
+                double deadline;
+                if (!Protocol::parse_double(value, deadline) || deadline < 0.0 || deadline > MAX_DEADLINE_MS) {
+                    error = "Invalid deadline_ms '" + std::string(value) + "' (expected a number between 0 and 3600000)";
+                    return false;
+                }
+                options.deadline_ms = deadline;
+                return true;
+            }
+
+            if (key == "stream_ms") {
+                double interval;
+                if (!Protocol::parse_double(value, interval) || interval < 0.0 || interval > MAX_STREAM_MS) {
+                    error = "Invalid stream_ms '" + std::string(value) + "' (expected a number between 0 and 3600000)";
+                    return false;
+                }
+                options.stream_ms = interval;
+                return true;
+            }
+
+            if (key == "coalesce") {
+                if (value == "on") {
+                    options.coalesce = true;
+                } else if (value == "off") {
+                    options.coalesce = false;
+                } else {
+                    error = "Unknown coalesce '" + std::string(value) + "' (expected on or off)";
+                    return false;
+                }
+                return true;
+            }
+
+            error = "Unknown option '" + std::string(key) + "'";
+            return false;
+        }
+
+        bool apply_all(std::string_view text, EstimateOptions &options, std::string &error) {
+            for (std::string_view token = Protocol::next_token(text); !token.empty(); token = Protocol::next_token(text)) {
+                if (!apply(token, options, error)) {
+                    return false;
+                }
+            }
+            // Without either tolerance every estimate would run to the sample cap
+            if (options.stopping.relative_tolerance == 0.0 && options.stopping.absolute_tolerance == 0.0) {
+                error = "rel_tol and abs_tol cannot both be 0";
+                return false;
+            }
+            return true;
+        }
+
+    } // namespace RequestOptions
+} // namespace Server
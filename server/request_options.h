@@ -0,0 +1,50 @@
+#pragma once
+
+#include "monte_carlo_simulator.h"
+#include <string>
+#include <string_view>
+
+namespace Server {
+
+    /**
+     * @brief Parses the "key=value" estimate options sent by clients.
+     * Text clients may append options to an ellipse line ("cx cy a b engine=scanline");
+     * binary clients send them in an Options frame. Both use the same syntax.
+     *
+     * Supported keys:
+     *   engine=mc|scanline|raster                  Area engine (Monte Carlo sampling, scanline or occupancy bitmap)
+     *   sampler=uniform|stratified|halton|sobol    Point placement of the Monte Carlo engine
+     *   region=canvas|ellipses                     Sample the whole canvas, or only grid cells partly covered by ellipses
+     *   rel_tol=<x>                                Stop when the interval half-width is <= x * estimate (0 disables)
+     *   abs_tol=<units²>                           Stop when the interval half-width is <= this area (default 0: disabled)
+     *   min_area=<units²>                          Stop when the interval lies below this area (default 0.1; 0 disables)
+     *   conf=<p>                                   Confidence level of the interval, in (0, 1)
+     *   interval=wilson|agresti|jeffreys           Interval for the covered fraction
+     *   priority=<n>                               Scheduling priority; higher runs first (default 0)
+     *   deadline_ms=<ms>                           Answer with the best estimate so far after this long (0 disables, at most one hour)
+     *   coalesce=on|off                            Let a newer request of the session answer this one too
+     *   stream_ms=<ms>                             Send partial estimates this often while sampling (0 disables, at most one hour)
+     */
+    namespace RequestOptions {
+
+        /**
+         * @brief Applies one "key=value" token.
+         * @param token The token.
+         * @param options The options to update.
+         * @param error Receives a description of the problem on failure.
+         * @return True on success, false for an unknown key or invalid value.
+         */
+        bool apply(std::string_view token, EstimateOptions &options, std::string &error);
+
+        /**
+         * @brief Applies a whitespace-separated list of "key=value" tokens.
+         * @param text The tokens.
+         * @param options The options to update.
+         * @param error Receives a description of the problem on failure.
+         * @return True if every token was valid and the resulting options can stop, false otherwise.
+         */
+        bool apply_all(std::string_view text, EstimateOptions &options, std::string &error);
+
+    } // namespace RequestOptions
+
+} // namespace Server
@@ -0,0 +1,125 @@
+#include "result_cache.h"
+#include <cstring>
+#include <initializer_list>
+
+namespace Server {
+
+    namespace {
+        // Finalizer of splitmix64: a bijective mix with full avalanche
+        uint64_t mix64(uint64_t x) {
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+            return x ^ (x >> 31);
+        }
+
+        uint64_t double_bits(double value) {
+            if (value == 0.0) {
+                value = 0.0; // -0.0 and 0.0 describe the same ellipse
+            }
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        uint64_t hash_ellipse(const Ellipse &ellipse, uint64_t seed) {
+            uint64_t h = seed;
+            for (double value : {ellipse.cx, ellipse.cy, ellipse.a, ellipse.b, ellipse.angle}) {
+                h = mix64(h ^ double_bits(value));
+            }
+            return h;
+        }
+
+        constexpr uint64_t PRIMARY_SEED = 0x9E3779B97F4A7C15ULL;
+        constexpr uint64_t ALTERNATE_SEED = 0xD1B54A32D192ED03ULL;
+    } // namespace
+
+    void EllipseSetFingerprint::add(const Ellipse &ellipse) {
+        sum += hash_ellipse(ellipse, PRIMARY_SEED);
+        alternate_sum += hash_ellipse(ellipse, ALTERNATE_SEED);
+        ++count;
+    }
+
+    void EllipseSetFingerprint::remove(const Ellipse &ellipse) {
+        sum -= hash_ellipse(ellipse, PRIMARY_SEED);
+        alternate_sum -= hash_ellipse(ellipse, ALTERNATE_SEED);
+        --count;
+    }
+
+    ResultCache::ResultCache(std::size_t capacity) : capacity_(capacity), hits_(0), misses_(0) {}
+
+    std::optional<MonteCarloResult> ResultCache::find(const EllipseSetFingerprint &fingerprint, const EstimateOptions &options) {
+        if (capacity_ == 0) {
+            return std::nullopt;
+        }
+        const Key key = make_key(fingerprint, options);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            ++misses_;
+            return std::nullopt;
+        }
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+    }
+
+    void ResultCache::insert(const EllipseSetFingerprint &fingerprint, const EstimateOptions &options, const MonteCarloResult &result) {
+        if (capacity_ == 0) {
+            return;
+        }
+        const Key key = make_key(fingerprint, options);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            it->second->second = result; // Another session computed it concurrently
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        if (entries_.size() >= capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        entries_.emplace_front(key, result);
+        index_.emplace(key, entries_.begin());
+    }
+
+    ResultCacheStats ResultCache::get_stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return {hits_, misses_, entries_.size()};
+    }
+
+    ResultCache::Key ResultCache::make_key(const EllipseSetFingerprint &fingerprint, const EstimateOptions &options) {
+        Key key{fingerprint, options};
+        if (options.engine != AreaEngine::MonteCarlo) {
+            key.options = EstimateOptions{}; // Deterministic engines ignore the sampling settings
+            key.options.engine = options.engine;
+        }
+        return key;
+    }
+
+    bool ResultCache::Key::operator==(const Key &other) const {
+        const StoppingCriteria &stopping = options.stopping;
+        const StoppingCriteria &other_stopping = other.options.stopping;
+        return fingerprint == other.fingerprint && options.engine == other.options.engine &&
+               options.sampler == other.options.sampler && options.restrict_to_ellipses == other.options.restrict_to_ellipses &&
+               stopping.method == other_stopping.method && stopping.confidence == other_stopping.confidence &&
+               stopping.relative_tolerance == other_stopping.relative_tolerance &&
+               stopping.absolute_tolerance == other_stopping.absolute_tolerance &&
+               stopping.negligible_area == other_stopping.negligible_area;
+    }
+
+    std::size_t ResultCache::KeyHash::operator()(const Key &key) const {
+        const StoppingCriteria &stopping = key.options.stopping;
+        uint64_t h = mix64(key.fingerprint.sum ^ key.fingerprint.count);
+        h = mix64(h ^ (static_cast<uint64_t>(key.options.engine) << 16 | static_cast<uint64_t>(key.options.sampler) << 8 |
+                       static_cast<uint64_t>(stopping.method) << 1 | static_cast<uint64_t>(key.options.restrict_to_ellipses)));
+        h = mix64(h ^ double_bits(stopping.confidence));
+        h = mix64(h ^ double_bits(stopping.relative_tolerance));
+        h = mix64(h ^ double_bits(stopping.absolute_tolerance));
+        h = mix64(h ^ double_bits(stopping.negligible_area));
+        return static_cast<std::size_t>(h);
+    }
+
+} // namespace Server
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "common/ellipse.h"
+#include "monte_carlo_simulator.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace Server {
+
+    /**
+     * @brief Order-independent fingerprint of a multiset of ellipses.
+     * Each ellipse is hashed on its own and the hashes are summed, so the fingerprint does
+     * not depend on insertion order, is updated in constant time per ellipse and can drop an
+     * ellipse again by subtracting its hash. Two independent 64-bit sums plus the count make
+     * accidental collisions negligible.
+     */
+    struct EllipseSetFingerprint {
+        uint64_t sum = 0;
+        uint64_t alternate_sum = 0;
+        uint64_t count = 0;
+
+        /**
+         * @brief Adds one ellipse to the set.
+         * @param ellipse The ellipse.
+         */
+        void add(const Ellipse &ellipse);
+
+        /**
+         * @brief Removes one ellipse that was added before.
+         * @param ellipse The ellipse.
+         */
+        void remove(const Ellipse &ellipse);
+
+        bool operator==(const EllipseSetFingerprint &other) const {
+            return sum == other.sum && alternate_sum == other.alternate_sum && count == other.count;
+        }
+    };
+
+    /**
+     * @brief Statistics of a ResultCache.
+     */
+    struct ResultCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        std::size_t entries = 0;
+    };
+
+    /**
+     * @brief Bounded LRU cache of area estimates, keyed by ellipse set and estimate options.
+     * Clients that replay the same seeded sequences get earlier results back without
+     * re-running the estimate. The cache is shared by all sessions and safe to use from
+     * any thread.
+     */
+    class ResultCache {
+    public:
+        static constexpr std::size_t DEFAULT_CAPACITY = 4096;
+
+        /**
+         * @brief Constructor.
+         * @param capacity The maximum number of results kept; 0 disables the cache.
+         */
+        explicit ResultCache(std::size_t capacity = DEFAULT_CAPACITY);
+
+        /**
+         * @brief Looks up a result and marks it as recently used.
+         * @param fingerprint The fingerprint of the ellipse set.
+         * @param options The options of the estimate.
+         * @return The cached result, or std::nullopt on a miss.
+         */
+        std::optional<MonteCarloResult> find(const EllipseSetFingerprint &fingerprint, const EstimateOptions &options);
+
+        /**
+         * @brief Stores a result, evicting the least recently used one when full.
+         * @param fingerprint The fingerprint of the ellipse set.
+         * @param options The options of the estimate.
+         * @param result The result.
+         */
+        void insert(const EllipseSetFingerprint &fingerprint, const EstimateOptions &options, const MonteCarloResult &result);
+
+        /**
+         * @brief Gets the hit and miss counts and the number of cached results.
+         * @return The statistics.
+         */
+        ResultCacheStats get_stats() const;
+
+    private:
+        /**
+         * @brief A fingerprint with the options that can change the result.
+         */
+        struct Key {
+            EllipseSetFingerprint fingerprint;
+            EstimateOptions options;
+
+            bool operator==(const Key &other) const;
+        };
+
+        struct KeyHash {
+            std::size_t operator()(const Key &key) const;
+        };
+
+        using Entry = std::pair<Key, MonteCarloResult>;
+
+        /**
+         * @brief Builds a key, dropping options the chosen engine ignores.
+         * @param fingerprint The fingerprint of the ellipse set.
+         * @param options The options of the estimate.
+         * @return The key.
+         */
+        static Key make_key(const EllipseSetFingerprint &fingerprint, const EstimateOptions &options);
+
+        std::size_t capacity_;
+        mutable std::mutex mutex_;
+        std::list<Entry> entries_; // Most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+        uint64_t hits_;
+        uint64_t misses_;
+    };
+
+} // namespace Server
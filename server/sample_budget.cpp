@@ -0,0 +1,29 @@
+#include "sample_budget.h"
+
+namespace Server {
+
+    SampleBudget::SampleBudget(long long capacity) : capacity_(capacity), used_(0) {}
+
+    bool SampleBudget::try_reserve(long long samples) {
+        long long used = used_.load(std::memory_order_relaxed);
+        do {
+            if (used + samples > capacity_) {
+                return false;
+            }
+        } while (!used_.compare_exchange_weak(used, used + samples, std::memory_order_relaxed));
+        return true;
+    }
+
+    void SampleBudget::release(long long samples) {
+        used_.fetch_sub(samples, std::memory_order_relaxed);
+    }
+
+    long long SampleBudget::get_used() const {
+        return used_.load(std::memory_order_relaxed);
+    }
+
+    long long SampleBudget::get_capacity() const {
+        return capacity_;
+    }
+
+} // namespace Server
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+
+namespace Server {
+
+    /**
+     * @brief A limit on persistent samples shared by many simulators.
+     * Each incremental simulator reserves room here before growing its sample set and
+     * gives it back when the set is cleared or destroyed. Once the budget is used up,
+     * simulators draw the samples they still need fresh, as in non-incremental mode.
+     */
+    class SampleBudget {
+    public:
+        /**
+         * @brief Constructor.
+         * @param capacity The most samples all simulators together may keep.
+         */
+        explicit SampleBudget(long long capacity);
+
+        SampleBudget(const SampleBudget &) = delete;
+        SampleBudget &operator=(const SampleBudget &) = delete;
+
+        /**
+         * @brief Reserves room for samples, all or nothing.
+         * @param samples The number of samples.
+         * @return True if the room was reserved, false if it would exceed the capacity.
+         */
+        bool try_reserve(long long samples);
+
+        /**
+         * @brief Gives back room reserved before.
+         * @param samples The number of samples.
+         */
+        void release(long long samples);
+
+        /**
+         * @brief Gets the number of samples currently reserved.
+         * @return The reserved count.
+         */
+        long long get_used() const;
+
+        /**
+         * @brief Gets the capacity.
+         * @return The most samples that can be reserved at once.
+         */
+        long long get_capacity() const;
+
+    private:
+        const long long capacity_;
+        std::atomic<long long> used_;
+    };
+
+} // namespace Server
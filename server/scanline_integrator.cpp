@@ -0,0 +1,110 @@
+#include "scanline_integrator.h"
+#include "common/canvas.h"
+#include <algorithm>
+#include <utility>
+
+namespace Server {
+    namespace ScanlineIntegrator {
+
+        namespace {
+            // Strips are integrated in fixed-size chunks whose sums are added in order,
+            // so floating-point rounding does not depend on the number of threads.
+            constexpr int STRIPS_PER_CHUNK = 64;
+
+            /**
+             * @brief Sums the covered chord length of the strips [first_strip, end_strip).
+             * @param by_bottom Valid ellipses sorted by their lowest y.
+             */
+            double integrate_chunk(const std::vector<Ellipse> &by_bottom, int first_strip, int end_strip, double strip_height) {
+                std::vector<const Ellipse *> active;
+                std::vector<std::pair<double, double>> intervals;
+                size_t next = 0;
+                double sum = 0.0;
+
+                for (int strip = first_strip; strip < end_strip; ++strip) {
+                    const double y = Canvas::MIN_Y + (strip + 0.5) * strip_height;
+
+                    // Ellipses start being active once the scanline reaches their bottom
+                    while (next < by_bottom.size() && by_bottom[next].cy - by_bottom[next].get_half_height() <= y) {
+                        active.push_back(&by_bottom[next++]);
+                    }
+                    active.erase(std::remove_if(active.begin(), active.end(),
+                                                [y](const Ellipse *e) { return e->cy + e->get_half_height() < y; }),
+                                 active.end());
+
+                    intervals.clear();
+                    for (const Ellipse *e : active) {
+                        double left, right;
+                        if (!e->get_chord(y, left, right)) {
+                            continue;
+                        }
+                        left = std::max(Canvas::MIN_X, left);
+                        right = std::min(Canvas::MAX_X, right);
+                        if (left < right) {
+                            intervals.emplace_back(left, right);
+                        }
+                    }
+                    if (intervals.empty()) {
+                        continue;
+                    }
+
+                    // Merge overlapping chords and add up the union length
+                    std::sort(intervals.begin(), intervals.end());
+                    double run_left = intervals[0].first;
+                    double run_right = intervals[0].second;
+                    double length = 0.0;
+                    for (size_t i = 1; i < intervals.size(); ++i) {
+                        if (intervals[i].first > run_right) {
+                            length += run_right - run_left;
+                            run_left = intervals[i].first;
+                            run_right = intervals[i].second;
+                        } else {
+                            run_right = std::max(run_right, intervals[i].second);
+                        }
+                    }
+                    length += run_right - run_left;
+                    sum += length;
+                }
+                return sum * strip_height;
+            }
+        } // namespace
+
+        double covered_area(const std::vector<Ellipse> &ellipses, int num_strips, ThreadPool *pool) {
+            num_strips = std::max(1, num_strips);
+            const double strip_height = Canvas::get_height() / num_strips;
+
+            std::vector<Ellipse> by_bottom;
+            by_bottom.reserve(ellipses.size());
+            for (const Ellipse &e : ellipses) {
+                if (e.a > 0 && e.b > 0) {
+                    by_bottom.push_back(e);
+                }
+            }
+            std::sort(by_bottom.begin(), by_bottom.end(),
+                      [](const Ellipse &lhs, const Ellipse &rhs) { return lhs.cy - lhs.get_half_height() < rhs.cy - rhs.get_half_height(); });
+
+            const int num_chunks = (num_strips + STRIPS_PER_CHUNK - 1) / STRIPS_PER_CHUNK;
+            std::vector<double> chunk_areas(num_chunks, 0.0);
+            auto run_chunk = [&](size_t chunk) {
+                int first_strip = static_cast<int>(chunk) * STRIPS_PER_CHUNK;
+                int end_strip = std::min(num_strips, first_strip + STRIPS_PER_CHUNK);
+                chunk_areas[chunk] = integrate_chunk(by_bottom, first_strip, end_strip, strip_height);
+            };
+
+            if (pool) {
+                pool->parallel_for(chunk_areas.size(), run_chunk);
+            } else {
+                for (size_t chunk = 0; chunk < chunk_areas.size(); ++chunk) {
+                    run_chunk(chunk);
+                }
+            }
+
+            double area = 0.0;
+            for (double chunk_area : chunk_areas) {
+                area += chunk_area;
+            }
+            return area;
+        }
+
+    } // namespace ScanlineIntegrator
+} // namespace Server
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "common/ellipse.h"
+#include "thread_pool.h"
+#include <vector>
+
+namespace Server {
+
+    /**
+     * @brief Deterministic area engine: integrates the union of ellipses strip by strip.
+     * Each horizontal strip is represented by its middle line, where every ellipse is an
+     * exact chord interval; the merged interval length times the strip height is summed
+     * over all strips (midpoint rule). Only the canvas part of the union is counted.
+     */
+    namespace ScanlineIntegrator {
+
+        constexpr int DEFAULT_STRIPS = 4096;
+
+        /**
+         * @brief Computes the area of the canvas covered by at least one ellipse.
+         * The result depends only on the ellipses and the strip count, not on the pool size.
+         * @param ellipses The ellipses.
+         * @param num_strips The number of horizontal strips over the canvas height.
+         * @param pool Workers used to integrate strips in parallel; may be nullptr.
+         * @return The covered area in units squared.
+         */
+        double covered_area(const std::vector<Ellipse> &ellipses, int num_strips, ThreadPool *pool);
+
+    } // namespace ScanlineIntegrator
+
+} // namespace Server
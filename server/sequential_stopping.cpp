@@ -0,0 +1,249 @@
+#include "sequential_stopping.h"
+#include "common/canvas.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Server {
+
+    namespace {
+
+        constexpr int BISECTION_STEPS = 64;
+        constexpr int MAX_FRACTION_TERMS = 100000;
+        constexpr double FRACTION_EPSILON = 1e-15;
+        constexpr double TINY = 1e-300;
+
+        /**
+         * @brief Two-sided standard normal quantile: the z with P(|Z| <= z) = confidence.
+         */
+        double normal_quantile_two_sided(double confidence) {
+            double low = 0.0;
+            double high = 40.0;
+            for (int step = 0; step < BISECTION_STEPS; ++step) {
+                double mid = 0.5 * (low + high);
+                if (std::erf(mid / std::sqrt(2.0)) < confidence) {
+                    low = mid;
+                } else {
+                    high = mid;
+                }
+            }
+            return 0.5 * (low + high);
+        }
+
+        double log_gamma(double x) {
+            int sign;
+            return lgamma_r(x, &sign); // Reentrant: std::lgamma writes the global signgam
+        }
+
+        /**
+         * @brief Continued fraction of the incomplete beta function (modified Lentz method).
+         */
+        double incomplete_beta_fraction(double a, double b, double x) {
+            double c = 1.0;
+            double d = 1.0 - (a + b) * x / (a + 1.0);
+            d = 1.0 / (std::fabs(d) < TINY ? TINY : d);
+            double result = d;
+            for (int m = 1; m <= MAX_FRACTION_TERMS; ++m) {
+                double m2 = 2.0 * m;
+                double even = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+                d = 1.0 + even * d;
+                c = 1.0 + even / c;
+                d = 1.0 / (std::fabs(d) < TINY ? TINY : d);
+                c = std::fabs(c) < TINY ? TINY : c;
+                result *= d * c;
+
+                double odd = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+                d = 1.0 + odd * d;
+                c = 1.0 + odd / c;
+                d = 1.0 / (std::fabs(d) < TINY ? TINY : d);
+                c = std::fabs(c) < TINY ? TINY : c;
+                double delta = d * c;
+                result *= delta;
+                if (std::fabs(delta - 1.0) < FRACTION_EPSILON) {
+                    break;
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief Regularized incomplete beta function I_x(a, b), the Beta(a, b) CDF at x.
+         */
+        double beta_cdf(double a, double b, double log_beta, double x) {
+            if (x <= 0.0) {
+                return 0.0;
+            }
+            if (x >= 1.0) {
+                return 1.0;
+            }
+            double front = std::exp(a * std::log(x) + b * std::log1p(-x) - log_beta);
+            if (x < (a + 1.0) / (a + b + 2.0)) {
+                return front * incomplete_beta_fraction(a, b, x) / a;
+            }
+            return 1.0 - front * incomplete_beta_fraction(b, a, 1.0 - x) / b;
+        }
+
+        /**
+         * @brief Inverse of the Beta(a, b) CDF, by bisection.
+         */
+        double beta_quantile(double a, double b, double probability) {
+            const double log_beta = log_gamma(a) + log_gamma(b) - log_gamma(a + b);
+            double low = 0.0;
+            double high = 1.0;
+            for (int step = 0; step < BISECTION_STEPS; ++step) {
+                double mid = 0.5 * (low + high);
+                if (beta_cdf(a, b, log_beta, mid) < probability) {
+                    low = mid;
+                } else {
+                    high = mid;
+                }
+            }
+            return 0.5 * (low + high);
+        }
+
+    } // namespace
+
+    SequentialStopping::SequentialStopping(const StoppingCriteria &criteria, const SampledRegion &region)
+        : criteria_(criteria), region_(region), z_(normal_quantile_two_sided(criteria.confidence)) {}
+
+    ProportionInterval SequentialStopping::binomial_interval(long long total_points_sampled, long long points_inside_any_ellipse) const {
+        ProportionInterval interval = sample_interval(total_points_sampled, points_inside_any_ellipse);
+        return {to_canvas(interval.low), to_canvas(interval.high)};
+    }
+
+    double SequentialStopping::to_canvas(double sampled_proportion) const {
+        return region_.fixed_fraction + region_.sampled_fraction * sampled_proportion;
+    }
+
+    ProportionInterval SequentialStopping::sample_interval(long long total_points_sampled, long long points_inside_any_ellipse) const {
+        if (total_points_sampled <= 0) {
+            return {0.0, 1.0};
+        }
+        const double n = static_cast<double>(total_points_sampled);
+        const double hits = static_cast<double>(points_inside_any_ellipse);
+        const double z2 = z_ * z_;
+
+        switch (criteria_.method) {
+        case IntervalMethod::Wilson: {
+            double p = hits / n;
+            double denominator = 1.0 + z2 / n;
+            double center = (p + z2 / (2.0 * n)) / denominator;
+            double half_width = z_ * std::sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * n)) / denominator;
+            return {std::max(0.0, center - half_width), std::min(1.0, center + half_width)};
+        }
+        case IntervalMethod::AgrestiCoull: {
+            double adjusted_n = n + z2;
+            double adjusted_p = (hits + z2 / 2.0) / adjusted_n;
+            double half_width = z_ * std::sqrt(adjusted_p * (1.0 - adjusted_p) / adjusted_n);
+            return {std::max(0.0, adjusted_p - half_width), std::min(1.0, adjusted_p + half_width)};
+        }
+        case IntervalMethod::Jeffreys: {
+            double tail = (1.0 - criteria_.confidence) / 2.0;
+            double a = hits + 0.5;
+            double b = n - hits + 0.5;
+            double low = points_inside_any_ellipse == 0 ? 0.0 : beta_quantile(a, b, tail);
+            double high = points_inside_any_ellipse == total_points_sampled ? 1.0 : beta_quantile(a, b, 1.0 - tail);
+            return {low, high};
+        }
+        }
+        return {0.0, 1.0};
+    }
+
+    ProportionInterval SequentialStopping::replicate_interval(long long replicates, double fraction_sum, double fraction_sum_sq) const {
+        if (replicates < 2) {
+            return {0.0, 1.0};
+        }
+        double mean = fraction_sum / replicates;
+        double variance = std::max(0.0, (fraction_sum_sq - replicates * mean * mean) / (replicates - 1));
+        double half_width = z_ * std::sqrt(variance / replicates);
+        return {to_canvas(std::max(0.0, mean - half_width)), to_canvas(std::min(1.0, mean + half_width))};
+    }
+
+    bool SequentialStopping::is_satisfied(long long total_points_sampled, long long points_inside_any_ellipse) const {
+        if (total_points_sampled < MIN_SAMPLES) {
+            return false;
+        }
+
+        double estimate = to_canvas(static_cast<double>(points_inside_any_ellipse) / total_points_sampled);
+        ProportionInterval interval = binomial_interval(total_points_sampled, points_inside_any_ellipse);
+        if (is_within_tolerance(estimate, interval)) {
+            LOG_DEBUG("Stabilization achieved after " << total_points_sampled << " samples: covered fraction in ["
+                      << interval.low << ", " << interval.high << "] at " << criteria_.confidence * 100 << "% confidence");
+            return true;
+        }
+
+        if (total_points_sampled >= MAX_SAMPLES) {
+            LOG_WARNING("Max samples (" << MAX_SAMPLES << ") reached. Using current estimate with interval ["
+                        << interval.low << ", " << interval.high << "]");
+            return true;
+        }
+        return false;
+    }
+
+    bool SequentialStopping::is_replicate_satisfied(long long replicates, long long samples_per_replicate, double fraction_sum,
+                                                    double fraction_sum_sq) const {
+        if (replicates < MIN_REPLICATES) {
+            return false;
+        }
+
+        double estimate = to_canvas(fraction_sum / replicates);
+        ProportionInterval interval = replicate_interval(replicates, fraction_sum, fraction_sum_sq);
+        if (is_within_tolerance(estimate, interval)) {
+            LOG_DEBUG("Stabilization achieved after " << replicates << " randomized batches: covered fraction in ["
+                      << interval.low << ", " << interval.high << "] at " << criteria_.confidence * 100 << "% confidence");
+            return true;
+        }
+
+        if (replicates * samples_per_replicate >= MAX_SAMPLES) {
+            LOG_WARNING("Max samples (" << MAX_SAMPLES << ") reached. Using current estimate with interval ["
+                        << interval.low << ", " << interval.high << "]");
+            return true;
+        }
+        return false;
+    }
+
+    long long SequentialStopping::next_round_samples(long long total_points_sampled, long long points_inside_any_ellipse) const {
+        if (total_points_sampled < MIN_SAMPLES) {
+            return MIN_SAMPLES - total_points_sampled;
+        }
+
+        // The half-width shrinks like 1/sqrt(n), so n * (width / target)^2 samples should suffice
+        double estimate = to_canvas(static_cast<double>(points_inside_any_ellipse) / total_points_sampled);
+        ProportionInterval interval = binomial_interval(total_points_sampled, points_inside_any_ellipse);
+        double half_width = std::max(estimate - interval.low, interval.high - estimate);
+        double target = target_half_width(estimate);
+
+        long long additional = total_points_sampled; // Doubling, if no tolerance can be extrapolated
+        if (target > 0.0) {
+            double ratio = half_width / target;
+            double predicted_total = std::ceil(static_cast<double>(total_points_sampled) * ratio * ratio);
+            additional = static_cast<long long>(std::min(predicted_total, 2.0 * total_points_sampled)) - total_points_sampled;
+        }
+        return std::clamp(additional, 1LL, std::max(1LL, MAX_SAMPLES - total_points_sampled));
+    }
+
+    bool SequentialStopping::is_within_tolerance(double estimate, const ProportionInterval &interval) const {
+        // Intervals are not symmetric near 0 and 1; judge the wider side
+        double half_width = std::max(estimate - interval.low, interval.high - estimate);
+        if (criteria_.relative_tolerance > 0.0 && half_width <= criteria_.relative_tolerance * estimate) {
+            return true;
+        }
+        // A relative tolerance can never be met near zero; an upper bound this small is answer enough
+        if (criteria_.negligible_area > 0.0 && interval.high <= criteria_.negligible_area / Canvas::get_area()) {
+            return true;
+        }
+        return criteria_.absolute_tolerance > 0.0 && half_width <= criteria_.absolute_tolerance / Canvas::get_area();
+    }
+
+    double SequentialStopping::target_half_width(double estimate) const {
+        double target = 0.0;
+        if (criteria_.relative_tolerance > 0.0) {
+            target = criteria_.relative_tolerance * estimate;
+        }
+        if (criteria_.absolute_tolerance > 0.0) {
+            target = std::max(target, criteria_.absolute_tolerance / Canvas::get_area());
+        }
+        return target;
+    }
+
+} // namespace Server
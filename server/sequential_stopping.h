@@ -0,0 +1,149 @@
+#pragma once
+
+namespace Server {
+
+    /**
+     * @brief Confidence interval used for a binomial proportion (covered samples / all samples).
+     */
+    enum class IntervalMethod {
+        Wilson,       // Wilson score interval
+        AgrestiCoull, // Wald interval around the Wilson center
+        Jeffreys      // Equal-tailed Bayesian interval under the Jeffreys Beta(1/2, 1/2) prior
+    };
+
+    /**
+     * @brief When a sampling estimate is precise enough to stop.
+     * Sampling stops as soon as either enabled tolerance is met by the interval half-width,
+     * or once the whole interval lies below negligible_area, so empty and near-empty canvases
+     * do not run to the sample cap.
+     */
+    struct StoppingCriteria {
+        static constexpr double ONE_SIGMA_CONFIDENCE = 0.6826894921370859;
+
+        IntervalMethod method = IntervalMethod::Wilson;
+        double confidence = ONE_SIGMA_CONFIDENCE; // Coverage probability of the interval
+        double relative_tolerance = 0.01;         // Half-width relative to the estimate; 0 disables
+        double absolute_tolerance = 0.0;          // Half-width in units² of covered area; 0 disables
+        double negligible_area = 0.1;             // Upper bound in units² below which any area is close enough; 0 disables
+    };
+
+    /**
+     * @brief A confidence interval for the covered fraction of the canvas.
+     */
+    struct ProportionInterval {
+        double low;
+        double high;
+    };
+
+    /**
+     * @brief Where samples were drawn, relative to the canvas.
+     * The covered fraction of the canvas is fixed_fraction + sampled_fraction * p, where p
+     * is the covered fraction of the samples. Sampling the whole canvas is {0, 1}.
+     */
+    struct SampledRegion {
+        double fixed_fraction = 0.0;   // Canvas fraction known to be covered without sampling
+        double sampled_fraction = 1.0; // Canvas fraction the samples were drawn from
+    };
+
+    /**
+     * @brief Sequential stopping rule for Monte Carlo area estimates.
+     * After each sampling round the estimator asks whether the current interval is narrow
+     * enough; if not, it asks how many samples to draw next. Rounds grow geometrically
+     * towards the predicted total, so few rounds are needed even for large sample counts.
+     */
+    class SequentialStopping {
+    public:
+        static constexpr long long MIN_SAMPLES = 5000;      // Never stop on fewer samples
+        static constexpr long long MAX_SAMPLES = 20000000;  // Always stop here, whatever the precision
+        static constexpr long long MIN_REPLICATES = 8;      // Never judge replicate spread on fewer batches
+
+        /**
+         * @brief Constructor.
+         * @param criteria The tolerances and interval to use.
+         * @param region Where the samples are drawn; tolerances always apply to the whole canvas.
+         */
+        explicit SequentialStopping(const StoppingCriteria &criteria, const SampledRegion &region = {});
+
+        /**
+         * @brief Computes the confidence interval of a binomial proportion.
+         * @param total_points_sampled The number of samples.
+         * @param points_inside_any_ellipse The number of covered samples.
+         * @return The interval of the covered fraction of the canvas.
+         */
+        ProportionInterval binomial_interval(long long total_points_sampled, long long points_inside_any_ellipse) const;
+
+        /**
+         * @brief Computes a normal confidence interval from independent per-batch estimates.
+         * @param replicates The number of batches.
+         * @param fraction_sum Sum of the per-batch covered fractions.
+         * @param fraction_sum_sq Sum of the squared per-batch covered fractions.
+         * @return The interval of the covered fraction of the canvas.
+         */
+        ProportionInterval replicate_interval(long long replicates, double fraction_sum, double fraction_sum_sq) const;
+
+        /**
+         * @brief Decides whether binomial sampling can stop.
+         * @param total_points_sampled The number of samples so far.
+         * @param points_inside_any_ellipse The number of covered samples so far.
+         * @return True if a tolerance or the sample cap has been reached.
+         */
+        bool is_satisfied(long long total_points_sampled, long long points_inside_any_ellipse) const;
+
+        /**
+         * @brief Decides whether replicate sampling can stop.
+         * @param replicates The number of batches so far.
+         * @param samples_per_replicate The points per batch.
+         * @param fraction_sum Sum of the per-batch covered fractions.
+         * @param fraction_sum_sq Sum of the squared per-batch covered fractions.
+         * @return True if a tolerance or the sample cap has been reached.
+         */
+        bool is_replicate_satisfied(long long replicates, long long samples_per_replicate, double fraction_sum,
+                                    double fraction_sum_sq) const;
+
+        /**
+         * @brief Suggests how many samples to draw in the next binomial round.
+         * The suggestion extrapolates the current interval width to the tolerance, but never
+         * more than doubles the sample count and never passes MAX_SAMPLES.
+         * @param total_points_sampled The number of samples so far.
+         * @param points_inside_any_ellipse The number of covered samples so far.
+         * @return The number of additional samples; at least 1 while below MAX_SAMPLES.
+         */
+        long long next_round_samples(long long total_points_sampled, long long points_inside_any_ellipse) const;
+
+        /**
+         * @brief Maps a covered fraction of the samples to a covered fraction of the canvas.
+         * @param sampled_proportion The covered fraction of the samples.
+         * @return The covered fraction of the canvas.
+         */
+        double to_canvas(double sampled_proportion) const;
+
+    private:
+        /**
+         * @brief Computes the binomial interval of the covered fraction of the samples.
+         * @param total_points_sampled The number of samples.
+         * @param points_inside_any_ellipse The number of covered samples.
+         * @return The interval, before mapping to the canvas.
+         */
+        ProportionInterval sample_interval(long long total_points_sampled, long long points_inside_any_ellipse) const;
+
+        /**
+         * @brief Checks an interval against the tolerances.
+         * @param estimate The point estimate of the covered fraction of the canvas.
+         * @param interval Its interval on the canvas.
+         * @return True if either enabled tolerance is met, or the interval lies below negligible_area.
+         */
+        bool is_within_tolerance(double estimate, const ProportionInterval &interval) const;
+
+        /**
+         * @brief Gets the largest acceptable half-width for an estimate.
+         * @param estimate The point estimate of the covered fraction.
+         * @return The half-width as a fraction of the canvas, or 0 if no tolerance applies.
+         */
+        double target_half_width(double estimate) const;
+
+        StoppingCriteria criteria_;
+        SampledRegion region_;
+        double z_; // Two-sided standard normal quantile for criteria_.confidence
+    };
+
+} // namespace Server
@@ -1,8 +1,11 @@
 #include "server.h"
-#include "common/ellipse.h"
+#include "request_options.h"
+#include "common/ellipse_file.h"
+#include "common/logger.h"
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iomanip>
-#include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -11,25 +14,105 @@
 #include <arpa/inet.h>
 #include <cstring>
 #include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 namespace Server {
 
-    TcpServer::TcpServer(int port) : port_(port), server_socket_fd_(-1) {
-        simulator_.clear_ellipses();
+    namespace {
+        // epoll user data of the non-client descriptors; session ids start after them
+        constexpr uint64_t LISTEN_TAG = 0;
+        constexpr uint64_t COMPLETION_TAG = 1;
+        constexpr uint64_t METRICS_TAG = 2;
+        constexpr uint64_t FIRST_SESSION_ID = 3;
+
+        constexpr int MAX_EVENTS = 256;
+        constexpr std::size_t RECV_CHUNK_SIZE = 16 * 1024;
+        constexpr std::size_t CHECKPOINT_INTERVAL = 1024;   // Least new or edited ellipses between snapshots of a session
+        constexpr std::size_t CHECKPOINT_GROWTH_DIVISOR = 4; // ...and at least a quarter of the last snapshot's size
+        constexpr const char *SESSION_COMMAND = "SESSION";
+        constexpr const char *LOAD_COMMAND = "LOAD";
+        constexpr const char *REMOVE_COMMAND = "REMOVE";
+        constexpr const char *UPDATE_COMMAND = "UPDATE";
+        constexpr std::size_t LOAD_CHUNK_ELLIPSES = 4096; // Ellipses decoded from a mapped file at a time
+        constexpr long long SAMPLE_BUDGET = 1LL << 25;    // Persistent samples over all sessions, about 512 MB
+
+        // Ids travel as doubles, so they must be whole and small enough to be exact
+        bool to_ellipse_id(double value, uint64_t &id) {
+            if (!(value >= 0.0 && value < 9007199254740992.0) || value != std::trunc(value)) {
+                return false;
+            }
+            id = static_cast<uint64_t>(value);
+            return true;
+        }
+
+        // An ellipse's four numbers may be followed by its rotation; anything else is left for the options
+        void parse_angle(std::string_view &rest, double &angle) {
+            std::string_view after = rest;
+            double value;
+            if (Protocol::parse_double(Protocol::next_token(after), value)) {
+                angle = value;
+                rest = after;
+            }
+        }
+
+        SimulatorConfig make_simulator_config(unsigned int num_threads, std::optional<unsigned int> seed, ThreadPool &pool,
+                                              SampleBudget &budget) {
+            SimulatorConfig config;
+            config.num_streams = num_threads;
+            config.seed = seed;
+            config.pool = &pool;
+            config.sample_budget = &budget;
+            return config;
+        }
+    } // namespace
+
+    TcpServer::TcpServer(int port, unsigned int num_threads, std::optional<unsigned int> seed,
+                         std::optional<std::string> snapshot_dir, std::optional<std::string> data_dir)
+        : port_(port),
+          server_socket_fd_(-1),
+          metrics_socket_fd_(-1),
+          epoll_fd_(-1),
+          completion_event_fd_(-1),
+          sampling_pool_(num_threads > 1 ? num_threads - 1 : 0), // The calling thread samples too
+          sample_budget_(SAMPLE_BUDGET),
+          data_dir_(std::move(data_dir)),
+          next_session_id_(FIRST_SESSION_ID),
+          session_store_(std::move(snapshot_dir)),
+          scheduler_(compute_pool_),
+          compute_pool_(num_threads) {
+        simulator_config_ = make_simulator_config(num_threads, seed, sampling_pool_, sample_budget_);
+    }
+
+    TcpServer::~TcpServer() {
+        for (auto &entry : sessions_) {
+            close(entry.second->socket_fd);
+        }
+        for (auto &entry : metrics_readers_) {
+            close(entry.second.socket_fd);
+        }
+        if (completion_event_fd_ >= 0)
+            close(completion_event_fd_);
+        if (epoll_fd_ >= 0)
+            close(epoll_fd_);
+        if (server_socket_fd_ >= 0)
+            close(server_socket_fd_);
+        if (metrics_socket_fd_ >= 0)
+            close(metrics_socket_fd_);
     }
 
     void TcpServer::start() {
-        server_socket_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        server_socket_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
         if (server_socket_fd_ < 0) {
-            throw std::runtime_error("Error: Could not create socket. " + std::string(strerror(errno)));
+            throw std::runtime_error("Could not create socket. " + std::string(strerror(errno)));
         }
 
         int opt = 1;
         if (setsockopt(server_socket_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-            std::cerr << "Warning: setsockopt(SO_REUSEADDR) failed. " << strerror(errno) << std::endl;
+            LOG_WARNING("setsockopt(SO_REUSEADDR) failed. " << strerror(errno));
         }
 
         sockaddr_in server_address{};
@@ -38,132 +121,988 @@ namespace Server {
         server_address.sin_port = htons(port_);
 
         if (bind(server_socket_fd_, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
-            close(server_socket_fd_);
-            throw std::runtime_error("Error: Could not bind to port " + std::to_string(port_) + ". " + std::string(strerror(errno)));
+            throw std::runtime_error("Could not bind to port " + std::to_string(port_) + ". " + std::string(strerror(errno)));
         }
 
-        if (listen(server_socket_fd_, 5) < 0) {
-            close(server_socket_fd_);
-            throw std::runtime_error("Error: Listen failed. " + std::string(strerror(errno)));
+        if (listen(server_socket_fd_, SOMAXCONN) < 0) {
+            throw std::runtime_error("Listen failed. " + std::string(strerror(errno)));
         }
 
-        std::cout << "Server listening on port " << port_ << std::endl;
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            throw std::runtime_error("Could not create epoll instance. " + std::string(strerror(errno)));
+        }
 
+        completion_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (completion_event_fd_ < 0) {
+            throw std::runtime_error("Could not create eventfd. " + std::string(strerror(errno)));
+        }
+
+        epoll_event listen_event{};
+        listen_event.events = EPOLLIN;
+        listen_event.data.u64 = LISTEN_TAG;
+        epoll_event completion_event{};
+        completion_event.events = EPOLLIN;
+        completion_event.data.u64 = COMPLETION_TAG;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, server_socket_fd_, &listen_event) < 0 ||
+            epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, completion_event_fd_, &completion_event) < 0) {
+            throw std::runtime_error("epoll_ctl failed. " + std::string(strerror(errno)));
+        }
+
+        open_metrics_listener();
+        session_store_.load_all();
+        LOG_INFO("Server listening on port " << port_);
+
+        epoll_event events[MAX_EVENTS];
+        while (true) {
+            int ready = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+            if (ready < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("epoll_wait failed. " + std::string(strerror(errno)));
+            }
+
+            for (int i = 0; i < ready; ++i) {
+                const uint64_t tag = events[i].data.u64;
+                if (tag == LISTEN_TAG) {
+                    accept_clients();
+                    continue;
+                }
+                if (tag == COMPLETION_TAG) {
+                    drain_completions();
+                    continue;
+                }
+                if (tag == METRICS_TAG) {
+                    serve_metrics();
+                    continue;
+                }
+
+                if (metrics_readers_.count(tag) != 0) {
+                    flush_metrics_reader(tag);
+                    continue;
+                }
+                auto it = sessions_.find(tag);
+                if (it == sessions_.end()) {
+                    continue; // Closed earlier in this round
+                }
+                std::shared_ptr<Session> session = it->second;
+
+                if ((events[i].events & (EPOLLHUP | EPOLLERR)) && session->closing) {
+                    close_session(*session); // Nobody is left to read the remaining answers
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    if (!flush_send_buffer(*session)) {
+                        close_session(*session);
+                        continue;
+                    }
+                    close_if_finished(*session);
+                    if (sessions_.count(tag) == 0)
+                        continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    handle_readable(*session);
+                    if (sessions_.count(tag) != 0)
+                        schedule_next_job(session);
+                }
+            }
+        }
+    }
+
+    void TcpServer::accept_clients() {
         while (true) {
             sockaddr_in client_address{};
             socklen_t client_len = sizeof(client_address);
-            int client_socket_fd = accept(server_socket_fd_, (struct sockaddr *)&client_address, &client_len);
+            int client_socket_fd = accept4(server_socket_fd_, (struct sockaddr *)&client_address, &client_len,
+                                           SOCK_NONBLOCK | SOCK_CLOEXEC);
 
             if (client_socket_fd < 0) {
-                std::cerr << "Error: Accept failed. " << strerror(errno) << ". Continuing..." << std::endl;
-                continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return;
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                LOG_ERROR("Accept failed. " << strerror(errno) << ". Continuing...");
+                return;
             }
 
             char client_ip_str[INET_ADDRSTRLEN];
             inet_ntop(AF_INET, &client_address.sin_addr, client_ip_str, INET_ADDRSTRLEN);
-            std::cout << "Connection accepted from " << client_ip_str << ":" << ntohs(client_address.sin_port) << std::endl;
+            std::string peer = std::string(client_ip_str) + ":" + std::to_string(ntohs(client_address.sin_port));
+
+            // Each connection gets its own simulator, so sessions never share ellipses
+            auto session = std::make_shared<Session>(next_session_id_++, client_socket_fd, peer, simulator_config_);
 
-            simulator_.clear_ellipses(); // Reset simulator for new client session
-            handle_client(client_socket_fd);
-            close(client_socket_fd);
-            std::cout << "Connection closed with " << client_ip_str << std::endl;
+            epoll_event event{};
+            event.events = session->registered_events;
+            event.data.u64 = session->id;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_socket_fd, &event) < 0) {
+                LOG_ERROR("epoll_ctl failed for new client. " << strerror(errno));
+                close(client_socket_fd);
+                continue;
+            }
+
+            sessions_.emplace(session->id, session);
+            metrics_.add(Counter::SessionsAccepted);
+            LOG_INFO("Connection accepted from " << peer);
         }
     }
 
-    void TcpServer::handle_client(int client_socket_fd) {
-        bool client_connected = true;
-        while (client_connected) {
-            auto line_opt = read_line_from_client(client_socket_fd, client_connected);
+    void TcpServer::open_metrics_listener() {
+        const int metrics_port = port_ + 1;
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int opt = 1;
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Never exposed beyond this host
+        address.sin_port = htons(metrics_port);
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = METRICS_TAG;
+        if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+            bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0 ||
+            epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            LOG_WARNING("Metrics disabled; could not listen on 127.0.0.1:" << metrics_port << ". " << strerror(errno));
+            if (fd >= 0)
+                close(fd);
+            return;
+        }
+        metrics_socket_fd_ = fd;
+        LOG_INFO("Metrics available on 127.0.0.1:" << metrics_port);
+    }
 
-            if (!client_connected || !line_opt) {
-                break;
+    void TcpServer::serve_metrics() {
+        std::string body; // Rendered once the first connection is accepted, then shared
+        while (true) {
+            int fd = accept4(metrics_socket_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    LOG_ERROR("Metrics accept failed. " << strerror(errno));
+                return;
+            }
+            if (body.empty()) {
+                body = render_metrics();
+            }
+
+            const uint64_t id = next_session_id_++;
+            epoll_event event{};
+            event.events = EPOLLOUT;
+            event.data.u64 = id;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                LOG_ERROR("epoll_ctl failed for metrics reader. " << strerror(errno));
+                close(fd);
+                continue;
             }
+            metrics_readers_.emplace(id, MetricsReader{fd, body});
+            flush_metrics_reader(id);
+        }
+    }
 
-            std::string line = *line_opt;
-            std::cout << "Server RX: " << line << std::endl;
+    std::string TcpServer::render_metrics() const {
+        std::ostringstream oss;
+        oss << metrics_.render();
+        oss << "# TYPE ellipse_sessions_active gauge\n"
+            << "ellipse_sessions_active " << sessions_.size() << "\n"
+            << "# TYPE ellipse_session_compute_microseconds_total counter\n";
+        for (const auto &entry : sessions_) {
+            const Session &session = *entry.second;
+            oss << "ellipse_session_compute_microseconds_total{session=\"" << session.id << "\",peer=\"" << session.peer
+                << "\"} " << session.compute_micros << "\n";
+        }
+        return oss.str();
+    }
 
-            std::istringstream iss(line);
-            Ellipse ellipse;
-            if (!(iss >> ellipse.cx >> ellipse.cy >> ellipse.a >> ellipse.b)) {
-                std::cerr << "Error: Could not parse ellipse data from client: " << line << std::endl;
+    void TcpServer::flush_metrics_reader(uint64_t id) {
+        MetricsReader &reader = metrics_readers_.at(id);
+        while (!reader.send_buf.empty()) {
+            ssize_t sent = send(reader.socket_fd, reader.send_buf.data(), reader.send_buf.size(), MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR)
+                continue;
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return; // EPOLLOUT brings us back
+            if (sent <= 0)
                 break;
+            reader.send_buf.erase(0, static_cast<std::size_t>(sent));
+        }
+        close(reader.socket_fd); // Also removes it from epoll
+        metrics_readers_.erase(id);
+    }
+
+    void TcpServer::handle_readable(Session &session) {
+        std::string error;
+        while (!session.closing) {
+            // Receive straight into the session buffer; no intermediate copy
+            char *dest = session.recv_buf.prepare(RECV_CHUNK_SIZE);
+            if (!dest) {
+                // Full: parse what has arrived, then fail if no complete message made room
+                if (process_received(session, error)) {
+                    dest = session.recv_buf.prepare(RECV_CHUNK_SIZE);
+                    if (!dest) {
+                        error = "Client sent more than " + std::to_string(ReceiveBuffer::DEFAULT_MAX_SIZE) +
+                                " bytes without completing a message";
+                    }
+                }
+                if (!dest) {
+                    LOG_ERROR(error);
+                    metrics_.add(Counter::ProtocolErrors);
+                    reject_session(session, error);
+                    return;
+                }
             }
+            ssize_t nbytes = recv(session.socket_fd, dest, session.recv_buf.writable(), 0);
+            if (nbytes > 0) {
+                session.recv_buf.commit(static_cast<std::size_t>(nbytes));
+                metrics_.add(Counter::BytesIn, static_cast<uint64_t>(nbytes));
+            } else if (nbytes == 0) { // peer closed connection
+                close_session(session);
+                return;
+            } else { // error
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                LOG_ERROR("recv error in handle_readable: " << strerror(errno));
+                close_session(session);
+                return;
+            }
+        }
 
-            if (ellipse.a <= 0 || ellipse.b <= 0) {
-                std::cerr << "Error: Invalid ellipse parameters (a or b not positive): a="
-                          << ellipse.a << ", b=" << ellipse.b << std::endl;
-                break;
+        if (!process_received(session, error)) {
+            LOG_ERROR(error);
+            metrics_.add(Counter::ProtocolErrors);
+            reject_session(session, error);
+            return;
+        }
+        if (!session.send_buf.empty() && !flush_send_buffer(session)) { // Handshake reply
+            close_session(session);
+        }
+    }
+
+    bool TcpServer::process_received(Session &session, std::string &error) {
+        if (!session.format) {
+            if (session.recv_buf.empty()) {
+                return true;
             }
+            std::string_view data = session.recv_buf.data();
+            if (static_cast<uint8_t>(data[0]) != Protocol::BINARY_MAGIC) {
+                session.format = Protocol::WireFormat::Text;
+            } else {
+                if (data.size() < Protocol::HANDSHAKE_SIZE) {
+                    return true;
+                }
+                session.format = Protocol::WireFormat::Binary;
+                uint8_t client_version = static_cast<uint8_t>(data[1]);
+                session.recv_buf.consume(Protocol::HANDSHAKE_SIZE);
+                if (client_version < Protocol::MIN_VERSION) {
+                    error = "Unsupported protocol version " + std::to_string(client_version);
+                    return false;
+                }
+                // Speak the newest version both sides know
+                session.protocol_version = std::min(client_version, Protocol::VERSION);
+                session.send_buf.push_back(static_cast<char>(Protocol::BINARY_MAGIC));
+                session.send_buf.push_back(static_cast<char>(session.protocol_version));
+                LOG_DEBUG("Binary protocol negotiated with " << session.peer);
+            }
+        }
 
-            simulator_.add_ellipse(ellipse);
-            std::cout << "Added ellipse. Total ellipses: " << simulator_.get_ellipse_count() << std::endl;
+        if (*session.format == Protocol::WireFormat::Text) {
+            std::string_view data = session.recv_buf.data();
+            std::size_t line_start = 0;
+            while (true) {
+                std::size_t nl = data.find('\n', line_start);
+                if (nl == std::string_view::npos)
+                    break;
+                if (!handle_line(session, data.substr(line_start, nl - line_start), error)) {
+                    return false;
+                }
+                line_start = nl + 1;
+            }
+            session.recv_buf.consume(line_start);
+            return true;
+        }
 
-            MonteCarloResult result = simulator_.estimate_area();
+        while (true) {
+            Protocol::Frame frame;
+            std::size_t consumed = 0;
+            Protocol::ParseStatus status = Protocol::parse_frame(session.recv_buf.data(), frame, consumed);
+            if (status == Protocol::ParseStatus::Incomplete) {
+                return true;
+            }
+            if (status == Protocol::ParseStatus::Invalid) {
+                error = "Malformed frame header from client";
+                return false;
+            }
+            session.recv_buf.consume(consumed); // The payload view stays valid until the next receive
+            if (!handle_frame(session, frame, error)) {
+                return false;
+            }
+        }
+    }
 
-            if (!send_response_to_client(client_socket_fd, result)) {
-                std::cerr << "Error: Failed to send response to client." << std::endl;
-                break;
+    bool TcpServer::handle_line(Session &session, std::string_view line, std::string &error) {
+        LOG_DEBUG("Server RX: " << line);
+
+        // Tokens are views into the receive buffer; nothing is copied unless the line is bad
+        std::string_view rest = line;
+        std::string_view first = Protocol::next_token(rest);
+        if (first == SESSION_COMMAND) {
+            std::string_view token = Protocol::next_token(rest);
+            if (token.empty() || !Protocol::next_token(rest).empty()) {
+                error = "Malformed session command: " + std::string(line);
+                return false;
+            }
+            return resume_session(session, std::string(token), error);
+        }
+        if (first == LOAD_COMMAND) {
+            std::string_view path = Protocol::next_token(rest);
+            EstimateOptions options = session.options;
+            if (path.empty()) {
+                error = "Malformed load command: " + std::string(line);
+                return false;
+            }
+            return RequestOptions::apply_all(rest, options, error) && queue_load(session, 0, path, options, error);
+        }
+        if (first == REMOVE_COMMAND || first == UPDATE_COMMAND) {
+            double id;
+            EllipseEdit edit{0, first == REMOVE_COMMAND, {}};
+            bool valid = Protocol::parse_double(Protocol::next_token(rest), id) && to_ellipse_id(id, edit.id);
+            if (valid && !edit.remove) {
+                valid = Protocol::parse_double(Protocol::next_token(rest), edit.ellipse.cx) &&
+                        Protocol::parse_double(Protocol::next_token(rest), edit.ellipse.cy) &&
+                        Protocol::parse_double(Protocol::next_token(rest), edit.ellipse.a) &&
+                        Protocol::parse_double(Protocol::next_token(rest), edit.ellipse.b);
+                parse_angle(rest, edit.ellipse.angle);
+            }
+            if (!valid) {
+                error = "Malformed " + std::string(first) + " command: " + std::string(line);
+                return false;
             }
+            if (!edit.remove && !validate_ellipse(edit.ellipse, error)) {
+                return false;
+            }
+            Request request{0, {}, session.options};
+            request.edits.push_back(edit);
+            if (!RequestOptions::apply_all(rest, request.options, error)) {
+                return false;
+            }
+            session.received_ellipses = true;
+            queue_request(session, std::move(request));
+            return true;
+        }
+
+        Ellipse ellipse;
+        if (!Protocol::parse_double(first, ellipse.cx) || !Protocol::parse_double(Protocol::next_token(rest), ellipse.cy) ||
+            !Protocol::parse_double(Protocol::next_token(rest), ellipse.a) ||
+            !Protocol::parse_double(Protocol::next_token(rest), ellipse.b)) {
+            error = "Could not parse ellipse data from client: " + std::string(line);
+            return false;
+        }
+        parse_angle(rest, ellipse.angle);
+        if (!validate_ellipse(ellipse, error)) {
+            return false;
+        }
+
+        // Options after the numbers apply to this request only
+        Request request{0, {ellipse}, session.options};
+        if (!RequestOptions::apply_all(rest, request.options, error)) {
+            return false;
         }
+
+        session.received_ellipses = true;
+        queue_request(session, std::move(request));
+        return true;
     }
 
-    std::optional<std::string> TcpServer::read_line_from_client(int client_socket_fd, bool &success) {
-        constexpr std::size_t BUF_SIZE = 256;
-        char temp[BUF_SIZE];
-        success = true;
+    bool TcpServer::handle_frame(Session &session, const Protocol::Frame &frame, std::string &error) {
+        if (frame.type == Protocol::MessageType::Options) {
+            LOG_DEBUG("Server RX (binary): options " << frame.payload);
+            return RequestOptions::apply_all(frame.payload, session.options, error);
+        }
+        if (frame.type == Protocol::MessageType::Session) {
+            return resume_session(session, std::string(frame.payload), error);
+        }
+        if (frame.type == Protocol::MessageType::Load) {
+            LOG_DEBUG("Server RX (binary): #" << frame.sequence << ", load " << frame.payload);
+            return queue_load(session, frame.sequence, frame.payload, session.options, error);
+        }
+        if (frame.type == Protocol::MessageType::Remove || frame.type == Protocol::MessageType::Update) {
+            const bool remove = frame.type == Protocol::MessageType::Remove;
+            const bool with_angle = session.protocol_version >= 3;
+            const std::size_t entry_size = remove ? Protocol::ELLIPSE_ID_SIZE
+                                                  : with_angle ? Protocol::UPDATE_SIZE : Protocol::UPDATE_SIZE_V2;
+            if (frame.payload.empty() || frame.payload.size() % entry_size != 0) {
+                error = std::string(remove ? "Remove" : "Update") + " frame has a payload of " +
+                        std::to_string(frame.payload.size()) + " bytes";
+                return false;
+            }
+            std::vector<double> values(frame.payload.size() / sizeof(double));
+            Protocol::read_doubles(frame.payload, values.data());
 
-        while (true) {
-            // First check if we already have a full line in recv_buf_
-            auto nl = std::find(recv_buf_.begin(), recv_buf_.end(), '\n');
-            if (nl != recv_buf_.end()) {
-                std::string line(recv_buf_.begin(), nl);
-                recv_buf_.erase(recv_buf_.begin(), nl + 1);
-                return line;
+            Request request{frame.sequence, {}, session.options};
+            const std::size_t stride = entry_size / sizeof(double);
+            request.edits.reserve(values.size() / stride);
+            for (std::size_t i = 0; i < values.size(); i += stride) {
+                EllipseEdit edit{0, remove, {}};
+                if (!to_ellipse_id(values[i], edit.id)) {
+                    error = "Invalid ellipse id " + std::to_string(values[i]);
+                    return false;
+                }
+                if (!remove) {
+                    edit.ellipse = {values[i + 1], values[i + 2], values[i + 3], values[i + 4], with_angle ? values[i + 5] : 0.0};
+                    if (!validate_ellipse(edit.ellipse, error)) {
+                        return false;
+                    }
+                }
+                request.edits.push_back(edit);
             }
+            LOG_DEBUG("Server RX (binary): #" << frame.sequence << ", " << request.edits.size()
+                      << (remove ? " removal(s)" : " update(s)"));
+            session.received_ellipses = true;
+            queue_request(session, std::move(request));
+            return true;
+        }
+        if (frame.type != Protocol::MessageType::Ellipse && frame.type != Protocol::MessageType::Batch &&
+            (frame.type != Protocol::MessageType::RotatedBatch || session.protocol_version < 3)) {
+            error = "Unexpected message type " + std::to_string(static_cast<int>(frame.type)) + " from client";
+            return false;
+        }
+        const bool rotated = frame.type == Protocol::MessageType::RotatedBatch;
+        const std::size_t entry_size = rotated ? Protocol::ROTATED_ELLIPSE_SIZE : Protocol::ELLIPSE_SIZE;
+        if (frame.payload.size() % entry_size != 0 ||
+            (frame.type == Protocol::MessageType::Ellipse && frame.payload.size() != Protocol::ELLIPSE_SIZE)) {
+            error = "Ellipse frame has a payload of " + std::to_string(frame.payload.size()) + " bytes";
+            return false;
+        }
 
-            // More data needed from client
-            ssize_t nbytes = recv(client_socket_fd, temp, BUF_SIZE, 0);
-            if (nbytes > 0) {
-                recv_buf_.append(temp, static_cast<std::size_t>(nbytes));
-            } else if (nbytes == 0) { // peer closed connection
-                success = false;
-                return std::nullopt;
-            } else { // error
-                if (errno == EINTR)
-                    continue;
-                perror("recv error in read_line_from_client");
-                success = false;
-                return std::nullopt;
+        std::vector<double> values(frame.payload.size() / sizeof(double));
+        Protocol::read_doubles(frame.payload, values.data());
+
+        Request request{frame.sequence, {}, session.options};
+        const std::size_t stride = entry_size / sizeof(double);
+        request.ellipses.reserve(values.size() / stride);
+        for (std::size_t i = 0; i < values.size(); i += stride) {
+            Ellipse ellipse{values[i], values[i + 1], values[i + 2], values[i + 3], rotated ? values[i + 4] : 0.0};
+            if (!validate_ellipse(ellipse, error)) {
+                return false;
             }
+            request.ellipses.push_back(ellipse);
         }
+
+        LOG_DEBUG("Server RX (binary): #" << frame.sequence << ", " << request.ellipses.size() << " ellipse(s)");
+        session.received_ellipses = true;
+        queue_request(session, std::move(request));
+        return true;
     }
 
-    bool TcpServer::send_all(int sockfd, const char *buffer, size_t length) {
-        size_t total_sent = 0;
-        while (total_sent < length) {
-            ssize_t sent_this_call = send(sockfd, buffer + total_sent, length - total_sent, 0);
-            if (sent_this_call < 0) {
-                if (errno == EINTR)
-                    continue; // Interrupted by signal, try again
-                perror("send_all failed");
+    bool TcpServer::resume_session(Session &session, const std::string &token, std::string &error) {
+        if (!session.token.empty() || session.received_ellipses) {
+            error = "A session token must be sent once, before any ellipse";
+            return false;
+        }
+        if (!session_store_.attach(token, session.accepted, error)) {
+            return false;
+        }
+        session.token = token;
+        session.checkpointed_count = session.accepted.size();
+        const std::size_t restored = session.accepted.size();
+        LOG_INFO("Session " << token << " resumed by " << session.peer << " with " << restored << " ellipse(s)");
+
+        // Re-adding runs on the compute pool like any request, ahead of everything sent later
+        if (restored > 0) {
+            queue_request(session, Request{0, session.accepted, session.options, true});
+        }
+
+        if (session.format == Protocol::WireFormat::Binary) {
+            const double count = static_cast<double>(restored);
+            Protocol::append_frame(session.send_buf, Protocol::MessageType::Session, 0, &count, 1);
+        } else {
+            session.send_buf += "Session " + token + ": " + std::to_string(restored) + " ellipses restored\n";
+        }
+        return true;
+    }
+
+    bool TcpServer::queue_load(Session &session, uint32_t sequence, std::string_view path, const EstimateOptions &options,
+                               std::string &error) {
+        if (!data_dir_) {
+            error = "Loading ellipse files is disabled on this server";
+            return false;
+        }
+        // Clients may only name files below the data directory
+        bool escapes = path.empty() || path.front() == '/';
+        for (std::string_view rest = path; !escapes && !rest.empty();) {
+            std::size_t slash = rest.find('/');
+            escapes = rest.substr(0, slash) == "..";
+            rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+        }
+        if (escapes) {
+            error = "Invalid ellipse file path '" + std::string(path) + "'";
+            return false;
+        }
+
+        Request request{sequence, {}, options};
+        request.load_path = *data_dir_ + "/" + std::string(path);
+        request.keep_loaded = !session.token.empty();
+        session.received_ellipses = true;
+        queue_request(session, std::move(request));
+        return true;
+    }
+
+    bool TcpServer::load_ellipse_file(Session &session, const Request &request, Completion &completion) {
+        EllipseFile::MappedFile file;
+        if (!file.open(request.load_path, completion.error)) {
+            return false;
+        }
+
+        // Validate everything first so a bad file leaves the simulator untouched
+        std::vector<Ellipse> chunk(std::min(file.size(), LOAD_CHUNK_ELLIPSES));
+        for (std::size_t first = 0; first < file.size(); first += chunk.size()) {
+            const std::size_t count = std::min(chunk.size(), file.size() - first);
+            file.read(first, count, chunk.data());
+            for (std::size_t i = 0; i < count; ++i) {
+                if (!validate_ellipse(chunk[i], completion.error)) {
+                    completion.error = "Ellipse " + std::to_string(first + i) + " of " + request.load_path + ": " + completion.error;
+                    return false;
+                }
+            }
+        }
+
+        if (request.keep_loaded) {
+            completion.loaded.reserve(file.size());
+        }
+        for (std::size_t first = 0; first < file.size(); first += chunk.size()) {
+            const std::size_t count = std::min(chunk.size(), file.size() - first);
+            file.read(first, count, chunk.data());
+            session.simulator.add_ellipses(chunk.data(), count);
+            for (std::size_t i = 0; i < count; ++i) {
+                session.fingerprint.add(chunk[i]);
+            }
+            if (request.keep_loaded) {
+                completion.loaded.insert(completion.loaded.end(), chunk.begin(), chunk.begin() + count);
+            }
+        }
+        LOG_INFO("Loaded " << file.size() << " ellipse(s) from " << request.load_path);
+        return true;
+    }
+
+    bool TcpServer::apply_edits(Session &session, const Request &request, Completion &completion) {
+        for (const EllipseEdit &edit : request.edits) {
+            std::optional<Ellipse> previous = session.simulator.get_ellipse(edit.id);
+            if (!previous) {
+                completion.error = "No ellipse with id " + std::to_string(edit.id);
                 return false;
             }
+            if (edit.remove) {
+                session.simulator.remove_ellipse(edit.id);
+            } else {
+                session.simulator.update_ellipse(edit.id, edit.ellipse);
+                session.fingerprint.add(edit.ellipse);
+            }
+            session.fingerprint.remove(*previous);
+        }
+        metrics_.add(Counter::EllipseEdits, request.edits.size());
+        LOG_DEBUG("Applied " << request.edits.size() << " edit(s). Total ellipses: " << session.simulator.get_ellipse_count());
+        return true;
+    }
+
+    void TcpServer::queue_request(Session &session, Request &&request) {
+        // The running estimate is superseded if both it and the new request may be coalesced;
+        // its requests are then answered by the next estimate instead
+        const Request *running = session.running.get();
+        if (running && running->options.coalesce && !running->restore && request.options.coalesce && !request.restore) {
+            session.stop_requested.store(true, std::memory_order_relaxed);
+        }
+        session.pending.push_back(std::move(request));
+    }
+
+    bool TcpServer::validate_ellipse(const Ellipse &ellipse, std::string &error) {
+        // Binary frames carry raw doubles; NaN would slip through the comparisons below
+        if (!std::isfinite(ellipse.cx) || !std::isfinite(ellipse.cy) || !std::isfinite(ellipse.a) ||
+            !std::isfinite(ellipse.b) || !std::isfinite(ellipse.angle)) {
+            std::ostringstream oss;
+            oss << "Invalid ellipse parameters (not finite): cx=" << ellipse.cx << ", cy=" << ellipse.cy << ", a=" << ellipse.a
+                << ", b=" << ellipse.b << ", angle=" << ellipse.angle;
+            error = oss.str();
+            return false;
+        }
+        if (ellipse.a <= 0 || ellipse.b <= 0) {
+            std::ostringstream oss;
+            oss << "Invalid ellipse parameters (a or b not positive): a=" << ellipse.a << ", b=" << ellipse.b;
+            error = oss.str();
+            return false;
+        }
+        return true;
+    }
+
+    void TcpServer::reject_session(Session &session, const std::string &reason) {
+        // Answer what was already accepted, then drop the connection
+        session.closing = true;
+        session.close_reason = reason;
+        session.recv_buf.clear();
+        if (!update_interest(session)) {
+            close_session(session);
+            return;
+        }
+        close_if_finished(session);
+    }
+
+    void TcpServer::schedule_next_job(const std::shared_ptr<Session> &session) {
+        if (session->busy || session->pending.empty()) {
+            return;
+        }
+
+        auto request = std::make_shared<Request>(std::move(session->pending.front()));
+        session->pending.pop_front();
+
+        // Only the newest ellipse set matters to requests that allow coalescing: merge the
+        // ones queued behind this one and answer them all with a single estimate
+        auto deadline_of = [](const Request &r) {
+            return r.options.deadline_ms > 0.0 ? r.received + std::chrono::microseconds(static_cast<int64_t>(r.options.deadline_ms * 1000.0))
+                                               : std::chrono::steady_clock::time_point::max();
+        };
+        std::chrono::steady_clock::time_point deadline = deadline_of(*request);
+        while (request->options.coalesce && !request->restore && request->load_path.empty() && !session->pending.empty()) {
+            Request &next = session->pending.front();
+            if (!next.options.coalesce || next.restore || !next.load_path.empty()) {
+                break;
+            }
+            request->superseded.push_back(request->sequence);
+            request->superseded.insert(request->superseded.end(), next.superseded.begin(), next.superseded.end());
+            request->sequence = next.sequence;
+            // Edits only name ellipses added before them, so adding all ellipses first is safe
+            request->ellipses.insert(request->ellipses.end(), next.ellipses.begin(), next.ellipses.end());
+            request->edits.insert(request->edits.end(), next.edits.begin(), next.edits.end());
+            request->options = next.options;
+            deadline = std::min(deadline, deadline_of(next));
+            session->pending.pop_front();
+        }
+        if (!request->superseded.empty()) {
+            LOG_DEBUG("Coalesced " << request->superseded.size() + 1 << " requests into one estimate");
+        }
+
+        session->busy = true;
+        session->running = request;
+        session->stop_requested.store(false, std::memory_order_relaxed);
+
+        // The job owns the simulator until its completion is drained on the event loop.
+        // A batch adds all of its ellipses and runs a single estimate.
+        scheduler_.submit(request->options.priority, deadline, [this, session, request, deadline] {
+            // The pool drops exceptions, so a failed job must still post a completion to free its session
+            try {
+                run_job(session, request, deadline);
+            } catch (const std::exception &e) {
+                fail_job(*session, *request, e.what());
+            } catch (...) {
+                fail_job(*session, *request, "unknown error");
+            }
+        });
+    }
+
+    void TcpServer::run_job(const std::shared_ptr<Session> &session, const std::shared_ptr<const Request> &request,
+                            std::chrono::steady_clock::time_point deadline) {
+        if (session->disconnected.load(std::memory_order_relaxed)) {
+            metrics_.add(Counter::JobsCancelled); // Nobody is left to answer
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        // Batches and restored sessions filter the persistent samples once for all their ellipses
+        if (request->ellipses.size() == 1) {
+            session->simulator.add_ellipse(request->ellipses.front());
+        } else {
+            session->simulator.add_ellipses(request->ellipses.data(), request->ellipses.size());
+        }
+        for (const Ellipse &ellipse : request->ellipses) {
+            if (!MonteCarloSimulator::is_empty_slot(ellipse)) { // Restored sessions keep the slots of removed ellipses
+                session->fingerprint.add(ellipse);
+            }
+        }
+        Completion completion{session->id, request->sequence, {}, true};
+        if ((!request->load_path.empty() && !load_ellipse_file(*session, *request, completion)) ||
+            (!request->edits.empty() && !apply_edits(*session, *request, completion))) {
+            post_completion(std::move(completion));
+            return;
+        }
+        if (request->restore) {
+            LOG_DEBUG("Restored " << request->ellipses.size() << " ellipse(s)");
+            post_completion({session->id, request->sequence, {}, false});
+            return;
+        }
+        LOG_DEBUG("Added " << request->ellipses.size() << " ellipse(s). Total ellipses: "
+                  << session->simulator.get_ellipse_count());
+
+        // Replayed workloads reach the same ellipse sets; their estimates are reused
+        std::optional<MonteCarloResult> result = result_cache_.find(session->fingerprint, request->options);
+        if (result) {
+            ResultCacheStats stats = result_cache_.get_stats();
+            LOG_DEBUG("Result cache hit (" << stats.hits << " hits, " << stats.misses << " misses)");
+            metrics_.add(Counter::CacheHits);
+        } else {
+            EstimateControl control{deadline, &session->stop_requested, {}, {}};
+            if (request->options.stream_ms > 0.0) {
+                const uint64_t session_id = session->id;
+                const uint32_t sequence = request->sequence;
+                control.on_progress = [this, session_id, sequence](const MonteCarloResult &partial) {
+                    Completion progress{session_id, sequence, partial};
+                    progress.partial = true;
+                    post_completion(std::move(progress));
+                };
+                control.progress_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::milli>(request->options.stream_ms));
+            }
+            result = session->simulator.estimate_area(request->options, control);
+            if (result->interrupted) {
+                // Not as precise as asked, so not cached for requests that wait for the full estimate
+                metrics_.add(Counter::EstimatesInterrupted);
+                completion.superseded = session->stop_requested.load(std::memory_order_relaxed);
+                LOG_DEBUG("Estimate interrupted after " << result->samples << " samples"
+                          << (completion.superseded ? " by a newer request" : " at its deadline"));
+            } else {
+                result_cache_.insert(session->fingerprint, request->options, *result);
+            }
+            if (result->samples > 0) {
+                metrics_.add(Counter::SamplesDrawn, static_cast<uint64_t>(result->samples));
+                metrics_.record(Histogram::SamplesPerEstimate, static_cast<uint64_t>(result->samples));
+            }
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const uint64_t micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        metrics_.add(Counter::Requests);
+        metrics_.add(Counter::EstimateMicros, micros);
+        metrics_.record(Histogram::EstimateLatencyMicros, micros);
+        completion.result = *result;
+        completion.compute_micros = micros;
+        post_completion(std::move(completion));
+    }
+
+    void TcpServer::fail_job(const Session &session, const Request &request, const char *what) {
+        metrics_.add(Counter::JobsFailed);
+        Completion completion{session.id, request.sequence, {}, true};
+        completion.error = std::string("Request failed: ") + what;
+        post_completion(std::move(completion));
+    }
+
+    void TcpServer::post_completion(Completion completion) {
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex_);
+            completions_.push_back(std::move(completion));
+        }
+        uint64_t one = 1;
+        if (write(completion_event_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            LOG_ERROR("write to completion eventfd failed: " << strerror(errno));
+        }
+    }
+
+    void TcpServer::drain_completions() {
+        uint64_t counter;
+        while (read(completion_event_fd_, &counter, sizeof(counter)) < 0 && errno == EINTR) {
+        }
+
+        std::vector<Completion> completed;
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex_);
+            completed.swap(completions_);
+        }
+
+        for (const Completion &completion : completed) {
+            auto it = sessions_.find(completion.session_id);
+            if (it == sessions_.end()) {
+                continue; // Client went away while its job was running
+            }
+            std::shared_ptr<Session> session = it->second;
+            if (completion.partial) {
+                // The job is still running; only its final completion frees the session
+                if (!send_partial_to_client(*session, completion.sequence, completion.result)) {
+                    LOG_ERROR("Failed to send partial result to client.");
+                    close_session(*session);
+                }
+                continue;
+            }
+            session->busy = false;
+            session->compute_micros += completion.compute_micros;
+            std::shared_ptr<const Request> request = std::move(session->running);
 
-            total_sent += sent_this_call;
+            if (!completion.error.empty()) {
+                // Nothing sent after the failed request is run; superseded requests get the estimate they had
+                LOG_ERROR(completion.error);
+                session->pending.clear();
+                for (uint32_t sequence : session->deferred) {
+                    send_response_to_client(*session, sequence, session->deferred_result);
+                }
+                session->deferred.clear();
+                reject_session(*session, completion.error);
+                continue;
+            }
+
+            if (!session->token.empty() && !request->restore) {
+                session->accepted.insert(session->accepted.end(), request->ellipses.begin(), request->ellipses.end());
+                session->accepted.insert(session->accepted.end(), completion.loaded.begin(), completion.loaded.end());
+                for (const EllipseEdit &edit : request->edits) {
+                    session->accepted[edit.id] = edit.remove ? MonteCarloSimulator::EMPTY_SLOT : edit.ellipse;
+                }
+                session->edited_since_checkpoint += request->edits.size();
+                // The interval grows with the session, so the snapshots of a growing session add up to linear size
+                const std::size_t interval = std::max(CHECKPOINT_INTERVAL, session->checkpointed_count / CHECKPOINT_GROWTH_DIVISOR);
+                if (session->accepted.size() - session->checkpointed_count + session->edited_since_checkpoint >= interval) {
+                    session_store_.checkpoint(session->token, session->accepted);
+                    session->checkpointed_count = session->accepted.size();
+                    session->edited_since_checkpoint = 0;
+                }
+            }
+            if (!completion.answered) {
+                schedule_next_job(session);
+                close_if_finished(*session);
+                continue;
+            }
+            if (completion.superseded && !session->pending.empty()) {
+                // The newer request is already pending and answers this one with its estimate
+                session->deferred.insert(session->deferred.end(), request->superseded.begin(), request->superseded.end());
+                session->deferred.push_back(request->sequence);
+                session->deferred_result = completion.result;
+                schedule_next_job(session);
+                continue;
+            }
+
+            if (!answer_requests(*session, *request, completion.result)) {
+                LOG_ERROR("Failed to send response to client.");
+                close_session(*session);
+                continue;
+            }
+            schedule_next_job(session);
+            close_if_finished(*session);
+        }
+    }
+
+    bool TcpServer::answer_requests(Session &session, const Request &request, const MonteCarloResult &result) {
+        const std::size_t coalesced = session.deferred.size() + request.superseded.size();
+        if (coalesced > 0) {
+            metrics_.add(Counter::RequestsCoalesced, coalesced);
+        }
+        std::vector<uint32_t> sequences = std::move(session.deferred);
+        session.deferred.clear();
+        sequences.insert(sequences.end(), request.superseded.begin(), request.superseded.end());
+        sequences.push_back(request.sequence);
+        for (uint32_t sequence : sequences) {
+            if (!send_response_to_client(session, sequence, result)) {
+                return false;
+            }
         }
         return true;
     }
 
-    bool TcpServer::send_response_to_client(int client_socket_fd, const MonteCarloResult &result) {
+    bool TcpServer::send_response_to_client(Session &session, uint32_t sequence, const MonteCarloResult &result) {
+        if (session.format == Protocol::WireFormat::Binary) {
+            const double values[2] = {result.covered_area, result.percentage_covered};
+            Protocol::append_frame(session.send_buf, Protocol::MessageType::Result, sequence, values, 2);
+            return flush_send_buffer(session);
+        }
+
         std::ostringstream oss;
         oss << std::fixed << std::setprecision(2); // Format numbers to two decimal places
         oss << "Covered Area: " << result.covered_area << " units²\n";
         oss << "Percentage of Canvas Covered: " << result.percentage_covered << "%\n";
 
         std::string response_str = oss.str();
-        std::cout << "Server TX:\n"
-                  << response_str;
-        return send_all(client_socket_fd, response_str.c_str(), response_str.length());
+        LOG_DEBUG("Server TX:\n"
+                  << response_str.substr(0, response_str.size() - 1)); // The logger ends the line
+        session.send_buf += response_str;
+        return flush_send_buffer(session);
+    }
+
+    bool TcpServer::send_partial_to_client(Session &session, uint32_t sequence, const MonteCarloResult &result) {
+        metrics_.add(Counter::PartialResults);
+        if (session.format == Protocol::WireFormat::Binary) {
+            const double values[5] = {result.covered_area, result.percentage_covered, result.interval_low,
+                                      result.interval_high, static_cast<double>(result.samples)};
+            Protocol::append_frame(session.send_buf, Protocol::MessageType::Partial, sequence, values, 5);
+            return flush_send_buffer(session);
+        }
+
+        // One line, so that clients that do not stream can tell it from the two-line result
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(2);
+        oss << "Partial Covered Area: " << result.covered_area << " units² (" << result.percentage_covered
+            << "%), interval [" << result.interval_low << ", " << result.interval_high << "] after "
+            << result.samples << " samples\n";
+
+        std::string partial_str = oss.str();
+        LOG_DEBUG("Server TX: " << partial_str.substr(0, partial_str.size() - 1)); // The logger ends the line
+        session.send_buf += partial_str;
+        return flush_send_buffer(session);
+    }
+
+    bool TcpServer::flush_send_buffer(Session &session) {
+        std::size_t total_sent = 0;
+        while (total_sent < session.send_buf.size()) {
+            ssize_t sent_this_call = send(session.socket_fd, session.send_buf.data() + total_sent,
+                                          session.send_buf.size() - total_sent, MSG_NOSIGNAL);
+            if (sent_this_call < 0) {
+                if (errno == EINTR)
+                    continue; // Interrupted by signal, try again
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break; // Socket buffer full; wait for EPOLLOUT
+                LOG_ERROR("send failed: " << strerror(errno));
+                return false;
+            }
+            total_sent += static_cast<std::size_t>(sent_this_call);
+        }
+        metrics_.add(Counter::BytesOut, total_sent);
+        session.send_buf.erase(0, total_sent);
+        return update_interest(session);
+    }
+
+    bool TcpServer::update_interest(Session &session) {
+        // A closing session no longer reads; it only waits to flush its answers
+        uint32_t events = (session.closing ? 0u : uint32_t{EPOLLIN}) | (session.send_buf.empty() ? 0u : uint32_t{EPOLLOUT});
+        if (events == session.registered_events) {
+            return true;
+        }
+
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = session.id;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, session.socket_fd, &event) < 0) {
+            LOG_ERROR("epoll_ctl failed: " << strerror(errno));
+            return false;
+        }
+        session.registered_events = events;
+        return true;
+    }
+
+    void TcpServer::close_if_finished(Session &session) {
+        if (!session.closing || session.busy || !session.pending.empty()) {
+            return;
+        }
+
+        // Binary clients learn why they are disconnected, after all earlier answers
+        if (!session.close_reason.empty() && session.format == Protocol::WireFormat::Binary) {
+            Protocol::append_frame(session.send_buf, Protocol::MessageType::Error, 0, session.close_reason);
+            session.close_reason.clear();
+            if (!flush_send_buffer(session)) {
+                close_session(session);
+                return;
+            }
+        }
+
+        if (session.send_buf.empty()) {
+            close_session(session);
+        }
+    }
+
+    void TcpServer::close_session(Session &session) {
+        // A queued job for this session is dropped and a running estimate stops at its next round
+        session.disconnected.store(true, std::memory_order_relaxed);
+        session.stop_requested.store(true, std::memory_order_relaxed);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session.socket_fd, nullptr);
+        close(session.socket_fd);
+        LOG_INFO("Connection closed with " << session.peer);
+        metrics_.add(Counter::SessionsClosed);
+        if (!session.token.empty()) {
+            // Only answered requests are kept; a running job's ellipses are resent on resume
+            session_store_.detach(session.token, std::move(session.accepted));
+        }
+        sessions_.erase(session.id); // May destroy session; do not touch it afterwards
     }
 
-} // namespace Server
\ No newline at end of file
+} // namespace Server
@@ -1,65 +1,385 @@
 #pragma once
 
+#include "common/ellipse.h"
+#include "common/protocol.h"
+#include "common/receive_buffer.h"
+#include "job_scheduler.h"
+#include "metrics.h"
 #include "monte_carlo_simulator.h"
+#include "result_cache.h"
+#include "sample_budget.h"
+#include "session_store.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
 
 namespace Server {
 
     /**
      * @brief Manages the server-side operations including network communication and simulation.
+     * All sockets are non-blocking and multiplexed by a single epoll loop; simulations run on
+     * a compute pool so a slow estimate never stalls network I/O for other clients. Jobs are
+     * ordered by priority and deadline, and estimates stop early when their deadline passes,
+     * a newer request supersedes them, or their client disconnects.
+     * Metrics are served in text form to every connection on 127.0.0.1, port + 1.
      */
     class TcpServer {
     public:
         /**
          * @brief Constructs the server.
          * @param port The port number to listen on.
+         * @param num_threads The number of compute threads, and of threads used to run one simulation.
+         * @param seed Seed for the simulation RNG streams; random if not set.
+         * @param snapshot_dir Directory for session snapshots; resumable sessions only live in memory if not set.
+         * @param data_dir Directory of ellipse files clients may load; loading is disabled if not set.
+         */
+        TcpServer(int port, unsigned int num_threads = 1, std::optional<unsigned int> seed = std::nullopt,
+                  std::optional<std::string> snapshot_dir = std::nullopt, std::optional<std::string> data_dir = std::nullopt);
+
+        /**
+         * @brief Destructor. Closes all sockets.
          */
-        TcpServer(int port);
+        ~TcpServer();
+
+        TcpServer(const TcpServer &) = delete;
+        TcpServer &operator=(const TcpServer &) = delete;
 
         /**
          * @brief Starts the server and begins listening for client connections.
-         * This function will run indefinitely, handling one client at a time.
+         * This function will run indefinitely, serving all connected clients concurrently.
          */
         void start();
 
+        /**
+         * @brief Checks that an ellipse received from a client can be simulated.
+         * Every field must be finite and both semi-axes positive.
+         * @param ellipse The ellipse.
+         * @param error Receives a description of the problem if it is invalid.
+         * @return True if the ellipse is valid, false otherwise.
+         */
+        static bool validate_ellipse(const Ellipse &ellipse, std::string &error);
+
     private:
         /**
-         * @brief Handles communication with a single connected client.
-         * @param client_socket_fd The file descriptor for the client's socket.
+         * @brief A removal or replacement of an ellipse the session added before.
+         */
+        struct EllipseEdit {
+            uint64_t id;     // See Protocol::ELLIPSE_ID_SIZE
+            bool remove;     // Remove the ellipse; otherwise replace it
+            Ellipse ellipse; // The replacement; unused for removals
+        };
+
+        /**
+         * @brief One client request: ellipses to add or edit, or an ellipse file, answered by one estimate.
+         */
+        struct Request {
+            uint32_t sequence; // Echoed in binary results; always 0 for text clients
+            std::vector<Ellipse> ellipses;
+            EstimateOptions options;
+            bool restore = false;     // Re-adds the ellipses of a resumed session; not answered
+            std::string load_path{};  // Ellipse file the job maps and adds before estimating; empty if none
+            bool keep_loaded = false; // Return the loaded ellipses, for the snapshot of a resumable session
+            std::chrono::steady_clock::time_point received = std::chrono::steady_clock::now(); // Start of the deadline
+            std::vector<uint32_t> superseded{}; // Coalesced earlier requests, answered first with the same estimate
+            std::vector<EllipseEdit> edits{};   // Applied in order after the ellipses are added
+        };
+
+        /**
+         * @brief State of one client connection.
+         */
+        struct Session {
+            uint64_t id;
+            int socket_fd;
+            std::string peer;              // "ip:port", for logging
+            ReceiveBuffer recv_buf;        // Received bytes not yet forming a full line or frame
+            std::string send_buf;          // Response bytes not yet accepted by the socket
+            std::deque<Request> pending;   // Parsed requests waiting for the simulator
+            EstimateOptions options;       // Defaults for new requests, set by Options frames
+            MonteCarloSimulator simulator; // Owned by the compute job while busy is set
+            EllipseSetFingerprint fingerprint; // Of the simulator's ellipses; owned like the simulator
+            bool busy = false;             // A compute job is running for this session
+            bool closing = false;          // Close once pending work is answered and flushed
+            std::string close_reason;      // Protocol error reported to binary clients before closing
+            std::optional<Protocol::WireFormat> format; // Decided by the first byte received
+            uint8_t protocol_version = 0;  // Negotiated binary protocol version
+            uint32_t registered_events;    // Current epoll interest set
+            std::string token;             // Resumable session token; empty if none was given
+            bool received_ellipses = false; // A session token is only accepted before the first ellipse
+            std::vector<Ellipse> accepted; // Ellipses of answered requests, tracked only with a token
+            std::shared_ptr<const Request> running; // The request of the running compute job
+            std::size_t checkpointed_count = 0;     // Size of accepted at the last checkpoint
+            std::size_t edited_since_checkpoint = 0; // Edits of accepted since the last checkpoint
+            uint64_t compute_micros = 0;   // Compute time of all finished jobs
+            std::atomic<bool> stop_requested{false}; // Cuts the running estimate short: superseded or disconnected
+            std::atomic<bool> disconnected{false};   // Set when the connection closes; queued jobs are dropped
+            std::vector<uint32_t> deferred;          // Requests whose estimate was superseded; answered by the next one
+            MonteCarloResult deferred_result{};      // Best estimate of the superseded job, in case the next one fails
+
+            Session(uint64_t session_id, int fd, std::string peer_name, const SimulatorConfig &config)
+                : id(session_id), socket_fd(fd), peer(std::move(peer_name)), simulator(config), registered_events(EPOLLIN) {}
+        };
+
+        /**
+         * @brief A finished estimate on its way back to the event loop.
+         */
+        struct Completion {
+            uint64_t session_id;
+            uint32_t sequence;
+            MonteCarloResult result;
+            bool answered = true; // False for restore jobs, which send nothing
+            uint64_t compute_micros = 0;
+            std::string error{};           // Why the request failed; the session is rejected with it
+            bool superseded = false;       // Stopped for a newer request, which will answer this one
+            std::vector<Ellipse> loaded{}; // Ellipses added from a file, if the request asked to keep them
+            bool partial = false;          // An estimate so far, streamed while the job keeps running
+        };
+
+        /**
+         * @brief Accepts all pending connections on the listening socket.
+         */
+        void accept_clients();
+
+        /**
+         * @brief Opens the local metrics listener on port + 1.
+         * Metrics are optional, so failing to listen only logs a warning.
          */
-        void handle_client(int client_socket_fd);
+        void open_metrics_listener();
 
         /**
-         * @brief Reads a line of text from the client socket.
-         * @param client_socket_fd The client socket file descriptor.
-         * @param success Reference to a boolean flag, set to false on read error or disconnect.
-         * @return The line read (without newline), or std::nullopt on error/disconnect.
+         * @brief Accepts all pending metrics connections and starts sending them the current metrics.
+         * Every connection gets the same text, rendered once before accepting. Whatever the
+         * socket does not take at once is sent from EPOLLOUT, so a slow reader never blocks the loop.
          */
-        std::optional<std::string> read_line_from_client(int client_socket_fd, bool &success);
+        void serve_metrics();
 
         /**
-         * @brief Sends the simulation result back to the client.
-         * @param client_socket_fd The client socket file descriptor.
+         * @brief Renders the metrics text, including the per-session gauges.
+         * @return The text served on the metrics port.
+         */
+        std::string render_metrics() const;
+
+        /**
+         * @brief Sends what a metrics connection still has buffered; closes it once done or failed.
+         * @param id The connection's epoll tag.
+         */
+        void flush_metrics_reader(uint64_t id);
+
+        /**
+         * @brief Reads everything available from a client and queues the ellipses it sent.
+         * @param session The client session.
+         */
+        void handle_readable(Session &session);
+
+        /**
+         * @brief Detects the wire format of a new session and consumes all complete messages.
+         * @param session The client session.
+         * @param error Receives a description of the problem on a protocol error.
+         * @return True on success, false on a protocol error.
+         */
+        bool process_received(Session &session, std::string &error);
+
+        /**
+         * @brief Parses one text line from a client into a pending request.
+         * @param session The client session.
+         * @param line The line (without newline).
+         * @param error Receives a description of the problem on a protocol error.
+         * @return True if the line was valid, false on a protocol error.
+         */
+        bool handle_line(Session &session, std::string_view line, std::string &error);
+
+        /**
+         * @brief Handles one binary frame from a client.
+         * @param session The client session.
+         * @param frame The decoded frame.
+         * @param error Receives a description of the problem on a protocol error.
+         * @return True if the frame was valid, false on a protocol error.
+         */
+        bool handle_frame(Session &session, const Protocol::Frame &frame, std::string &error);
+
+        /**
+         * @brief Binds a session to a token and restores the ellipses saved under it.
+         * Answered with the number of restored ellipses.
+         * @param session The client session.
+         * @param token The session token.
+         * @param error Receives a description of the problem on a protocol error.
+         * @return True on success, false on a protocol error.
+         */
+        bool resume_session(Session &session, const std::string &token, std::string &error);
+
+        /**
+         * @brief Queues a request that adds the ellipses of a file in the data directory.
+         * The file is mapped and read by the compute job, not on the event loop.
+         * @param session The client session.
+         * @param sequence The sequence number of the request.
+         * @param path The file path, relative to the data directory.
+         * @param options The options of the estimate that answers the request.
+         * @param error Receives a description of the problem on a protocol error.
+         * @return True on success, false on a protocol error.
+         */
+        bool queue_load(Session &session, uint32_t sequence, std::string_view path, const EstimateOptions &options,
+                        std::string &error);
+
+        /**
+         * @brief Adds the ellipses of a mapped file to a session's simulator, in chunks (compute thread).
+         * @param session The client session, whose simulator the calling job owns.
+         * @param request The load request.
+         * @param completion Receives the loaded ellipses if requested, or the error.
+         * @return True on success, false if the file cannot be read or holds an invalid ellipse.
+         */
+        bool load_ellipse_file(Session &session, const Request &request, Completion &completion);
+
+        /**
+         * @brief Applies the removals and replacements of a request to a session's simulator (compute thread).
+         * @param session The client session, whose simulator the calling job owns.
+         * @param request The request.
+         * @param completion Receives the error.
+         * @return True on success, false if an edit names no current ellipse.
+         */
+        bool apply_edits(Session &session, const Request &request, Completion &completion);
+
+        /**
+         * @brief Queues a parsed request of a session.
+         * A running estimate that the new request supersedes is asked to stop early.
+         * @param session The client session.
+         * @param request The request.
+         */
+        void queue_request(Session &session, Request &&request);
+
+        /**
+         * @brief Stops reading from a client after a protocol error.
+         * Requests received before the error are still answered.
+         * @param session The client session.
+         * @param reason The error, reported to binary clients.
+         */
+        void reject_session(Session &session, const std::string &reason);
+
+        /**
+         * @brief Hands the next pending request of a session to the scheduler, unless a job is running.
+         * Consecutive pending requests that allow coalescing run as one job, answered by one estimate.
+         * @param session The client session.
+         */
+        void schedule_next_job(const std::shared_ptr<Session> &session);
+
+        /**
+         * @brief Runs a scheduled request and posts its completion (compute thread).
+         * @param session The client session, whose simulator the job owns.
+         * @param request The request.
+         * @param deadline When the estimate must stop, or time_point::max() for none.
+         */
+        void run_job(const std::shared_ptr<Session> &session, const std::shared_ptr<const Request> &request,
+                     std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * @brief Posts the completion of a job that threw, so the session is freed and rejected (compute thread).
+         * @param session The client session.
+         * @param request The request whose job failed.
+         * @param what The exception message.
+         */
+        void fail_job(const Session &session, const Request &request, const char *what);
+
+        /**
+         * @brief Called from compute threads to pass a result to the event loop.
+         * @param completion The finished estimate.
+         */
+        void post_completion(Completion completion);
+
+        /**
+         * @brief Sends the results of all finished jobs to their clients.
+         */
+        void drain_completions();
+
+        /**
+         * @brief Answers every request waiting on an estimate, oldest first.
+         * @param session The client session.
+         * @param request The request whose job produced the estimate.
+         * @param result The estimate.
+         * @return True if the connection is still usable, false otherwise.
+         */
+        bool answer_requests(Session &session, const Request &request, const MonteCarloResult &result);
+
+        /**
+         * @brief Queues the simulation result for a client and tries to send it.
+         * @param session The client session.
+         * @param sequence The sequence number of the request being answered.
          * @param result The Monte Carlo simulation result.
-         * @return True if sending was successful, false otherwise.
+         * @return True if the connection is still usable, false otherwise.
+         */
+        bool send_response_to_client(Session &session, uint32_t sequence, const MonteCarloResult &result);
+
+        /**
+         * @brief Queues an estimate that is still being refined for a client and tries to send it.
+         * @param session The client session.
+         * @param sequence The sequence number of the request being estimated.
+         * @param result The estimate so far.
+         * @return True if the connection is still usable, false otherwise.
          */
-        bool send_response_to_client(int client_socket_fd, const MonteCarloResult &result);
+        bool send_partial_to_client(Session &session, uint32_t sequence, const MonteCarloResult &result);
 
         /**
-         * @brief Sends a complete message buffer over the socket.
-         * Handles potential partial sends.
-         * @param sockfd The socket file descriptor.
-         * @param buffer The data buffer to send.
-         * @param length The length of the data in the buffer.
-         * @return True on success, false on failure.
+         * @brief Writes as much of the send buffer as the socket accepts.
+         * Registers for EPOLLOUT while data remains.
+         * @param session The client session.
+         * @return True on success, false on a socket error.
          */
-        bool send_all(int sockfd, const char *buffer, size_t length);
+        bool flush_send_buffer(Session &session);
+
+        /**
+         * @brief Registers the epoll events a session currently needs.
+         * @param session The client session.
+         * @return True on success, false if epoll_ctl failed.
+         */
+        bool update_interest(Session &session);
+
+        /**
+         * @brief Closes a session once it has no queued, running or unsent work left.
+         * @param session The client session.
+         */
+        void close_if_finished(Session &session);
+
+        /**
+         * @brief Unregisters and closes a client socket and forgets its session.
+         * A running compute job keeps the session object alive; its result is dropped.
+         * @param session The client session.
+         */
+        void close_session(Session &session);
 
         int port_;
         int server_socket_fd_;
-        MonteCarloSimulator simulator_;
-        std::string recv_buf_;
+        int metrics_socket_fd_;
+        int epoll_fd_;
+        int completion_event_fd_; // Signalled by compute threads when completions_ is not empty
+        SimulatorConfig simulator_config_;
+        ThreadPool sampling_pool_; // Must outlive the sessions' simulators
+        SampleBudget sample_budget_; // Persistent samples of all sessions' simulators; must outlive them
+        std::optional<std::string> data_dir_; // Root of the files clients may load
+        uint64_t next_session_id_;
+        std::unordered_map<uint64_t, std::shared_ptr<Session>> sessions_;
+
+        /**
+         * @brief A metrics connection whose answer has not been fully sent.
+         */
+        struct MetricsReader {
+            int socket_fd;
+            std::string send_buf; // Metrics text not yet accepted by the socket
+        };
+        std::unordered_map<uint64_t, MetricsReader> metrics_readers_; // Keyed like sessions_, from the same ids
+        SessionStore session_store_;
+        ResultCache result_cache_; // Shared by all sessions; used from compute threads
+        Metrics metrics_;          // Recorded by the event loop and the compute threads
+        std::mutex completions_mutex_;
+        std::vector<Completion> completions_;
+        JobScheduler scheduler_;  // Orders the jobs run by compute_pool_
+        ThreadPool compute_pool_; // Declared last so its jobs finish before anything they use is destroyed
     };
 
-} // namespace Server
\ No newline at end of file
+} // namespace Server
@@ -0,0 +1,221 @@
+#include "session_store.h"
+#include "common/ellipse_file.h"
+#include "common/logger.h"
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+namespace Server {
+
+    SessionStore::SessionStore(std::optional<std::string> directory, std::size_t max_detached,
+                               std::chrono::steady_clock::duration time_to_live)
+        : directory_(std::move(directory)), max_detached_(max_detached), time_to_live_(time_to_live) {
+        if (directory_) {
+            std::error_code ec;
+            std::filesystem::create_directories(*directory_, ec);
+            if (ec) {
+                throw std::runtime_error("Could not create snapshot directory " + *directory_ + ". " + ec.message());
+            }
+            writer_ = std::thread(&SessionStore::run_writer, this);
+        }
+    }
+
+    SessionStore::~SessionStore() {
+        if (!writer_.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex_);
+            stopping_ = true;
+        }
+        writer_cv_.notify_one();
+        writer_.join();
+    }
+
+    void SessionStore::load_all() {
+        if (!directory_) {
+            return;
+        }
+
+        std::size_t loaded = 0;
+        std::error_code ec;
+        for (const auto &file : std::filesystem::directory_iterator(*directory_, ec)) {
+            const std::filesystem::path &path = file.path();
+            const std::string token = path.stem().string();
+            if (path.extension() != EllipseFile::EXTENSION || !is_valid_token(token)) {
+                continue; // Also skips temporary files of interrupted checkpoints
+            }
+            if (loaded >= max_detached_) {
+                break; // The rest are read when their sessions attach
+            }
+
+            std::string error;
+            auto ellipses = std::make_shared<std::vector<Ellipse>>();
+            if (!EllipseFile::load(path.string(), *ellipses, error)) {
+                LOG_WARNING("Skipping session snapshot. " << error);
+                continue;
+            }
+            Entry &entry = entries_[token];
+            entry.ellipses = std::move(ellipses);
+            entry.detached_at = std::chrono::steady_clock::now();
+            entry.detached_position = detached_.insert(detached_.end(), token);
+            ++loaded;
+        }
+        if (ec) {
+            LOG_WARNING("Could not list snapshot directory " << *directory_ << ". " << ec.message());
+        }
+        LOG_INFO("Loaded " << loaded << " session snapshot(s) from " << *directory_);
+    }
+
+    bool SessionStore::is_valid_token(const std::string &token) {
+        if (token.empty() || token.size() > MAX_TOKEN_LENGTH) {
+            return false;
+        }
+        for (char c : token) {
+            bool allowed = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+            if (!allowed) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SessionStore::attach(const std::string &token, std::vector<Ellipse> &ellipses, std::string &error) {
+        if (!is_valid_token(token)) {
+            error = "Invalid session token '" + token + "'";
+            return false;
+        }
+        evict();
+
+        auto it = entries_.find(token);
+        if (it == entries_.end()) {
+            read_snapshot(token, ellipses);
+            entries_[token].attached = true;
+            return true;
+        }
+        Entry &entry = it->second;
+        if (entry.attached) {
+            error = "Session " + token + " is already in use by another connection";
+            return false;
+        }
+        entry.attached = true;
+        detached_.erase(entry.detached_position);
+        ellipses = *entry.ellipses;
+        entry.ellipses.reset();
+        return true;
+    }
+
+    void SessionStore::checkpoint(const std::string &token, const std::vector<Ellipse> &ellipses) {
+        if (directory_) {
+            queue_snapshot(token, std::make_shared<const std::vector<Ellipse>>(ellipses));
+        }
+    }
+
+    void SessionStore::detach(const std::string &token, std::vector<Ellipse> ellipses) {
+        Snapshot snapshot = std::make_shared<const std::vector<Ellipse>>(std::move(ellipses));
+        if (directory_) {
+            queue_snapshot(token, snapshot);
+        }
+        Entry &entry = entries_[token];
+        entry.ellipses = std::move(snapshot);
+        entry.attached = false;
+        entry.detached_at = std::chrono::steady_clock::now();
+        entry.detached_position = detached_.insert(detached_.end(), token);
+        evict();
+    }
+
+    void SessionStore::flush() {
+        std::unique_lock<std::mutex> lock(writer_mutex_);
+        written_cv_.wait(lock, [this] { return pending_.empty(); });
+    }
+
+    std::size_t SessionStore::size() const {
+        return entries_.size();
+    }
+
+    std::string SessionStore::snapshot_path(const std::string &token) const {
+        return (std::filesystem::path(*directory_) / (token + EllipseFile::EXTENSION)).string();
+    }
+
+    void SessionStore::queue_snapshot(const std::string &token, Snapshot ellipses) {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex_);
+            PendingWrite &pending = pending_[token];
+            pending.ellipses = std::move(ellipses); // Replaces a snapshot not yet written
+            // A token the writer has already taken is queued again, to write the newer ellipses
+            if (!pending.queued) {
+                pending.queued = true;
+                write_order_.push_back(token);
+            }
+        }
+        writer_cv_.notify_one();
+    }
+
+    void SessionStore::read_snapshot(const std::string &token, std::vector<Ellipse> &ellipses) {
+        ellipses.clear();
+        if (!directory_) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex_);
+            auto it = pending_.find(token);
+            if (it != pending_.end()) {
+                ellipses = *it->second.ellipses;
+                return;
+            }
+        }
+        const std::string path = snapshot_path(token);
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec)) {
+            return;
+        }
+        std::string error;
+        if (!EllipseFile::load(path, ellipses, error)) {
+            LOG_WARNING("Starting session " << token << " empty. " << error);
+            ellipses.clear();
+        }
+    }
+
+    void SessionStore::evict() {
+        const auto expired = std::chrono::steady_clock::now() - time_to_live_;
+        while (!detached_.empty()) {
+            auto it = entries_.find(detached_.front());
+            if (detached_.size() <= max_detached_ && it->second.detached_at > expired) {
+                break;
+            }
+            entries_.erase(it);
+            detached_.pop_front();
+        }
+    }
+
+    void SessionStore::run_writer() {
+        std::unique_lock<std::mutex> lock(writer_mutex_);
+        while (true) {
+            writer_cv_.wait(lock, [this] { return stopping_ || !write_order_.empty(); });
+            if (write_order_.empty()) {
+                return; // Stopping, and everything queued is written
+            }
+            const std::string token = std::move(write_order_.front());
+            write_order_.pop_front();
+            PendingWrite &pending = pending_.at(token);
+            pending.queued = false;
+            Snapshot ellipses = pending.ellipses;
+
+            lock.unlock();
+            std::string error;
+            if (!EllipseFile::save(snapshot_path(token), *ellipses, error)) {
+                LOG_WARNING("Could not checkpoint session " << token << ". " << error);
+            }
+            lock.lock();
+
+            auto it = pending_.find(token);
+            if (it != pending_.end() && !it->second.queued) {
+                pending_.erase(it); // Not replaced while it was written
+            }
+            if (pending_.empty()) {
+                written_cv_.notify_all();
+            }
+        }
+    }
+
+} // namespace Server
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "common/ellipse.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Server {
+
+    /**
+     * @brief Ellipse sets of token-identified sessions, kept across connections.
+     * A client that reconnects with the same token resumes its ellipses instead of resending
+     * them. With a snapshot directory, each set is also checkpointed to "<token>.ellipses"
+     * (see EllipseFile) and reloaded when the server starts.
+     *
+     * Snapshots are written by a background thread, so a checkpoint only costs the event loop
+     * a copy of the ellipses; a newer checkpoint of a token replaces one not yet written.
+     * Detached sessions are dropped from memory once they have been idle for the time to live,
+     * or when more than the maximum are detached, least recently detached first. With a
+     * snapshot directory a dropped session is read back from its file on the next attach.
+     * Used only by the event loop thread, apart from the internal writer.
+     */
+    class SessionStore {
+    public:
+        static constexpr std::size_t MAX_TOKEN_LENGTH = 64;
+        static constexpr std::size_t DEFAULT_MAX_DETACHED = 4096;
+        static constexpr std::chrono::seconds DEFAULT_TIME_TO_LIVE{24 * 60 * 60};
+
+        /**
+         * @brief Constructor. Starts the snapshot writer if there is a directory.
+         * @param directory Where snapshots are written; sessions only live in memory if not set.
+         * @param max_detached The most detached sessions kept in memory.
+         * @param time_to_live How long a detached session is kept in memory.
+         * @throws std::runtime_error If the directory cannot be created.
+         */
+        explicit SessionStore(std::optional<std::string> directory, std::size_t max_detached = DEFAULT_MAX_DETACHED,
+                              std::chrono::steady_clock::duration time_to_live = DEFAULT_TIME_TO_LIVE);
+
+        /**
+         * @brief Destructor. Writes the pending snapshots and stops the writer.
+         */
+        ~SessionStore();
+
+        SessionStore(const SessionStore &) = delete;
+        SessionStore &operator=(const SessionStore &) = delete;
+
+        /**
+         * @brief Loads every snapshot in the directory, up to the detached session limit.
+         * Unreadable files are skipped with a warning.
+         */
+        void load_all();
+
+        /**
+         * @brief Checks that a token is 1 to MAX_TOKEN_LENGTH characters of [A-Za-z0-9_-].
+         * Tokens become file names, so nothing else is accepted.
+         * @param token The session token.
+         * @return True if the token is valid, false otherwise.
+         */
+        static bool is_valid_token(const std::string &token);
+
+        /**
+         * @brief Binds a token to a connection and hands over its saved ellipses.
+         * @param token The session token.
+         * @param ellipses Receives the saved ellipses; empty for a new token.
+         * @param error Receives a description of the problem on failure.
+         * @return True on success, false if the token is invalid or attached to another connection.
+         */
+        bool attach(const std::string &token, std::vector<Ellipse> &ellipses, std::string &error);
+
+        /**
+         * @brief Queues the ellipses of an attached session for its snapshot, if there is a directory.
+         * @param token The session token.
+         * @param ellipses All ellipses of the session.
+         */
+        void checkpoint(const std::string &token, const std::vector<Ellipse> &ellipses);
+
+        /**
+         * @brief Releases a token when its connection closes, keeping the ellipses for the next attach.
+         * @param token The session token.
+         * @param ellipses All ellipses of the session.
+         */
+        void detach(const std::string &token, std::vector<Ellipse> ellipses);
+
+        /**
+         * @brief Blocks until every queued snapshot has been written.
+         */
+        void flush();
+
+        /**
+         * @brief Gets the number of sessions held in memory, attached or not.
+         * @return The session count.
+         */
+        std::size_t size() const;
+
+    private:
+        using Snapshot = std::shared_ptr<const std::vector<Ellipse>>;
+
+        struct Entry {
+            Snapshot ellipses; // Null while attached; the connection holds them
+            bool attached = false;
+            std::chrono::steady_clock::time_point detached_at;
+            std::list<std::string>::iterator detached_position; // In detached_, while not attached
+        };
+
+        /**
+         * @brief Gets the snapshot path of a token.
+         * @param token The session token.
+         * @return The file path inside directory_.
+         */
+        std::string snapshot_path(const std::string &token) const;
+
+        /**
+         * @brief Hands a snapshot to the writer, replacing one of the same token not yet taken.
+         * @param token The session token.
+         * @param ellipses The ellipses to write.
+         */
+        void queue_snapshot(const std::string &token, Snapshot ellipses);
+
+        /**
+         * @brief Reads the ellipses of a session that is not in memory.
+         * A snapshot still queued or being written is newer than the file, so it is used first.
+         * @param token The session token.
+         * @param ellipses Receives the ellipses; empty if the session is unknown.
+         */
+        void read_snapshot(const std::string &token, std::vector<Ellipse> &ellipses);
+
+        /**
+         * @brief Drops detached sessions past their time to live or beyond the limit.
+         */
+        void evict();
+
+        /**
+         * @brief Writes queued snapshots until the store is destroyed.
+         */
+        void run_writer();
+
+        std::optional<std::string> directory_;
+        std::size_t max_detached_;
+        std::chrono::steady_clock::duration time_to_live_;
+        std::unordered_map<std::string, Entry> entries_;
+        std::list<std::string> detached_; // Detached tokens, least recently detached first
+
+        // Snapshot writer; pending_ keeps a snapshot until its file is written, so attach can find it
+        struct PendingWrite {
+            Snapshot ellipses;
+            bool queued = false; // In write_order_; false while the writer holds the only request
+        };
+        std::mutex writer_mutex_;
+        std::condition_variable writer_cv_;
+        std::condition_variable written_cv_;
+        std::unordered_map<std::string, PendingWrite> pending_;
+        std::deque<std::string> write_order_; // Tokens of pending_ not yet taken by the writer
+        bool stopping_ = false;
+        std::thread writer_;
+    };
+
+} // namespace Server
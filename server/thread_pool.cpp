@@ -0,0 +1,133 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace Server {
+
+    struct ThreadPool::ParallelJob {
+        const std::function<void(size_t)> *body;
+        size_t count;
+        std::atomic<size_t> next_index{0};
+        std::atomic<size_t> finished{0};
+        std::mutex done_mutex;
+        std::condition_variable done_cv;
+        std::exception_ptr error;
+    };
+
+    ThreadPool::ThreadPool(size_t num_threads) : stopping_(false) {
+        workers_.reserve(num_threads);
+        for (size_t i = 0; i < num_threads; ++i) {
+            workers_.emplace_back(&ThreadPool::worker_loop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            stopping_ = true;
+        }
+        queue_cv_.notify_all();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    size_t ThreadPool::size() const {
+        return workers_.size();
+    }
+
+    void ThreadPool::submit(std::function<void()> task) {
+        if (workers_.empty()) {
+            try {
+                task();
+            } catch (...) {
+                // Same policy as tasks run by workers
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            queue_.push_back(std::move(task));
+        }
+        queue_cv_.notify_one();
+    }
+
+    void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)> &body) {
+        if (count == 0) {
+            return;
+        }
+        if (workers_.empty() || count == 1) {
+            for (size_t i = 0; i < count; ++i) {
+                body(i);
+            }
+            return;
+        }
+
+        auto job = std::make_shared<ParallelJob>();
+        job->body = &body;
+        job->count = count;
+
+        // The caller works on the job too, so at most count - 1 helpers are useful.
+        size_t helpers = std::min(workers_.size(), count - 1);
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            for (size_t i = 0; i < helpers; ++i) {
+                queue_.push_back([job] { run_job(*job); });
+            }
+        }
+        queue_cv_.notify_all();
+
+        run_job(*job);
+
+        std::unique_lock<std::mutex> lock(job->done_mutex);
+        job->done_cv.wait(lock, [&job] { return job->finished.load() == job->count; });
+        if (job->error) {
+            std::rethrow_exception(job->error);
+        }
+    }
+
+    void ThreadPool::worker_loop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex_);
+                queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (stopping_ && queue_.empty()) {
+                    return;
+                }
+                task = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            try {
+                task();
+            } catch (...) {
+                // A failing task must not take the worker down
+            }
+        }
+    }
+
+    void ThreadPool::run_job(ParallelJob &job) {
+        while (true) {
+            size_t index = job.next_index.fetch_add(1);
+            if (index >= job.count) {
+                return; // Late helpers never touch the (possibly gone) body
+            }
+
+            try {
+                (*job.body)(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(job.done_mutex);
+                if (!job.error) {
+                    job.error = std::current_exception();
+                }
+            }
+
+            if (job.finished.fetch_add(1) + 1 == job.count) {
+                std::lock_guard<std::mutex> lock(job.done_mutex);
+                job.done_cv.notify_all();
+            }
+        }
+    }
+
+} // namespace Server
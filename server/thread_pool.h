@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Server {
+
+    /**
+     * @brief A fixed-size pool of worker threads.
+     * Work is either a fire-and-forget task or an indexed loop. The caller of an indexed loop
+     * takes part in it, so a parallel_for never waits on workers that are busy elsewhere.
+     */
+    class ThreadPool {
+    public:
+        /**
+         * @brief Constructor. Starts the worker threads.
+         * @param num_threads The number of worker threads. Zero runs all work on the calling thread.
+         */
+        explicit ThreadPool(size_t num_threads);
+
+        /**
+         * @brief Destructor. Stops and joins all worker threads.
+         */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        /**
+         * @brief Gets the number of worker threads.
+         * @return The worker count.
+         */
+        size_t size() const;
+
+        /**
+         * @brief Queues a task to run on a worker thread.
+         * With no worker threads the task runs immediately on the calling thread.
+         * @param task The task to run. Exceptions escaping it are discarded.
+         */
+        void submit(std::function<void()> task);
+
+        /**
+         * @brief Runs body(i) for every i in [0, count) and waits for all calls to finish.
+         * Indices are handed out dynamically, so body must not depend on which thread runs it.
+         * The first exception thrown by body is rethrown on the calling thread.
+         * @param count The number of indices.
+         * @param body The function to run for each index.
+         */
+        void parallel_for(size_t count, const std::function<void(size_t)> &body);
+
+    private:
+        /**
+         * @brief Shared state of one parallel_for call.
+         */
+        struct ParallelJob;
+
+        /**
+         * @brief Main loop of a worker thread.
+         */
+        void worker_loop();
+
+        /**
+         * @brief Claims and runs indices of a job until none are left.
+         * @param job The job to work on.
+         */
+        static void run_job(ParallelJob &job);
+
+        std::vector<std::thread> workers_;
+        std::deque<std::function<void()>> queue_;
+        std::mutex queue_mutex_;
+        std::condition_variable queue_cv_;
+        bool stopping_;
+    };
+
+} // namespace Server
@@ -0,0 +1,109 @@
+#include "common/canvas.h"
+#include "common/ellipse.h"
+#include "server/coverage_raster.h"
+#include "server/scanline_integrator.h"
+#include "server/thread_pool.h"
+#include "test_util.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+    const double PI = std::acos(-1.0);
+
+    // Tolerances in units² at the default resolutions; raster cells are about 0.01 units² each
+    constexpr double SCANLINE_TOLERANCE = 0.05;
+    constexpr double RASTER_TOLERANCE = 1.0;
+
+    /**
+     * @brief A union of ellipses with a known covered area.
+     */
+    struct Case {
+        const char *name;
+        std::vector<Ellipse> ellipses;
+        double area;
+    };
+
+    // Union area of two circles of the same radius whose centers are a distance apart
+    double two_circle_union(double radius, double distance) {
+        const double lens = 2.0 * radius * radius * std::acos(distance / (2.0 * radius)) -
+                            0.5 * distance * std::sqrt(4.0 * radius * radius - distance * distance);
+        return 2.0 * PI * radius * radius - lens;
+    }
+
+    std::vector<Case> make_cases() {
+        return {
+            {"circle", {{0.0, 0.0, 10.0, 10.0}}, PI * 100.0},
+            {"axis-aligned ellipse", {{5.0, -3.0, 20.0, 5.0}}, PI * 100.0},
+            {"rotated ellipse", {{-4.0, 7.0, 20.0, 5.0, 0.7}}, PI * 100.0},
+            {"steep rotated ellipse", {{0.0, 0.0, 30.0, 2.0, 1.3}}, PI * 60.0},
+            {"disjoint circles", {{-20.0, 0.0, 8.0, 8.0}, {20.0, 0.0, 8.0, 8.0}}, 2.0 * PI * 64.0},
+            {"nested circles", {{0.0, 0.0, 15.0, 15.0}, {2.0, 1.0, 5.0, 5.0}}, PI * 225.0},
+            {"overlapping circles", {{-5.0, 0.0, 10.0, 10.0}, {5.0, 0.0, 10.0, 10.0}}, two_circle_union(10.0, 10.0)},
+            {"rotated circle", {{0.0, 0.0, 10.0, 10.0, 2.1}}, PI * 100.0},
+            {"circle clipped at a corner", {{Canvas::MAX_X, Canvas::MAX_Y, 10.0, 10.0}}, PI * 100.0 / 4.0},
+            {"rotated ellipse clipped at an edge", {{Canvas::MIN_X, 0.0, 20.0, 5.0, PI / 2.0}}, PI * 100.0 / 2.0},
+            {"whole canvas", {{0.0, 0.0, 200.0, 200.0}}, Canvas::get_area()},
+        };
+    }
+
+    void test_scanline(Server::ThreadPool &pool) {
+        for (const Case &test : make_cases()) {
+            const double serial = Server::ScanlineIntegrator::covered_area(test.ellipses, Server::ScanlineIntegrator::DEFAULT_STRIPS, nullptr);
+            const double parallel = Server::ScanlineIntegrator::covered_area(test.ellipses, Server::ScanlineIntegrator::DEFAULT_STRIPS, &pool);
+            CHECK_NEAR(serial, test.area, SCANLINE_TOLERANCE);
+            CHECK(serial == parallel);
+        }
+    }
+
+    void test_raster() {
+        for (const Case &test : make_cases()) {
+            Server::CoverageRaster raster;
+            for (const Ellipse &ellipse : test.ellipses) {
+                raster.insert(ellipse);
+            }
+            CHECK_NEAR(raster.covered_area(), test.area, RASTER_TOLERANCE);
+        }
+
+        // Inserting the same ellipse twice covers nothing new; clearing uncovers everything
+        Server::CoverageRaster raster;
+        const Ellipse ellipse{3.0, -2.0, 12.0, 6.0, 0.4};
+        raster.insert(ellipse);
+        const double once = raster.covered_area();
+        raster.insert(ellipse);
+        CHECK(raster.covered_area() == once);
+        raster.clear();
+        CHECK(raster.covered_area() == 0.0);
+
+        // Erasing an ellipse leaves exactly the cells of the others, shared ones included
+        const std::vector<Ellipse> ellipses = {ellipse, {-6.0, 1.0, 9.0, 9.0}, {30.0, 30.0, 5.0, 5.0}};
+        Server::CoverageRaster others;
+        others.insert(ellipses[1]);
+        others.insert(ellipses[2]);
+        for (const Ellipse &inserted : ellipses) {
+            raster.insert(inserted);
+        }
+        raster.erase(ellipses, 0);
+        CHECK(raster.covered_area() == others.covered_area());
+
+        // A finer raster gets closer to the exact area
+        const double exact = PI * 72.0;
+        Server::CoverageRaster coarse(128);
+        Server::CoverageRaster fine(2048);
+        coarse.insert(ellipse);
+        fine.insert(ellipse);
+        CHECK(std::fabs(fine.covered_area() - exact) <= std::fabs(coarse.covered_area() - exact));
+        CHECK_NEAR(fine.covered_area(), exact, 0.25);
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    Server::ThreadPool pool(3);
+    test_scanline(pool);
+    test_raster();
+
+    return Test::finish("area_engine_test");
+}
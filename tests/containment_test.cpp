@@ -0,0 +1,98 @@
+#include "common/canvas.h"
+#include "common/ellipse.h"
+#include "server/containment_kernel.h"
+#include "server/ellipse_grid.h"
+#include "test_util.h"
+#include <random>
+#include <vector>
+
+namespace {
+
+    constexpr unsigned int SEED = 2024;
+    constexpr std::size_t NUM_POINTS = 20011; // Not a multiple of any vector width, so the tails run too
+
+    std::vector<Ellipse> make_ellipses(std::size_t count, Server::ShapeKind shape, std::mt19937 &generator) {
+        std::uniform_real_distribution<double> center(-55.0, 55.0);
+        std::uniform_real_distribution<double> axis(0.5, 12.0);
+        std::uniform_real_distribution<double> angle(0.1, 3.0);
+        std::vector<Ellipse> ellipses(count);
+        for (Ellipse &ellipse : ellipses) {
+            ellipse = {center(generator), center(generator), axis(generator), axis(generator)};
+            if (shape == Server::ShapeKind::Circle) {
+                ellipse.b = ellipse.a;
+            } else if (shape == Server::ShapeKind::Rotated) {
+                ellipse.angle = angle(generator);
+            }
+        }
+        return ellipses;
+    }
+
+    // Batch kernels and the grid's grouped batches must agree point for point with single-point tests
+    void test_batches_match_points(Server::ShapeKind shape, std::size_t count) {
+        std::mt19937 generator(SEED + static_cast<unsigned int>(count));
+        const std::vector<Ellipse> ellipses = make_ellipses(count, shape, generator);
+        std::uniform_real_distribution<double> coordinate(Canvas::MIN_X, Canvas::MAX_X);
+        std::vector<double> xs(NUM_POINTS);
+        std::vector<double> ys(NUM_POINTS);
+        for (std::size_t i = 0; i < NUM_POINTS; ++i) {
+            xs[i] = coordinate(generator);
+            ys[i] = coordinate(generator);
+        }
+
+        Server::EllipseSoA soa;
+        Server::EllipseGrid grid(8);
+        for (std::size_t id = 0; id < ellipses.size(); ++id) {
+            soa.push_back(ellipses[id]);
+            grid.insert(ellipses[id], id);
+        }
+        const Server::ContainmentKernel::ShapeKernels &kernels = Server::ContainmentKernel::kernels_for(shape);
+
+        std::vector<unsigned char> covered(NUM_POINTS);
+        std::vector<size_t> owners(NUM_POINTS);
+        const std::size_t hits = kernels.count_covered(soa, xs.data(), ys.data(), NUM_POINTS, covered.data());
+        CHECK(kernels.find_covering(soa, xs.data(), ys.data(), NUM_POINTS, owners.data()) == hits);
+        CHECK(kernels.count_covered(soa, xs.data(), ys.data(), NUM_POINTS, nullptr) == hits);
+
+        std::vector<unsigned char> grid_covered(NUM_POINTS);
+        std::vector<size_t> grid_owners(NUM_POINTS);
+        CHECK(grid.count_covered(xs.data(), ys.data(), NUM_POINTS, grid_covered.data()) == hits);
+        CHECK(grid.find_covering(xs.data(), ys.data(), NUM_POINTS, grid_owners.data()) == hits);
+
+        // One-ellipse sets, to check an owner with the same arithmetic as the kernels
+        std::vector<Server::EllipseSoA> singles(ellipses.size());
+        for (std::size_t id = 0; id < ellipses.size(); ++id) {
+            singles[id].push_back(ellipses[id]);
+        }
+
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < NUM_POINTS; ++i) {
+            const bool inside = kernels.is_covered(soa, xs[i], ys[i]);
+            mismatches += covered[i] != inside || grid_covered[i] != inside || grid.is_covered(xs[i], ys[i]) != inside;
+
+            // Kernel owners are the first containing ellipse, as a single point finds it; grid owners any containing one
+            std::size_t first = 0;
+            kernels.find_covering(soa, &xs[i], &ys[i], 1, &first);
+            mismatches += owners[i] != first || (first == ellipses.size()) == inside;
+            if (inside) {
+                mismatches += grid_owners[i] == Server::EllipseGrid::NO_ELLIPSE ||
+                              !kernels.is_covered(singles[grid_owners[i]], xs[i], ys[i]);
+            } else {
+                mismatches += grid_owners[i] != Server::EllipseGrid::NO_ELLIPSE;
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    for (Server::ShapeKind shape : {Server::ShapeKind::Circle, Server::ShapeKind::AxisAligned, Server::ShapeKind::Rotated}) {
+        for (std::size_t count : {1, 3, 40, 300}) {
+            test_batches_match_points(shape, count);
+        }
+    }
+
+    return Test::finish("containment_test");
+}
@@ -0,0 +1,165 @@
+#include "common/ellipse.h"
+#include "server/coverage_raster.h"
+#include "server/monte_carlo_simulator.h"
+#include "server/scanline_integrator.h"
+#include "test_util.h"
+#include <cmath>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace {
+
+    constexpr unsigned int SEED = 12345;
+
+    bool same_ellipse(const std::optional<Ellipse> &actual, const Ellipse &expected) {
+        return actual && actual->cx == expected.cx && actual->cy == expected.cy && actual->a == expected.a &&
+               actual->b == expected.b && actual->angle == expected.angle;
+    }
+
+    Server::EstimateOptions scanline_options() {
+        Server::EstimateOptions options;
+        options.engine = Server::AreaEngine::Scanline;
+        return options;
+    }
+
+    Server::EstimateOptions raster_options() {
+        Server::EstimateOptions options;
+        options.engine = Server::AreaEngine::Raster;
+        return options;
+    }
+
+    void test_ids_survive_edits() {
+        Server::MonteCarloSimulator simulator;
+        const Ellipse first{-20.0, 0.0, 5.0, 5.0};
+        const Ellipse second{0.0, 0.0, 8.0, 4.0, 0.3};
+        const Ellipse third{20.0, 10.0, 6.0, 3.0};
+        simulator.add_ellipse(first);
+        simulator.add_ellipse(second);
+        simulator.add_ellipse(third);
+
+        // Removing the middle ellipse leaves its slot empty and shifts nothing
+        CHECK(simulator.remove_ellipse(1));
+        CHECK(!simulator.get_ellipse(1));
+        CHECK(same_ellipse(simulator.get_ellipse(0), first));
+        CHECK(same_ellipse(simulator.get_ellipse(2), third));
+        CHECK(simulator.get_ellipse_count() == 2);
+
+        // A removed id is gone for good and never handed out again
+        CHECK(!simulator.remove_ellipse(1));
+        CHECK(!simulator.update_ellipse(1, second));
+        const Ellipse fourth{-10.0, -30.0, 4.0, 9.0, 1.1};
+        simulator.add_ellipse(fourth);
+        CHECK(!simulator.get_ellipse(1));
+        CHECK(same_ellipse(simulator.get_ellipse(3), fourth));
+
+        // Updating keeps the id and touches no other ellipse
+        const Ellipse moved{25.0, -25.0, 3.0, 7.0, 0.9};
+        CHECK(simulator.update_ellipse(2, moved));
+        CHECK(same_ellipse(simulator.get_ellipse(2), moved));
+        CHECK(same_ellipse(simulator.get_ellipse(0), first));
+        CHECK(same_ellipse(simulator.get_ellipse(3), fourth));
+        CHECK(simulator.get_ellipse_count() == 3);
+
+        // Ids that were never given out
+        CHECK(!simulator.get_ellipse(4));
+        CHECK(!simulator.remove_ellipse(4));
+        CHECK(!simulator.update_ellipse(4, moved));
+
+        // Updating to EMPTY_SLOT removes the ellipse but keeps the id reserved
+        CHECK(simulator.update_ellipse(0, Server::MonteCarloSimulator::EMPTY_SLOT));
+        CHECK(!simulator.get_ellipse(0));
+        CHECK(simulator.get_ellipse_count() == 2);
+        simulator.add_ellipse(first);
+        CHECK(same_ellipse(simulator.get_ellipse(4), first));
+    }
+
+    // Random adds, removes and updates; every estimate must match a fresh simulator holding the survivors
+    void test_estimates_follow_edits(const Server::SimulatorConfig &config) {
+        Server::MonteCarloSimulator simulator(config);
+        std::vector<std::optional<Ellipse>> expected; // Indexed by id, like the simulator
+        std::mt19937 generator(SEED);
+        std::uniform_real_distribution<double> center(-45.0, 45.0);
+        std::uniform_real_distribution<double> axis(2.0, 15.0);
+        std::uniform_real_distribution<double> angle(0.0, 3.0);
+
+        Server::EstimateOptions monte_carlo;
+        monte_carlo.stopping.confidence = 0.999;
+        monte_carlo.stopping.relative_tolerance = 0.01;
+
+        for (int step = 0; step < 60; ++step) {
+            const Ellipse ellipse{center(generator), center(generator), axis(generator), axis(generator), angle(generator)};
+            const unsigned int action = generator() % 4;
+            if (action <= 1 || expected.empty()) {
+                simulator.add_ellipse(ellipse);
+                expected.push_back(ellipse);
+            } else {
+                const size_t id = generator() % expected.size();
+                const bool exists = expected[id].has_value();
+                if (action == 2) {
+                    CHECK(simulator.remove_ellipse(id) == exists);
+                    expected[id].reset();
+                } else {
+                    CHECK(simulator.update_ellipse(id, ellipse) == exists);
+                    if (exists) {
+                        expected[id] = ellipse;
+                    }
+                }
+            }
+
+            if (step % 10 != 9) {
+                continue;
+            }
+            std::vector<Ellipse> survivors;
+            for (size_t id = 0; id < expected.size(); ++id) {
+                CHECK(expected[id] ? same_ellipse(simulator.get_ellipse(id), *expected[id]) : !simulator.get_ellipse(id));
+                if (expected[id]) {
+                    survivors.push_back(*expected[id]);
+                }
+            }
+            CHECK(simulator.get_ellipse_count() == survivors.size());
+
+            const double exact = Server::ScanlineIntegrator::covered_area(survivors, Server::ScanlineIntegrator::DEFAULT_STRIPS, nullptr);
+            CHECK(simulator.estimate_area(scanline_options()).covered_area == exact);
+
+            // Edits only touch their own raster cells, which must leave the same cells as rasterizing the survivors
+            Server::CoverageRaster raster;
+            for (const Ellipse &survivor : survivors) {
+                raster.insert(survivor);
+            }
+            CHECK(simulator.estimate_area(raster_options()).covered_area == raster.covered_area());
+
+            // The 99.9% interval misses the exact area about once in a thousand estimates; the fixed seed keeps this stable
+            const Server::MonteCarloResult estimate = simulator.estimate_area(monte_carlo);
+            CHECK(estimate.interval_low <= exact && exact <= estimate.interval_high);
+        }
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    test_ids_survive_edits();
+
+    Server::SimulatorConfig config;
+    config.seed = SEED;
+    config.num_streams = 2;
+    test_estimates_follow_edits(config);
+
+    // A small persistent set makes estimates pool kept and fresh samples
+    config.max_sample_set = 20000;
+    test_estimates_follow_edits(config);
+
+    // So does a shared budget that runs out first; the simulator gives it all back when destroyed
+    Server::SampleBudget budget(8000);
+    config.sample_budget = &budget;
+    test_estimates_follow_edits(config);
+    CHECK(budget.get_used() == 0);
+    config.sample_budget = nullptr;
+
+    config.incremental = false;
+    test_estimates_follow_edits(config);
+
+    return Test::finish("ellipse_id_test");
+}
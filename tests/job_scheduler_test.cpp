@@ -0,0 +1,68 @@
+#include "server/job_scheduler.h"
+#include "server/thread_pool.h"
+#include "test_util.h"
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using Clock = Server::JobScheduler::Clock;
+
+    void test_urgent_jobs_run_first() {
+        // One worker, held by a first job while the rest queue up, so the order is the scheduler's alone
+        Server::ThreadPool pool(1);
+        Server::JobScheduler scheduler(pool);
+        std::promise<void> started;
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        scheduler.submit(0, Clock::time_point::max(), [&started, released] {
+            started.set_value();
+            released.wait();
+        });
+        started.get_future().wait();
+
+        std::mutex mutex;
+        std::condition_variable done;
+        std::vector<std::string> order;
+        auto job = [&](const char *name) {
+            return [&, name] {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(name);
+                done.notify_one();
+            };
+        };
+
+        const Clock::time_point now = Clock::now();
+        const Clock::time_point never = Clock::time_point::max();
+        scheduler.submit(0, never, job("plain 1"));
+        scheduler.submit(0, now + std::chrono::seconds(20), job("late deadline"));
+        scheduler.submit(1, never, job("high priority"));
+        scheduler.submit(0, never, job("plain 2"));
+        scheduler.submit(0, now + std::chrono::seconds(10), job("early deadline"));
+        scheduler.submit(-1, now, job("low priority"));
+        CHECK(scheduler.get_queued_count() == 6);
+
+        release.set_value();
+        std::unique_lock<std::mutex> lock(mutex);
+        CHECK(done.wait_for(lock, std::chrono::seconds(10), [&] { return order.size() == 6; }));
+
+        // Priority first, then the earliest deadline, then submission order; a deadline never beats a priority
+        const std::vector<std::string> expected = {"high priority", "early deadline", "late deadline",
+                                                   "plain 1",       "plain 2",        "low priority"};
+        CHECK(order == expected);
+        CHECK(scheduler.get_queued_count() == 0);
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    test_urgent_jobs_run_first();
+
+    return Test::finish("job_scheduler_test");
+}
@@ -0,0 +1,133 @@
+#include "common/ellipse.h"
+#include "common/protocol.h"
+#include "server/server.h"
+#include "test_util.h"
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+    bool parses(std::string_view buffer, Protocol::Frame &frame, std::size_t &consumed) {
+        return Protocol::parse_frame(buffer, frame, consumed) == Protocol::ParseStatus::Complete;
+    }
+
+    void test_frame_round_trip() {
+        // Two pipelined frames in one buffer: an Update entry and an Options line
+        const double update[] = {7.0, -1.5, 2.25, 3.0, 4.0, 0.5};
+        std::string buffer;
+        Protocol::append_frame(buffer, Protocol::MessageType::Update, 42, update, 6);
+        Protocol::append_frame(buffer, Protocol::MessageType::Options, 43, "engine=scanline rel_tol=0.05");
+        CHECK(buffer.size() == 2 * Protocol::FRAME_HEADER_SIZE + Protocol::UPDATE_SIZE + 28);
+
+        Protocol::Frame frame;
+        std::size_t consumed = 0;
+        CHECK(parses(buffer, frame, consumed));
+        CHECK(frame.type == Protocol::MessageType::Update);
+        CHECK(frame.sequence == 42);
+        CHECK(frame.payload.size() == Protocol::UPDATE_SIZE);
+        double values[6] = {};
+        CHECK(Protocol::read_doubles(frame.payload, values, 6));
+        for (int i = 0; i < 6; ++i) {
+            CHECK(values[i] == update[i]);
+        }
+
+        std::string_view rest = std::string_view(buffer).substr(consumed);
+        CHECK(parses(rest, frame, consumed));
+        CHECK(frame.type == Protocol::MessageType::Options);
+        CHECK(frame.sequence == 43);
+        CHECK(frame.payload == "engine=scanline rel_tol=0.05");
+        CHECK(consumed == rest.size());
+    }
+
+    void test_batches() {
+        // A version 3 rotated batch carries five doubles per ellipse
+        std::vector<double> rotated = {0.0, 0.0, 5.0, 2.0, 0.7, 10.0, -10.0, 3.0, 3.0, 0.0};
+        std::string buffer;
+        Protocol::append_frame(buffer, Protocol::MessageType::RotatedBatch, 1, rotated.data(), rotated.size());
+        Protocol::Frame frame;
+        std::size_t consumed = 0;
+        CHECK(parses(buffer, frame, consumed));
+        CHECK(frame.type == Protocol::MessageType::RotatedBatch);
+        CHECK(frame.payload.size() == 2 * Protocol::ROTATED_ELLIPSE_SIZE);
+        std::vector<double> decoded(frame.payload.size() / sizeof(double));
+        CHECK(Protocol::read_doubles(frame.payload, decoded.data()) == rotated.size());
+        CHECK(decoded == rotated);
+
+        // Remove frames carry one id per double; a ragged payload is not a sequence of doubles
+        const double ids[] = {0.0, 3.0, 17.0};
+        buffer.clear();
+        Protocol::append_frame(buffer, Protocol::MessageType::Remove, 2, ids, 3);
+        CHECK(parses(buffer, frame, consumed));
+        CHECK(frame.payload.size() == 3 * Protocol::ELLIPSE_ID_SIZE);
+        CHECK(Protocol::read_doubles(frame.payload.substr(1), decoded.data()) == 0);
+        CHECK(!Protocol::read_doubles(frame.payload, decoded.data(), 2));
+    }
+
+    void test_partial_and_invalid_frames() {
+        const double ellipse[] = {1.0, 2.0, 3.0, 4.0};
+        std::string buffer;
+        Protocol::append_frame(buffer, Protocol::MessageType::Ellipse, 5, ellipse, 4);
+
+        // Every strict prefix of a frame asks for more bytes
+        Protocol::Frame frame;
+        std::size_t consumed = 0;
+        for (std::size_t size = 0; size < buffer.size(); ++size) {
+            CHECK(Protocol::parse_frame(std::string_view(buffer).substr(0, size), frame, consumed) ==
+                  Protocol::ParseStatus::Incomplete);
+        }
+        CHECK(parses(buffer, frame, consumed));
+
+        // A length above the limit is rejected from the header alone
+        std::string oversized;
+        Protocol::append_frame(oversized, Protocol::MessageType::Batch, 6, std::string(Protocol::MAX_PAYLOAD_SIZE + 1, '\0'));
+        CHECK(Protocol::parse_frame(std::string_view(oversized).substr(0, Protocol::FRAME_HEADER_SIZE), frame, consumed) ==
+              Protocol::ParseStatus::Invalid);
+    }
+
+    void test_text_tokens() {
+        std::string_view line = "  1.5\t-2e1 +3   nan inf 4x ";
+        double value = 0.0;
+        CHECK(Protocol::parse_double(Protocol::next_token(line), value) && value == 1.5);
+        CHECK(Protocol::parse_double(Protocol::next_token(line), value) && value == -20.0);
+        CHECK(Protocol::parse_double(Protocol::next_token(line), value) && value == 3.0);
+        CHECK(!Protocol::parse_double(Protocol::next_token(line), value));
+        CHECK(!Protocol::parse_double(Protocol::next_token(line), value));
+        CHECK(!Protocol::parse_double(Protocol::next_token(line), value));
+        CHECK(Protocol::next_token(line).empty());
+        CHECK(line.empty());
+    }
+
+    void test_ellipse_validation() {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const double inf = std::numeric_limits<double>::infinity();
+        std::string error;
+        CHECK(Server::TcpServer::validate_ellipse({0.0, 0.0, 1.0, 2.0, 0.5}, error));
+
+        // Binary frames can carry any bit pattern; none of these may reach the simulator
+        const Ellipse invalid[] = {
+            {0.0, 0.0, 0.0, 2.0},  {0.0, 0.0, 1.0, -2.0}, {nan, 0.0, 1.0, 2.0},      {0.0, inf, 1.0, 2.0},
+            {0.0, 0.0, nan, 2.0},  {0.0, 0.0, 1.0, nan},  {0.0, 0.0, inf, 2.0},      {0.0, 0.0, 1.0, 2.0, nan},
+            {-inf, 0.0, 1.0, 2.0}, {0.0, 0.0, 1.0, 2.0, inf},
+        };
+        for (const Ellipse &ellipse : invalid) {
+            error.clear();
+            CHECK(!Server::TcpServer::validate_ellipse(ellipse, error));
+            CHECK(!error.empty());
+        }
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    test_frame_round_trip();
+    test_batches();
+    test_partial_and_invalid_frames();
+    test_text_tokens();
+    test_ellipse_validation();
+
+    return Test::finish("protocol_test");
+}
@@ -0,0 +1,63 @@
+#include "common/receive_buffer.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+
+    // Writes up to count bytes of one character, as a recv() into the buffer would
+    std::size_t receive(ReceiveBuffer &buffer, char c, std::size_t count) {
+        char *dest = buffer.prepare(count);
+        if (!dest) {
+            return 0;
+        }
+        const std::size_t written = std::min(count, buffer.writable());
+        std::memset(dest, c, written);
+        buffer.commit(written);
+        return written;
+    }
+
+    void test_receive_and_consume() {
+        ReceiveBuffer buffer;
+        CHECK(buffer.empty());
+        CHECK(receive(buffer, 'a', 10) == 10);
+        CHECK(receive(buffer, 'b', 5) == 5);
+        CHECK(buffer.data() == "aaaaaaaaaabbbbb");
+        buffer.consume(10);
+        CHECK(buffer.data() == "bbbbb");
+
+        // Reclaiming consumed space keeps the unread bytes in order
+        CHECK(receive(buffer, 'c', ReceiveBuffer::INITIAL_CAPACITY - 5) == ReceiveBuffer::INITIAL_CAPACITY - 5);
+        CHECK(buffer.size() == ReceiveBuffer::INITIAL_CAPACITY);
+        CHECK(buffer.data().substr(0, 6) == "bbbbbc");
+        buffer.consume(buffer.size());
+        CHECK(buffer.empty());
+    }
+
+    void test_maximum_size() {
+        // Writes stop at the maximum, and a full buffer refuses more until bytes are consumed
+        ReceiveBuffer buffer(100);
+        CHECK(receive(buffer, 'a', 60) == 60);
+        CHECK(receive(buffer, 'b', 60) == 40);
+        CHECK(buffer.full());
+        CHECK(buffer.prepare(1) == nullptr);
+        CHECK(receive(buffer, 'c', 1) == 0);
+
+        buffer.consume(30);
+        CHECK(!buffer.full());
+        CHECK(receive(buffer, 'c', 60) == 30);
+        CHECK(buffer.size() == 100);
+        CHECK(buffer.data() == std::string(30, 'a') + std::string(40, 'b') + std::string(30, 'c'));
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    test_receive_and_consume();
+    test_maximum_size();
+
+    return Test::finish("receive_buffer_test");
+}
@@ -0,0 +1,97 @@
+#include "server/request_options.h"
+#include "test_util.h"
+#include <string>
+
+namespace {
+
+    bool accepts(const char *text, Server::EstimateOptions &options) {
+        std::string error;
+        const bool valid = Server::RequestOptions::apply_all(text, options, error);
+        return valid && error.empty();
+    }
+
+    bool rejects(const char *text) {
+        Server::EstimateOptions options;
+        std::string error;
+        return !Server::RequestOptions::apply_all(text, options, error) && !error.empty();
+    }
+
+    void test_keys() {
+        Server::EstimateOptions options;
+        CHECK(accepts("engine=scanline sampler=sobol region=ellipses interval=jeffreys", options));
+        CHECK(options.engine == Server::AreaEngine::Scanline);
+        CHECK(options.sampler == Server::SamplerKind::Sobol);
+        CHECK(options.restrict_to_ellipses);
+        CHECK(options.stopping.method == Server::IntervalMethod::Jeffreys);
+
+        CHECK(accepts("rel_tol=0.05 abs_tol=2 conf=0.95 priority=-3 coalesce=off", options));
+        CHECK(options.stopping.relative_tolerance == 0.05);
+        CHECK(options.stopping.absolute_tolerance == 2.0);
+        CHECK(options.stopping.confidence == 0.95);
+        CHECK(options.priority == -3);
+        CHECK(!options.coalesce);
+
+        // An empty list changes nothing
+        CHECK(accepts("", options));
+        CHECK(options.priority == -3);
+
+        CHECK(rejects("engine"));
+        CHECK(rejects("engine=exact"));
+        CHECK(rejects("colour=blue"));
+        CHECK(rejects("conf=1"));
+        CHECK(rejects("priority=1.5"));
+        CHECK(rejects("priority=1001"));
+    }
+
+    void test_tolerances() {
+        // Either tolerance alone can stop sampling, whatever the order they are given in
+        Server::EstimateOptions options;
+        CHECK(accepts("rel_tol=0 abs_tol=5", options));
+        CHECK(!accepts("abs_tol=0", options));
+
+        CHECK(rejects("rel_tol=0"));
+        CHECK(rejects("rel_tol=-0.1"));
+        CHECK(rejects("rel_tol=0 abs_tol=0"));
+        CHECK(rejects("min_area=-1"));
+    }
+
+    void test_deadline() {
+        Server::EstimateOptions options;
+        CHECK(accepts("deadline_ms=250", options));
+        CHECK(options.deadline_ms == 250.0);
+        CHECK(accepts("deadline_ms=3600000", options));
+        CHECK(accepts("deadline_ms=0", options));
+        CHECK(options.deadline_ms == 0.0);
+
+        // Values that would overflow the conversion to a time point
+        CHECK(rejects("deadline_ms=3600001"));
+        CHECK(rejects("deadline_ms=1e300"));
+        CHECK(rejects("deadline_ms=inf"));
+        CHECK(rejects("deadline_ms=nan"));
+        CHECK(rejects("deadline_ms=-1"));
+    }
+
+    void test_stream_interval() {
+        Server::EstimateOptions options;
+        CHECK(accepts("stream_ms=50", options));
+        CHECK(options.stream_ms == 50.0);
+        CHECK(accepts("stream_ms=3600000", options));
+
+        CHECK(rejects("stream_ms=3600001"));
+        CHECK(rejects("stream_ms=1e300"));
+        CHECK(rejects("stream_ms=inf"));
+        CHECK(rejects("stream_ms=-5"));
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    test_keys();
+    test_tolerances();
+    test_deadline();
+    test_stream_interval();
+
+    return Test::finish("request_options_test");
+}
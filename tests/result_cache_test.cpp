@@ -0,0 +1,130 @@
+#include "common/ellipse.h"
+#include "server/result_cache.h"
+#include "test_util.h"
+#include <optional>
+
+namespace {
+
+    Server::MonteCarloResult result_of(double area) {
+        Server::MonteCarloResult result{};
+        result.covered_area = area;
+        return result;
+    }
+
+    bool finds(Server::ResultCache &cache, const Server::EllipseSetFingerprint &fingerprint,
+               const Server::EstimateOptions &options, double area) {
+        const std::optional<Server::MonteCarloResult> found = cache.find(fingerprint, options);
+        return found && found->covered_area == area;
+    }
+
+    void test_fingerprints() {
+        const Ellipse a{1.0, 2.0, 3.0, 4.0};
+        const Ellipse b{-5.0, 6.0, 7.0, 8.0, 0.5};
+
+        // Order-independent, and a removal undoes its add
+        Server::EllipseSetFingerprint forward;
+        forward.add(a);
+        forward.add(b);
+        Server::EllipseSetFingerprint backward;
+        backward.add(b);
+        backward.add(a);
+        CHECK(forward == backward);
+
+        Server::EllipseSetFingerprint only_a;
+        only_a.add(a);
+        backward.remove(b);
+        CHECK(backward == only_a);
+        CHECK(!(forward == only_a));
+
+        // A multiset: the same ellipse twice is not the same as once
+        only_a.add(a);
+        CHECK(!(only_a == backward));
+
+        // -0.0 and 0.0 describe the same ellipse
+        Server::EllipseSetFingerprint positive_zero;
+        positive_zero.add({0.0, 1.0, 2.0, 3.0});
+        Server::EllipseSetFingerprint negative_zero;
+        negative_zero.add({-0.0, 1.0, 2.0, 3.0});
+        CHECK(positive_zero == negative_zero);
+    }
+
+    void test_keys() {
+        Server::ResultCache cache;
+        Server::EllipseSetFingerprint fingerprint;
+        fingerprint.add({1.0, 2.0, 3.0, 4.0});
+        Server::EstimateOptions options;
+        cache.insert(fingerprint, options, result_of(10.0));
+        CHECK(finds(cache, fingerprint, options, 10.0));
+
+        // Every option that changes the estimate is part of the key
+        Server::EstimateOptions changed = options;
+        changed.stopping.relative_tolerance /= 2.0;
+        CHECK(!cache.find(fingerprint, changed));
+        changed = options;
+        changed.stopping.negligible_area = 0.0;
+        CHECK(!cache.find(fingerprint, changed));
+        changed = options;
+        changed.sampler = Server::SamplerKind::Sobol;
+        CHECK(!cache.find(fingerprint, changed));
+        changed = options;
+        changed.restrict_to_ellipses = true;
+        CHECK(!cache.find(fingerprint, changed));
+
+        // Scheduling options do not
+        changed = options;
+        changed.priority = 3;
+        changed.deadline_ms = 50.0;
+        changed.coalesce = true;
+        changed.stream_ms = 20.0;
+        CHECK(finds(cache, fingerprint, changed, 10.0));
+
+        // Deterministic engines ignore the sampling settings altogether
+        Server::EstimateOptions scanline;
+        scanline.engine = Server::AreaEngine::Scanline;
+        CHECK(!cache.find(fingerprint, scanline));
+        cache.insert(fingerprint, scanline, result_of(11.0));
+        scanline.stopping.confidence = 0.5;
+        scanline.sampler = Server::SamplerKind::Halton;
+        CHECK(finds(cache, fingerprint, scanline, 11.0));
+        CHECK(finds(cache, fingerprint, options, 10.0));
+
+        const Server::ResultCacheStats stats = cache.get_stats();
+        CHECK(stats.entries == 2);
+        CHECK(stats.hits == 4);
+        CHECK(stats.misses == 5);
+    }
+
+    void test_eviction() {
+        // The least recently used result goes first; a lookup counts as a use
+        Server::ResultCache cache(2);
+        Server::EstimateOptions options;
+        Server::EllipseSetFingerprint first, second, third;
+        first.add({1.0, 1.0, 1.0, 1.0});
+        second.add({2.0, 2.0, 2.0, 2.0});
+        third.add({3.0, 3.0, 3.0, 3.0});
+        cache.insert(first, options, result_of(1.0));
+        cache.insert(second, options, result_of(2.0));
+        CHECK(finds(cache, first, options, 1.0));
+        cache.insert(third, options, result_of(3.0));
+        CHECK(!cache.find(second, options));
+        CHECK(finds(cache, first, options, 1.0));
+        CHECK(finds(cache, third, options, 3.0));
+        CHECK(cache.get_stats().entries == 2);
+
+        // Capacity 0 disables the cache
+        Server::ResultCache disabled(0);
+        disabled.insert(first, options, result_of(1.0));
+        CHECK(!disabled.find(first, options));
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    test_fingerprints();
+    test_keys();
+    test_eviction();
+
+    return Test::finish("result_cache_test");
+}
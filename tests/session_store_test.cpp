@@ -0,0 +1,112 @@
+#include "server/session_store.h"
+#include "test_util.h"
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    bool same_ellipses(const std::vector<Ellipse> &actual, const std::vector<Ellipse> &expected) {
+        if (actual.size() != expected.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < actual.size(); ++i) {
+            if (actual[i].cx != expected[i].cx || actual[i].cy != expected[i].cy || actual[i].a != expected[i].a ||
+                actual[i].b != expected[i].b || actual[i].angle != expected[i].angle) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string temporary_directory() {
+        return (std::filesystem::temp_directory_path() / ("session_store_test_" + std::to_string(getpid()))).string();
+    }
+
+    void test_attach_and_detach() {
+        Server::SessionStore store(std::nullopt);
+        std::vector<Ellipse> ellipses;
+        std::string error;
+        CHECK(!store.attach("bad token", ellipses, error));
+        CHECK(store.attach("alpha", ellipses, error));
+        CHECK(ellipses.empty());
+
+        // One connection per token at a time
+        CHECK(!store.attach("alpha", ellipses, error));
+
+        const std::vector<Ellipse> saved = {{1.0, 2.0, 3.0, 4.0}, {-5.0, 6.0, 7.0, 8.0, 0.5}};
+        store.detach("alpha", saved);
+        CHECK(store.attach("alpha", ellipses, error));
+        CHECK(same_ellipses(ellipses, saved));
+    }
+
+    void test_eviction() {
+        // Beyond the limit, the least recently detached session goes first
+        Server::SessionStore store(std::nullopt, 2, std::chrono::hours(1));
+        std::vector<Ellipse> ellipses;
+        std::string error;
+        for (const char *token : {"a", "b", "c"}) {
+            CHECK(store.attach(token, ellipses, error));
+        }
+        store.detach("a", {{1.0, 1.0, 1.0, 1.0}});
+        store.detach("b", {{2.0, 2.0, 2.0, 2.0}});
+        store.detach("c", {{3.0, 3.0, 3.0, 3.0}});
+        CHECK(store.size() == 2);
+        CHECK(store.attach("a", ellipses, error));
+        CHECK(ellipses.empty());
+        CHECK(store.attach("c", ellipses, error));
+        CHECK(ellipses.size() == 1 && ellipses[0].cx == 3.0);
+
+        // With no time to live, nothing detached survives the next attach
+        Server::SessionStore expiring(std::nullopt, 16, std::chrono::seconds(0));
+        CHECK(expiring.attach("d", ellipses, error));
+        expiring.detach("d", {{4.0, 4.0, 4.0, 4.0}});
+        CHECK(expiring.attach("d", ellipses, error));
+        CHECK(ellipses.empty());
+        CHECK(expiring.size() == 1);
+    }
+
+    void test_snapshots() {
+        const std::string directory = temporary_directory();
+        const std::vector<Ellipse> first = {{1.0, 2.0, 3.0, 4.0}};
+        const std::vector<Ellipse> second = {{1.0, 2.0, 3.0, 4.0}, {5.0, 6.0, 7.0, 8.0, 0.25}};
+        std::vector<Ellipse> ellipses;
+        std::string error;
+        {
+            // Evicted from memory at once, so attaching reads the snapshot back
+            Server::SessionStore store(directory, 0, std::chrono::hours(1));
+            CHECK(store.attach("delta", ellipses, error));
+            store.checkpoint("delta", first);
+            store.detach("delta", second);
+            CHECK(store.size() == 0);
+            CHECK(store.attach("delta", ellipses, error));
+            CHECK(same_ellipses(ellipses, second));
+
+            store.detach("delta", first);
+            store.flush();
+            CHECK(std::filesystem::exists(std::filesystem::path(directory) / "delta.ellipses"));
+        }
+        {
+            // A restarted server finds the last snapshot
+            Server::SessionStore store(directory);
+            store.load_all();
+            CHECK(store.size() == 1);
+            CHECK(store.attach("delta", ellipses, error));
+            CHECK(same_ellipses(ellipses, first));
+        }
+        std::filesystem::remove_all(directory);
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    test_attach_and_detach();
+    test_eviction();
+    test_snapshots();
+
+    return Test::finish("session_store_test");
+}
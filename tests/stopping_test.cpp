@@ -0,0 +1,134 @@
+#include "server/sequential_stopping.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+    /**
+     * @brief Exact coverage probability of a binomial interval.
+     * Sums the binomial probabilities of all hit counts whose interval contains the true proportion.
+     * @param stopping The rule whose interval is checked.
+     * @param samples The number of samples.
+     * @param proportion The true covered proportion, in (0, 1).
+     * @return The probability that the interval contains the proportion.
+     */
+    double exact_coverage(const Server::SequentialStopping &stopping, long long samples, double proportion) {
+        const double log_p = std::log(proportion);
+        const double log_q = std::log1p(-proportion);
+        const double log_n_factorial = std::lgamma(static_cast<double>(samples) + 1.0);
+        double coverage = 0.0;
+        for (long long hits = 0; hits <= samples; ++hits) {
+            const double log_probability = log_n_factorial - std::lgamma(static_cast<double>(hits) + 1.0) -
+                                           std::lgamma(static_cast<double>(samples - hits) + 1.0) + hits * log_p +
+                                           (samples - hits) * log_q;
+            const Server::ProportionInterval interval = stopping.binomial_interval(samples, hits);
+            if (interval.low <= proportion && proportion <= interval.high) {
+                coverage += std::exp(log_probability);
+            }
+        }
+        return coverage;
+    }
+
+    // Average and worst coverage over proportions spread across (0, 1)
+    void check_coverage(Server::IntervalMethod method, double confidence, double mean_tolerance, double worst_tolerance) {
+        Server::StoppingCriteria criteria;
+        criteria.method = method;
+        criteria.confidence = confidence;
+        const Server::SequentialStopping stopping(criteria);
+
+        for (long long samples : {50LL, 200LL, 1000LL}) {
+            double sum = 0.0;
+            double worst = 1.0;
+            int count = 0;
+            for (double proportion = 0.05; proportion < 0.951; proportion += 0.01) {
+                const double coverage = exact_coverage(stopping, samples, proportion);
+                sum += coverage;
+                worst = std::min(worst, coverage);
+                ++count;
+            }
+            CHECK_NEAR(sum / count, confidence, mean_tolerance);
+            CHECK(worst >= confidence - worst_tolerance);
+        }
+    }
+
+    void test_interval_shape() {
+        for (Server::IntervalMethod method :
+             {Server::IntervalMethod::Wilson, Server::IntervalMethod::AgrestiCoull, Server::IntervalMethod::Jeffreys}) {
+            Server::StoppingCriteria criteria;
+            criteria.method = method;
+            const Server::SequentialStopping stopping(criteria);
+
+            for (long long hits : {0LL, 1LL, 500LL, 999LL, 1000LL}) {
+                const Server::ProportionInterval interval = stopping.binomial_interval(1000, hits);
+                const double estimate = static_cast<double>(hits) / 1000.0;
+                CHECK(0.0 <= interval.low && interval.high <= 1.0);
+                CHECK(interval.low <= estimate && estimate <= interval.high);
+            }
+
+            // More samples at the same proportion give a narrower interval
+            const Server::ProportionInterval few = stopping.binomial_interval(1000, 300);
+            const Server::ProportionInterval many = stopping.binomial_interval(100000, 30000);
+            CHECK(many.high - many.low < few.high - few.low);
+        }
+    }
+
+    void test_wilson_closed_form() {
+        // 95% Wilson interval for 30 hits out of 100, worked out by hand
+        Server::StoppingCriteria criteria;
+        criteria.confidence = 0.95;
+        const Server::SequentialStopping stopping(criteria);
+        const Server::ProportionInterval interval = stopping.binomial_interval(100, 30);
+        CHECK_NEAR(interval.low, 0.2189, 1e-3);
+        CHECK_NEAR(interval.high, 0.3958, 1e-3);
+    }
+
+    void test_tolerances() {
+        // Relative tolerance only; the absolute one is off by default
+        Server::StoppingCriteria criteria;
+        criteria.relative_tolerance = 0.01;
+        const Server::SequentialStopping relative(criteria);
+        CHECK(!relative.is_satisfied(1000, 500));
+        CHECK(relative.is_satisfied(1000000, 500000));
+        CHECK(relative.is_satisfied(Server::SequentialStopping::MAX_SAMPLES, 0));
+        CHECK(!relative.is_satisfied(Server::SequentialStopping::MIN_SAMPLES - 1, 0));
+
+        // A rare hit count needs many samples under the relative tolerance...
+        CHECK(!relative.is_satisfied(1000000, 10));
+        // ...but a loose absolute tolerance in units² stops it early
+        criteria.absolute_tolerance = 10.0;
+        const Server::SequentialStopping absolute(criteria);
+        CHECK(absolute.is_satisfied(1000000, 10));
+
+        // No hits at all: the interval soon lies below the negligible area...
+        CHECK(!relative.is_satisfied(Server::SequentialStopping::MIN_SAMPLES, 0));
+        CHECK(relative.is_satisfied(200000, 0));
+        // ...which never happens with that rule disabled
+        criteria.absolute_tolerance = 0.0;
+        criteria.negligible_area = 0.0;
+        const Server::SequentialStopping unbounded(criteria);
+        CHECK(!unbounded.is_satisfied(200000, 0));
+
+        // The suggested rounds never more than double the sample count
+        CHECK(relative.next_round_samples(10000, 5000) <= 10000);
+        CHECK(relative.next_round_samples(10000, 5000) >= 1);
+    }
+
+} // namespace
+
+int main() {
+    Test::silence_logging();
+
+    test_interval_shape();
+    test_wilson_closed_form();
+    test_tolerances();
+
+    // Wilson and Jeffreys average close to nominal; Agresti-Coull errs on the conservative side
+    check_coverage(Server::IntervalMethod::Wilson, 0.95, 0.01, 0.08);
+    check_coverage(Server::IntervalMethod::Jeffreys, 0.95, 0.01, 0.08);
+    check_coverage(Server::IntervalMethod::AgrestiCoull, 0.95, 0.015, 0.05);
+    check_coverage(Server::IntervalMethod::Wilson, Server::StoppingCriteria::ONE_SIGMA_CONFIDENCE, 0.02, 0.15);
+
+    return Test::finish("stopping_test");
+}
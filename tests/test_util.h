@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common/logger.h"
+#include <cmath>
+#include <iostream>
+
+/**
+ * @brief Minimal checks for the unit tests.
+ * A failed check prints its location and expression and the test carries on, so one run
+ * reports every failure. Test::finish() turns the failure count into the exit status.
+ */
+namespace Test {
+
+    /**
+     * @brief Gets the number of failed checks so far.
+     * @return A reference to the counter.
+     */
+    inline int &failures() {
+        static int count = 0;
+        return count;
+    }
+
+    /**
+     * @brief Records the outcome of one check.
+     * @param passed Whether the check held.
+     * @param expression The checked expression, as written.
+     * @param file The source file of the check.
+     * @param line The line of the check.
+     */
+    inline void record(bool passed, const char *expression, const char *file, int line) {
+        if (!passed) {
+            ++failures();
+            std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+        }
+    }
+
+    /**
+     * @brief Records whether two numbers agree within a tolerance.
+     * @param actual The computed value.
+     * @param expected The reference value.
+     * @param tolerance The largest accepted absolute difference.
+     * @param expression The compared expressions, as written.
+     * @param file The source file of the check.
+     * @param line The line of the check.
+     */
+    inline void record_near(double actual, double expected, double tolerance, const char *expression, const char *file,
+                            int line) {
+        const bool passed = std::fabs(actual - expected) <= tolerance;
+        record(passed, expression, file, line);
+        if (!passed) {
+            std::cerr << "    got " << actual << ", expected " << expected << " +/- " << tolerance << std::endl;
+        }
+    }
+
+    /**
+     * @brief Prints the summary of a test program.
+     * @param name The name of the test program.
+     * @return The exit status: 0 if every check passed, 1 otherwise.
+     */
+    inline int finish(const char *name) {
+        if (failures() == 0) {
+            std::cout << name << ": all checks passed" << std::endl;
+            return 0;
+        }
+        std::cout << name << ": " << failures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    /**
+     * @brief Turns logging off for the whole test run.
+     * The simulator logs every estimate, which would drown the test output.
+     */
+    inline void silence_logging() {
+        Log::set_level(Log::Level::Off);
+    }
+
+} // namespace Test
+
+#define CHECK(condition) Test::record((condition), #condition, __FILE__, __LINE__)
+#define CHECK_NEAR(actual, expected, tolerance) \
+    Test::record_near((actual), (expected), (tolerance), #actual " ~ " #expected, __FILE__, __LINE__)